@@ -69,6 +69,15 @@
 // 200 per second: 16MHz clock   250 per second: 20MHz clock
 #define DELTA_SEGMENTS_PER_SECOND 200
 
+// If defined moves are cut by how far the arms stray from the straight line instead. Each segment
+// moves the joints linearly, and gets cut up further while the nozzle is more than
+// SEGMENT_MAX_DEVIATION mm off the line halfway along it. Segments are kept between
+// SEGMENT_MIN_LENGTH and SEGMENT_MAX_LENGTH mm. Most moves take far fewer blocks than with
+// DELTA_SEGMENTS_PER_SECOND, and the cuts get closer where the arms bend the line the most.
+//#define SEGMENT_MAX_DEVIATION 0.01 // mm
+#define SEGMENT_MIN_LENGTH 0.2       // mm
+#define SEGMENT_MAX_LENGTH 10        // mm
+
 // Center-to-center distance of the holes in the diagonal push rods.
 //#define DELTA_DIAGONAL_ROD 250.0 // mm
 
@@ -118,6 +127,21 @@
 #define SCARA_RAD2DEG 57.295779513082320876798154814105  // to convert RAD to degrees
 //#define SCARA_DEG2RAD 0.0174532
 
+// If defined calculate_delta() gets the arm angles from polynomial approximations of atan2 and acos
+// with the constant parts of the law of cosines worked out beforehand, instead of the libm
+// functions. marlin_sim ik (make hostsim-fastik) reports the angle and nozzle errors and the
+// time per call of both.
+//#define SCARA_FAST_IK
+
+// If defined calculate_delta() interpolates the arm angles from tables setup() makes of the angles
+// at the elbows over the distances of the bed from the tower and of atan(), with this many
+// entries in each (4 bytes each, 2 tables of them and one of 32 for atan), one sqrt and one
+// division per call. Cells of the tables the interpolation is off in by more than
+// SCARA_IK_TABLE_TOLERANCE radians, out where the arm is stretched, and points off the bed use acos()
+// instead. M377 makes the tables again and reports them. Not with SCARA_FAST_IK.
+//#define SCARA_IK_TABLE 48
+#define SCARA_IK_TABLE_TOLERANCE 0.000001
+
 // To prevent unsafe movements because the starting x/y could
 // be past the soft endstops, move to the below position after a home
 //#define SCARA_home_safe_starting_x  0 //mm   
@@ -377,6 +401,12 @@ const bool Z_ENDSTOPS_INVERTING = true; // set to true to invert the logic of th
 #define DEFAULT_ZJERK                 100.0    // (mm/sec)
 #define DEFAULT_EJERK                 15.0    // (mm/sec)
 
+// Junction deviation cornering (M205 J). Instead of limiting the XY speed change at a corner to
+// max_xy_jerk, the planner slows down to the speed a circle of this deviation from the corner
+// could be taken at with the block's acceleration. On a SCARA the corner angle is taken between
+// the joint space directions of the segments. 0 keeps the jerk planner.
+#define DEFAULT_JUNCTION_DEVIATION    0.0     // (mm)               // Stored in M205 on eeprom
+
 //===========================================================================
 //=============================Additional Features===========================
 //===========================================================================
@@ -38,7 +38,7 @@ void _EEPROM_readData(int &pos, uint8_t* value, uint8_t size)
 // the default values are used whenever there is a change to the data, to prevent
 // wrong data being written to the variables.
 // ALSO:  always make sure the variables in the Store and retrieve sections are in the same order.
-#define EEPROM_VERSION "V07"
+#define EEPROM_VERSION "V09"
 
 #ifdef EEPROM_SETTINGS
 void Config_StoreSettings() 
@@ -59,6 +59,7 @@ void Config_StoreSettings()
   EEPROM_WRITE_VAR(i,max_xy_jerk);
   EEPROM_WRITE_VAR(i,max_z_jerk);
   EEPROM_WRITE_VAR(i,max_e_jerk);
+  EEPROM_WRITE_VAR(i,junction_deviation);
   EEPROM_WRITE_VAR(i,add_homeing);
   
   EEPROM_WRITE_VAR(i,GCal_X);
@@ -93,6 +94,10 @@ void Config_StoreSettings()
     EEPROM_WRITE_VAR(i,0);
     EEPROM_WRITE_VAR(i,0);
   #endif
+  #ifndef LIN_ADVANCE
+  float extruder_advance_k=LIN_ADVANCE_K;
+  #endif
+  EEPROM_WRITE_VAR(i,extruder_advance_k);
   char ver2[4]=EEPROM_VERSION;
   i=EEPROM_OFFSET;
   EEPROM_WRITE_VAR(i,ver2); // validate data
@@ -147,7 +152,7 @@ void Config_PrintSettings()
     SERIAL_ECHOLN("");
 
     SERIAL_ECHO_START;
-    SERIAL_ECHOLNPGM("Advanced variables: S=Min feedrate (mm/s), T=Min travel feedrate (mm/s), B=minimum segment time (ms), X=maximum xY jerk (mm/s),  Z=maximum Z jerk (mm/s)");
+    SERIAL_ECHOLNPGM("Advanced variables: S=Min feedrate (mm/s), T=Min travel feedrate (mm/s), B=minimum segment time (ms), X=maximum xY jerk (mm/s),  Z=maximum Z jerk (mm/s), E=maximum E jerk (mm/s), J=junction deviation (0=use jerk)");
     SERIAL_ECHO_START;
     SERIAL_ECHOPAIR("  M205 S",minimumfeedrate ); 
     SERIAL_ECHOPAIR(" T" ,mintravelfeedrate ); 
@@ -155,6 +160,7 @@ void Config_PrintSettings()
     SERIAL_ECHOPAIR(" X" ,max_xy_jerk ); 
     SERIAL_ECHOPAIR(" Z" ,max_z_jerk);
     SERIAL_ECHOPAIR(" E" ,max_e_jerk);
+    SERIAL_ECHOPAIR(" J" ,junction_deviation);
     SERIAL_ECHOLN(""); 
 
     SERIAL_ECHO_START;
@@ -164,6 +170,14 @@ void Config_PrintSettings()
     SERIAL_ECHOPAIR(" Y" ,add_homeing[1] );
     SERIAL_ECHOPAIR(" Z" ,add_homeing[2] );
     SERIAL_ECHOLN("");
+
+#ifdef LIN_ADVANCE
+    SERIAL_ECHO_START;
+    SERIAL_ECHOLNPGM("Linear advance (s):");
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("  M900 K" ,extruder_advance_k );
+    SERIAL_ECHOLN("");
+#endif
     
     //SERIAL_ECHO_START;
     //SERIAL_ECHOPAIR(" DEBUG bedlevel y0:",Arm_lookup[11][1]);
@@ -210,6 +224,7 @@ void Config_RetrieveSettings()
         EEPROM_READ_VAR(i,max_xy_jerk);
         EEPROM_READ_VAR(i,max_z_jerk);
         EEPROM_READ_VAR(i,max_e_jerk);
+        EEPROM_READ_VAR(i,junction_deviation);
         EEPROM_READ_VAR(i,add_homeing);
         
         EEPROM_READ_VAR(i,GCal_X);
@@ -242,6 +257,10 @@ void Config_RetrieveSettings()
         EEPROM_READ_VAR(i,Kp);
         EEPROM_READ_VAR(i,Ki);
         EEPROM_READ_VAR(i,Kd);
+        #ifndef LIN_ADVANCE
+        float extruder_advance_k;
+        #endif
+        EEPROM_READ_VAR(i,extruder_advance_k);
 
         SERIAL_ECHO_START;
         SERIAL_ECHOLNPGM("Stored settings retreived:");
@@ -277,6 +296,10 @@ void Config_ResetDefault()
     max_xy_jerk=DEFAULT_XYJERK;
     max_z_jerk=DEFAULT_ZJERK;
     max_e_jerk=DEFAULT_EJERK;
+    junction_deviation=DEFAULT_JUNCTION_DEVIATION;
+#ifdef LIN_ADVANCE
+    extruder_advance_k=LIN_ADVANCE_K;
+#endif
     add_homeing[0] = add_homeing[1] = add_homeing[2] = 0;
     
     GCal_X = 4;
@@ -81,6 +81,13 @@
 #define ENDSTOPS_ONLY_FOR_HOMING // If defined the endstops will only be used for homing
 //#define ALWAYS_USE_XY_ENDSTOPS     // If defined,  ENDSTOPS_ONLY_FOR_HOMING will be ignored or X and Y endstops
 
+// Read the endstops when their pins change, from the external and pin change interrupts, instead of
+// in every stepper interrupt. Homing stops at the step the switch closed at. The next stepper
+// interrupt reads the pin again before it stops the move, so a single spike doesn't. Endstop pins
+// without an interrupt are still polled. Knows the pins of the ATmega1280 and 2560 only, polls on
+// the others.
+//#define ENDSTOP_INTERRUPTS
+
 
 //// AUTOSET LOCATIONS OF LIMIT SWITCHES
 //// Added by ZetaPhoenix 09-15-2012
@@ -153,12 +160,39 @@
 
 #define MAX_STEP_FREQUENCY 20000 // Max step frequency for Ultimaker (5000 pps / half step)
 
+// Ceiling for the stepper interrupt rate. Faster than this the interrupt takes 2, 4 or 8 step events
+// each time, as few as keep it under the ceiling. MAX_STEP_FREQUENCY can be up to 8 times this.
+#ifndef MAX_STEP_ISR_FREQUENCY
+  #define MAX_STEP_ISR_FREQUENCY 10000
+#endif
+
+// Timer 1 pre-scaler for the stepper interrupt, 1, 8 or 64. The speed tables are worked out from
+// it and F_CPU when compiling, see speed_lookuptable.h. The interrupt times its ramps in 24 bits of
+// timer ticks, so at 1 an acceleration can't last longer than about 1s.
+#ifndef STEPPER_TIMER_PRESCALER
+  #define STEPPER_TIMER_PRESCALER 8
+#endif
+#define STEPPER_TIMER_RATE (F_CPU / STEPPER_TIMER_PRESCALER) // Timer 1 ticks per second
+
+// Step rates covered by each entry of the fast speed table, as a power of 2 from 6 to 8. Smaller
+// makes the step timing smoother at high speed but covers fewer rates, at 6 the table ends at
+// 16384 steps/s per interrupt, see MAX_STEP_ISR_FREQUENCY. It takes 1KB of flash either way.
+#ifndef SPEED_LOOKUPTABLE_FAST_SHIFT
+  #define SPEED_LOOKUPTABLE_FAST_SHIFT 8
+#endif
+
 //By default pololu step drivers require an active high signal. However, some high power drivers require an active low signal as step.
 #define INVERT_X_STEP_PIN false
 #define INVERT_Y_STEP_PIN false
 #define INVERT_Z_STEP_PIN false
 #define INVERT_E_STEP_PIN false
 
+// Time the drivers need the direction pin to be settled before a step, in ns: 200 for the A4988,
+// 650 for the DRV8825. The stepper interrupt waits this long where it turns a direction pin right
+// before a step, for the lead steps of LIN_ADVANCE against the direction of the block and for
+// baby-steps.
+#define DIRECTION_SETUP_NS 650
+
 //default stepper release if idle
 #define DEFAULT_STEPPER_DEACTIVE_TIME 240     // disable steppers after 3min to ensure bed does not drop before print
 
@@ -168,8 +202,54 @@
 // minimum time in microseconds that a movement needs to take if the buffer is emptied.
 #define DEFAULT_MINSEGMENTTIME        20000
 
-// If defined the movements slow down when the look ahead buffer is only half full
-//#define SLOWDOWN // Does not work with kinematics
+// If defined G1/G2/G3 moves slow down when they arrive with less than SLOWDOWN_HORIZON us of planned
+// moves left in the look ahead buffer, in proportion to what is left, but to no less than
+// SLOWDOWN_MIN_FACTOR of their speed. A host that can not keep up then gets slower moves instead of
+// a stop at every buffer refill. Keep the horizon well below what a full buffer of kinematics
+// segments takes to run.
+#define SLOWDOWN
+#define SLOWDOWN_HORIZON 40000 // us
+#define SLOWDOWN_MIN_FACTOR 0.25
+
+// If defined M220 and the speed on the LCD also change the moves already in the look ahead buffer.
+// The blocks after the one the steppers are on get the nominal speed the new override gives them
+// and are replanned, so the change starts with the next block. Costs 8 bytes of RAM per block.
+#define SPEED_OVERRIDE_REPLAN
+
+// If defined M290 Z<mm> and Babystep Z in the Tune menu of the LCD move Z by small amounts while
+// printing, to get the first layer right without stopping. The stepper interrupt takes the steps on
+// top of the moves, one per interrupt, and neither the planner nor the step counters see them.
+// M290 H folds the offset into the Z home offset (M206 Z, M500 stores it), so the next G28 keeps it.
+// Costs 6 bytes of RAM and every stepper interrupt a test for baby-steps to take.
+//#define BABYSTEPPING
+#define BABYSTEP_LCD_MM 0.01 // mm per encoder step on the LCD
+
+// If defined prepare_move() goes on working out the joint angles and bed correction of up to this
+// many segments of a move while the look ahead buffer is full, instead of waiting for room with
+// each one, and plans them as the stepper interrupt frees blocks. Then a freed block is filled
+// after no more than the planner's own time, not that plus the kinematics. Costs 20 bytes of RAM
+// each, M122 reports how many segments were staged ahead with MOTION_STATS.
+#define KINEMATICS_STAGING 4
+
+// If defined the planner and the stepper interrupt keep statistics for M122: how often the buffer
+// ran empty, how many blocks were queued whenever one was added, the time planner_recalculate()
+// takes and the longest stepper interrupt. M122 R resets them. Costs 50 bytes of RAM.
+//#define MOTION_STATS
+
+// If defined the stepper interrupt can record what it does for M123: for each interrupt that steps,
+// the timer ticks since the one before, the time from the compare match to the first step, the
+// steps of each axis, whether it ran into the next compare match and which block it stepped, and
+// the plan of the last STEP_TRACE_BLOCKS blocks. M123 S1 starts recording, M123 S0 stops and M123
+// sends the last STEP_TRACE_SIZE interrupts. marlin_sim trace (see hostsim/hostsim.cpp) turns that
+// into step rates, jitter and the trapezoids the blocks ran. Costs 7 bytes of RAM per interrupt
+// and 25 per block, so BLOCK_BUFFER_SIZE may have to go down to make room.
+//#define STEP_TRACE
+#ifndef STEP_TRACE_SIZE
+  #define STEP_TRACE_SIZE 256 // power of 2
+#endif
+#ifndef STEP_TRACE_BLOCKS
+  #define STEP_TRACE_BLOCKS 16 // power of 2, up to 128
+#endif
 
 
 // Frequency limit
@@ -177,6 +257,31 @@
 // Not working O
 //#define XY_FREQUENCY_LIMIT  20
 
+// If defined the trapezoid generator works out the acceleration and deceleration steps in integer
+// math from a per block reciprocal of the acceleration, instead of float divisions. The passes also
+// compare squared speeds and only take a square root where the speed is limited. Step counts can
+// be off by a step from the float version.
+//#define PLANNER_FIXED_POINT
+
+// If defined the stepper ramps follow an S-curve instead of a constant acceleration. For the first
+// and last S_CURVE_JERK_SHARE/256 of each ramp the acceleration changes linearly, which keeps the
+// arms from ringing at the start and end of a move. The ramps take the time and distance the planner
+// planned, so in between the acceleration is 256/(256-S_CURVE_JERK_SHARE) times the set one, 4/3 for 64.
+// The curve is per block, short segmented moves get little of it. Moves are also limited to
+// MAX_STEP_FREQUENCY. Takes 16 more bytes of RAM per block.
+//#define S_CURVE_ACCELERATION
+#define S_CURVE_JERK_SHARE 64 // 1..128
+
+// If defined the step rates are worked out in the foreground instead of in the stepper interrupt.
+// st_prepare_segments() cuts the blocks into segments of up to STEP_SEGMENT_TIME at one rate and the
+// interrupt only steps them, which keeps it short and leaves room for a higher MAX_STEP_FREQUENCY.
+// The rate changes once per segment. The segments run STEP_SEGMENT_BUFFER_SIZE*STEP_SEGMENT_TIME ahead,
+// so nothing in the foreground may block for longer without calling manage_inactivity().
+// Does not work with ADVANCE.
+//#define STEP_SEGMENT_BUFFER
+#define STEP_SEGMENT_BUFFER_SIZE 8 // power of 2, 6 bytes of RAM each
+#define STEP_SEGMENT_TIME 4000 // us
+
 // Minimum planner junction speed. Sets the default minimum speed the planner plans for at the end
 // of the buffer and all stops. This should not be much greater than zero and should only be changed
 // if unwanted behavior is observed on a user's machine when running at very slow speeds.
@@ -236,9 +341,24 @@
 
 #endif // ADVANCE
 
-// Arc interpretation settings:
+// Linear pressure advance. On moves that extrude while the head moves, the extruder runs ahead of
+// the block by LIN_ADVANCE_K seconds of its E rate, so the nozzle pressure follows the speed instead of
+// lagging it. The lead grows and shrinks with the step rate in the stepper interrupt and is taken
+// back on moves that do not extrude. M900 K sets it and M500 stores it, 0 turns it off.
+// Costs 4 bytes of RAM per block and 2 per step segment. Does not work with ADVANCE.
+//#define LIN_ADVANCE
+#ifndef LIN_ADVANCE_K
+  #define LIN_ADVANCE_K 0.0 // s
+#endif
+
+// Arc interpretation settings: G2/G3 cut arcs into chords MM_PER_ARC_SEGMENT mm long, which then go
+// through the kinematics like G1 moves. If ARC_MAX_DEVIATION is defined the chords are as long as
+// they can be with their middle no more than that many mm off the circle, from
+// MIN_MM_PER_ARC_SEGMENT up to MM_PER_ARC_SEGMENT, so small arcs get finer ones.
 #define MM_PER_ARC_SEGMENT 1
 #define N_ARC_CORRECTION 25
+#define ARC_MAX_DEVIATION 0.002
+#define MIN_MM_PER_ARC_SEGMENT 0.1
 
 const unsigned int dropsegments=5; //everything with less than this number of steps will be ignored as move and joined with the next movement
 
@@ -274,6 +394,9 @@ const unsigned int dropsegments=5; //everything with less than this number of st
 
 // The number of linear motions that can be in the plan at any give time.  
 // THE BLOCK_BUFFER_SIZE NEEDS TO BE A POWER OF 2, i.g. 8,16,32 because shifts and ors are used to do the ringbuffering.
+// Each block takes 69 bytes of RAM on the AVR, 4 more with SLOWDOWN, 8 more with SPEED_OVERRIDE_REPLAN,
+// 16 more with ADVANCE, 4 more with LIN_ADVANCE, 16 more with S_CURVE_ACCELERATION and 3 more with
+// PLANNER_FIXED_POINT.
 #if defined SDSUPPORT
   #define BLOCK_BUFFER_SIZE 32   // SD,LCD,Buttons take more memory, block buffer needs to be smaller
 #else
@@ -158,8 +158,14 @@ void ClearToSend();
 
 void get_coordinates(bool apply_scaling=true);
 void calculate_delta(float cartesian[3]);
+void calculate_scara_angles(const float pos[2], float angles[2]); // theta and psi in degrees for a point relative to the tower
+#ifdef SCARA_IK_TABLE
+int scara_ik_table_build(); // returns the cells of the tables that use acos()
+void scara_ik_table_report();
+#endif
 void calculate_forward(float f_delta[3]);
 void prepare_move();
+void prepare_move_to(const float target[NUM_AXIS]); // prepare_move() to target, for the points of arcs
 void kill();
 void Stop();
 
@@ -168,6 +174,7 @@ bool IsStopped();
 void enquecommand(const char *cmd); //put an ascii command at the end of the current buffer.
 void enquecommand_P(const char *cmd); //put an ascii command at the end of the current buffer, read from flash
 void prepare_arc_move(char isclockwise);
+void stop_moves(); // Stops the moves in the buffer as fast as the acceleration allows
 void clamp_to_software_endstops(float target[3]);
 
 float calc_bed_delta(float cartesian[3]);
@@ -187,6 +194,7 @@ extern bool axis_relative_modes[];
 extern int feedmultiply;
 extern int extrudemultiply; // Sets extrude multiply factor (in percent)
 extern float current_position[NUM_AXIS] ;
+extern bool moves_stopped;
 extern float axis_scaling[NUM_AXIS];  // Build size scaling
 
 extern bool SoftEndsEnabled;
@@ -198,6 +206,10 @@ extern int GCal_X, GCal_Y,  // Position points for GridCal (Default 3)
 
 
 extern float add_homeing[NUM_AXIS];
+#ifdef BABYSTEPPING
+void babystep_z(float mm);   // Moves Z by mm on top of the moves, see M290
+float babystep_z_offset();   // mm baby-stepped since the last M290 H
+#endif
 extern float min_pos[3];
 extern float max_pos[3];
 extern int fanSpeed;
@@ -34,14 +34,15 @@
 
 FORCE_INLINE void store_char(unsigned char c)
 {
-  int i = (unsigned int)(rx_buffer.head + 1) % RX_BUFFER_SIZE;
+  unsigned char head = rx_buffer.head;
+  unsigned char i = (head + 1) & (RX_BUFFER_SIZE - 1);
 
   // if we should be storing the received character into the location
   // just before the tail (meaning that the head would advance to the
   // current location of the tail), we're about to overflow the buffer
   // and so we don't write the character or advance the head.
   if (i != rx_buffer.tail) {
-    rx_buffer.buffer[rx_buffer.head] = c;
+    rx_buffer.buffer[head] = c;
     rx_buffer.head = i;
   }
 }
@@ -109,37 +110,32 @@ void MarlinSerial::end()
 
 int MarlinSerial::peek(void)
 {
-  if (rx_buffer.head == rx_buffer.tail) {
+  unsigned char tail = rx_buffer.tail;
+  if (rx_buffer.head == tail) {
     return -1;
   } else {
-    return rx_buffer.buffer[rx_buffer.tail];
+    return rx_buffer.buffer[tail];
   }
 }
 
 int MarlinSerial::read(void)
 {
   // if the head isn't ahead of the tail, we don't have any characters
-  if (rx_buffer.head == rx_buffer.tail) {
+  unsigned char tail = rx_buffer.tail;
+  if (rx_buffer.head == tail) {
     return -1;
   } else {
-    unsigned char c = rx_buffer.buffer[rx_buffer.tail];
-    rx_buffer.tail = (unsigned int)(rx_buffer.tail + 1) % RX_BUFFER_SIZE;
+    // take the character before the tail gives its place back to the interrupt
+    unsigned char c = rx_buffer.buffer[tail];
+    rx_buffer.tail = (tail + 1) & (RX_BUFFER_SIZE - 1);
     return c;
   }
 }
 
 void MarlinSerial::flush()
 {
-  // don't reverse this or there may be problems if the RX interrupt
-  // occurs after reading the value of rx_buffer_head but before writing
-  // the value to rx_buffer_tail; the previous value of rx_buffer_head
-  // may be written to rx_buffer_tail, making it appear as if the buffer
-  // don't reverse this or there may be problems if the RX interrupt
-  // occurs after reading the value of rx_buffer_head but before writing
-  // the value to rx_buffer_tail; the previous value of rx_buffer_head
-  // may be written to rx_buffer_tail, making it appear as if the buffer
-  // were full, not empty.
-  rx_buffer.head = rx_buffer.tail;
+  // the tail catches up with the head, only the interrupt moves the head
+  rx_buffer.tail = rx_buffer.head;
 }
 
 
@@ -67,18 +67,22 @@
 #define FLOAT_PRINTED_DIGITS 4
 
 #ifndef AT90USB
-// Define constants and variables for buffering incoming serial data.  We're
-// using a ring buffer (I think), in which rx_buffer_head is the index of the
-// location to which to write the next incoming character and rx_buffer_tail
-// is the index of the location from which to read.
-#define RX_BUFFER_SIZE 128
+// Define constants and variables for buffering incoming serial data. The receive
+// interrupt is the only one to write the buffer and head, the main loop the only one
+// to move tail, so neither has to lock the other out. head is the index of the
+// location to which to write the next incoming character and tail is the index of
+// the location from which to read. One byte each, so they are read and written whole.
+#define RX_BUFFER_SIZE 128 // power of 2, up to 256
+#if RX_BUFFER_SIZE & (RX_BUFFER_SIZE - 1) || RX_BUFFER_SIZE > 256
+  #error RX_BUFFER_SIZE has to be a power of 2 up to 256
+#endif
 
 
 struct ring_buffer
 {
   unsigned char buffer[RX_BUFFER_SIZE];
-  int head;
-  int tail;
+  volatile unsigned char head;
+  volatile unsigned char tail;
 };
 
 #if UART_PRESENT(SERIAL_PORT)
@@ -98,7 +102,7 @@ class MarlinSerial //: public Stream
     
     FORCE_INLINE int available(void)
     {
-      return (unsigned int)(RX_BUFFER_SIZE + rx_buffer.head - rx_buffer.tail) % RX_BUFFER_SIZE;
+      return (unsigned char)(rx_buffer.head - rx_buffer.tail) & (RX_BUFFER_SIZE - 1);
     }
     
     FORCE_INLINE void write(uint8_t c)
@@ -110,24 +114,6 @@ class MarlinSerial //: public Stream
     }
     
     
-    FORCE_INLINE void checkRx(void)
-    {
-      if((M_UCSRxA & (1<<M_RXCx)) != 0) {
-        unsigned char c  =  M_UDRx;
-        int i = (unsigned int)(rx_buffer.head + 1) % RX_BUFFER_SIZE;
-
-        // if we should be storing the received character into the location
-        // just before the tail (meaning that the head would advance to the
-        // current location of the tail), we're about to overflow the buffer
-        // and so we don't write the character or advance the head.
-        if (i != rx_buffer.tail) {
-          rx_buffer.buffer[rx_buffer.head] = c;
-          rx_buffer.head = i;
-        }
-      }
-    }
-    
-    
     private:
     void printNumber(unsigned long, uint8_t);
     void printFloat(double, uint8_t);
@@ -101,6 +101,8 @@
 // M115	- Capabilities string
 // M117 - display message
 // M119 - Output Endstop status to serial port
+// M122 - Report planner and stepper statistics (MOTION_STATS), R resets them
+// M123 - Step trace (STEP_TRACE): S1 starts recording, S0 stops, without S sends the record
 // M140 - Set bed target temp
 // M190 - Wait for bed current temp to reach target temp.
 // M200 - Set filament diameter
@@ -108,25 +110,28 @@
 // M202 - Set max acceleration in units/s^2 for travel moves (M202 X1000 Y1000) Unused in Marlin!!
 // M203 - Set maximum feedrate that your machine can sustain (M203 X200 Y200 Z300 E10000) in mm/sec
 // M204 - Set default acceleration: S normal moves T filament only moves (M204 S3000 T7000) im mm/sec^2  also sets minimum segment time in ms (B20000) to prevent buffer underruns and M20 minimum feedrate
-// M205 -  advanced settings:  minimum travel speed S=while printing T=travel only,  B=minimum segment time X= maximum xy jerk, Z=maximum Z jerk, E=maximum E jerk
+// M205 -  advanced settings:  minimum travel speed S=while printing T=travel only,  B=minimum segment time X= maximum xy jerk, Z=maximum Z jerk, E=maximum E jerk, J=junction deviation (J0 = use jerk for cornering)
 // M206 - set additional homeing offset
 // M207 - set retract length S[positive mm] F[feedrate mm/sec] Z[additional zlift/hop]
 // M208 - set recover=unretract length S[positive mm surplus to the M207 S*] F[feedrate mm/sec]
 // M209 - S<1=true/0=false> enable automatic retract detect if the slicer did not support G10/11: every normal extrude-only move will be classified as retract depending on the direction.
-// M220 S<factor in percent>- set speed factor override percentage
+// M220 S<factor in percent>- set speed factor override percentage, also of the buffered moves (SPEED_OVERRIDE_REPLAN)
 // M221 S<factor in percent>- set extrude factor override percentage
 // M240 - Trigger a camera to take a photograph
+// M290 - Baby-step Z by Z<mm> while printing, H folds the offset into the Z home offset (requires BABYSTEPPING)
 // M301 - Set PID parameters P I and D
 // M302 - Allow cold extrudes
 // M303 - PID relay autotune S<temperature> sets the target temperature. (default target temperature = 150C)
 // M304 - Set bed PID parameters P I and D
 // M400 - Finish all moves
+// M410 - Stop the moves in the buffer as fast as the acceleration allows
 // M500 - stores paramters in EEPROM
 // M501 - reads parameters from EEPROM (if you need reset them after you changed them temporarily).  
 // M502 - reverts to the default "factory settings".  You still need to store them in EEPROM afterwards if you want to.
 // M503 - print the current settings (from memory not from eeprom)
 // M540 - Use S[0|1] to enable or disable the stop SD card print on endstop hit (requires ABORT_ON_ENDSTOP_HIT_FEATURE_ENABLED)
 // M600 - Pause for filament change X[pos] Y[pos] Z[relative lift] E[initial retract] L[later retract distance for removal]
+// M900 - Set the linear advance K[seconds], without K report it (requires LIN_ADVANCE)
 // M907 - Set digital trimpot motor current using axis codes.
 // M908 - Control digital trimpot directly.
 // M350 - Set microstepping mode.
@@ -147,6 +152,7 @@
 // M372 - Calculate all calibration points using data aquired
 // M373 - End calibration
 // M375 - Dsiplay calibration matrix
+// M377 - Make the SCARA arm angle tables again and report the cells that use acos() (requires SCARA_IK_TABLE)
 
 //Stepper Movement Variables
 
@@ -167,6 +173,10 @@ int feedmultiply=100; //100->1 200->2
 int saved_feedmultiply;
 int extrudemultiply=100; //100->1 200->2
 float current_position[NUM_AXIS] = { 0.0, 0.0, 0.0, 0.0 };
+// Set by stop_moves(), until the next command. The LCD can stop the moves while plan_segment()
+// waits for room in the buffer, the rest of that move is dropped and current_position stays where
+// the arms stopped.
+bool moves_stopped = false;
 float add_homeing[NUM_AXIS]={0,0,0,0};                            // Additional Homing :Theta and Psi is X and Y for SCARA
 float axis_scaling[NUM_AXIS]={1,1,1,1};                           // Build size scaling
 
@@ -235,6 +245,10 @@ unsigned long stoptime=0;
 
 static uint8_t tmp_extruder;
 
+#ifdef BABYSTEPPING
+static long babystep_z_steps = 0; // Z steps baby-stepped since the last M290 H
+#endif
+
 
 bool Stopped=false;
 
@@ -253,6 +267,9 @@ void serial_echopair_P(const char *s_P, unsigned long v)
     { serialprintPGM(s_P); SERIAL_ECHO(v); }
 
 extern "C"{
+#ifdef HOSTSIM_AVR_H
+  int freeMemory(); // The host simulator has no AVR heap, see sim_stubs.cpp
+#else
   extern unsigned int __bss_end;
   extern unsigned int __heap_start;
   extern void *__brkval;
@@ -267,6 +284,7 @@ extern "C"{
 
     return free_memory;
   }
+#endif
 }
 
 //adds an command to the main command buffer
@@ -385,6 +403,9 @@ void setup()
   }
   
   Config_RetrieveSettings(); // loads data from EEPROM if available
+  #ifdef SCARA_IK_TABLE
+  scara_ik_table_build();
+  #endif
 
   for(int8_t i=0; i < NUM_AXIS; i++)
   {
@@ -925,6 +946,7 @@ void process_commands()
   
   int counterx, countery;
 
+  moves_stopped = false;
   if(code_seen('G'))
   {
     switch((int)code_value())
@@ -947,19 +969,26 @@ void process_commands()
          SERIAL_ECHOLN("  No movement - Home first...");
       }  
       break;
-    /*      // Disable Arcs, for now.
     case 2: // G2  - CW ARC
-      if(Stopped == false) {
+      if(Stopped == false && dCal_X) {    // Ensure Unit homed.
         get_arc_coordinates();
         prepare_arc_move(true);
         return;
       }
+      else {
+         SERIAL_ECHOLN("  No movement - Home first...");
+      }
+      break;
     case 3: // G3  - CCW ARC
-      if(Stopped == false) {
+      if(Stopped == false && dCal_X) {    // Ensure Unit homed.
         get_arc_coordinates();
         prepare_arc_move(false);
         return;
-      } */
+      }
+      else {
+         SERIAL_ECHOLN("  No movement - Home first...");
+      }
+      break;
     case 4: // G4 dwell
       LCD_MESSAGEPGM(MSG_DWELL);
       codenum = 0;
@@ -1505,6 +1534,21 @@ void process_commands()
         SERIAL_PROTOCOLLN(((READ(Z_MAX_PIN)^Z_ENDSTOPS_INVERTING)?MSG_ENDSTOP_HIT:MSG_ENDSTOP_OPEN));
       #endif
       break;
+    #ifdef MOTION_STATS
+    case 122: // M122 planner and stepper statistics
+      if(code_seen('R')) motion_stats_reset();
+      else motion_stats_report();
+      break;
+    #endif
+    #ifdef STEP_TRACE
+    case 123: // M123 step trace
+      if(code_seen('S')) {
+        if(code_value() > 0) st_trace_start();
+        else st_trace_stop();
+      }
+      else st_trace_dump();
+      break;
+    #endif
       //TODO: update for all axis, use for loop
     case 201: // M201
       for(int8_t i=0; i < NUM_AXIS; i++) 
@@ -1542,6 +1586,7 @@ void process_commands()
       if(code_seen('X')) max_xy_jerk = code_value() ;
       if(code_seen('Z')) max_z_jerk = code_value() ;
       if(code_seen('E')) max_e_jerk = code_value() ;
+      if(code_seen('J')) junction_deviation = max(code_value(), 0.0);
     }
     break;
     case 206: // M206 additional homeing offset
@@ -1612,6 +1657,9 @@ void process_commands()
       if(code_seen('S')) 
       {
         feedmultiply = code_value() ;
+        #ifdef SPEED_OVERRIDE_REPLAN
+          plan_apply_feed_multiply();
+        #endif
       }
     }
     break;
@@ -1623,6 +1671,22 @@ void process_commands()
       }
     }
     break;
+    #ifdef BABYSTEPPING
+    case 290: // M290 Z<mm> Baby-step Z on top of the moves, H folds the offset into the Z home offset
+    {
+      if(code_seen('Z')) babystep_z(code_value());
+      if(code_seen('H'))
+      {
+        add_homeing[Z_AXIS] -= babystep_z_offset();
+        babystep_z_steps = 0;
+      }
+      SERIAL_ECHO_START;
+      SERIAL_ECHOPAIR("Babystep Z:", babystep_z_offset());
+      SERIAL_ECHOPAIR(" Home offset Z:", add_homeing[Z_AXIS]);
+      SERIAL_ECHOLN("");
+    }
+    break;
+    #endif //BABYSTEPPING
 
     #ifdef PIDTEMP
     case 301: // M301
@@ -1714,6 +1778,11 @@ void process_commands()
       st_synchronize();
     }
     break;
+    case 410: // M410 stop the moves in the buffer, the position is where the arms stop
+    {
+      stop_moves();
+    }
+    break;
     case 500: // M500 Store settings in EEPROM
     {
         SoftEndsEnabled = true;              // Ignore soft endstops during calibration
@@ -1868,6 +1937,16 @@ void process_commands()
     }
     break;
     #endif //FILAMENTCHANGEENABLE    
+    #ifdef LIN_ADVANCE
+    case 900: // M900 K<seconds> Set the linear advance, the blocks already planned keep theirs
+    {
+      if(code_seen('K')) extruder_advance_k = constrain(code_value(), 0.0, 0.99);
+      SERIAL_ECHO_START;
+      SERIAL_ECHOPAIR("Advance K:", extruder_advance_k);
+      SERIAL_ECHOLN("");
+    }
+    break;
+    #endif //LIN_ADVANCE
     case 907: // M907 Set digital trimpot motor current using axis codes.
     {
       #if DIGIPOTSS_PIN > -1
@@ -2150,6 +2229,13 @@ void process_commands()
   
     break;  
       
+    #ifdef SCARA_IK_TABLE
+    case 377: // M377 Make the arm angle tables again and report them
+      scara_ik_table_build();
+      scara_ik_table_report();
+    break;
+    #endif
+
     case 999: // M999: Restart after being stopped
       Stopped = false;
       lcd_reset_alert_level();
@@ -2471,36 +2557,190 @@ void calculate_forward(float f_delta[3])
   delta[Y_AXIS] = p * sin(rho) + SCARA_offset_y;  
 }  
 
-// Soft endstops on theta and psi
-#define MAX_THETA 150		
-#define MIN_THETA -50
-#define MAX_PSI 245
-#define MIN_PSI -30
-#define SMALLEST_DIFFERENCE_ANGLE 30	// Smallest angle between psi and theta
+#if defined(SCARA_FAST_IK) && defined(SCARA_IK_TABLE)
+  #error "SCARA_FAST_IK and SCARA_IK_TABLE can not be used together"
+#endif
 
-void calculate_delta(float cartesian[3])
+#ifdef SCARA_FAST_IK
+// The constant parts of the law of cosines for the angles the arms make with the line to the
+// nozzle: cos = (p^2 + k) * scale / p
+static const float scara_theta_k = sqr(LengthTheta) - sqr(LengthThetaExt);
+static const float scara_theta_scale = 0.5 / (LengthTheta);
+static const float scara_psi_k = sqr(LengthPsi) - sqr(LengthPsiExt);
+static const float scara_psi_scale = 0.5 / (LengthPsi);
+
+// acos() on [-1, 1] from Abramowitz and Stegun 4.4.46, off by less than 2e-8 rad. Outside of it
+// the arm is stretched or folded as far as it goes. The constants are float so the host
+// simulator works in the precision the AVR does.
+static float scara_acos(float x)
 {
-  // TODO Add scaling using axis_scaling[X_AXIS] and axis_scaling[Y_AXIS] to input on values to move commands (get_coordinates and all other functions manipulting destination)
-  
-  // SCARA "X" = theta
-  // SCARA "Y" = psi+theta, motor movement inverted.
+  bool negative = x < 0;
+  if (negative) x = -x;
+  if (x > 1) x = 1;
+  float a = ((((((-0.0012624911f * x + 0.0066700901f) * x - 0.0170881256f) * x + 0.0308918810f) * x
+              - 0.0501743046f) * x + 0.0889789874f) * x - 0.2145988016f) * x + 1.5707963050f;
+  a *= sqrt(1 - x);
+  return negative ? 3.14159265f - a : a;
+}
 
-  float SCARA_pos[2], D, C1, p, rho; //, cos_rho;
-  
-  SCARA_pos[X_AXIS] = (cartesian[X_AXIS] - SCARA_offset_x);  // Translate SCARA to standard X Y
-  SCARA_pos[Y_AXIS] = (cartesian[Y_AXIS] - SCARA_offset_y); 
+// atan2() from atan() on [0, 1], Abramowitz and Stegun 4.4.49, off by less than 2e-8 rad
+static float scara_atan2(float y, float x)
+{
+  float ax = fabs(x), ay = fabs(y);
+  bool steep = ay > ax;
+  float t = steep ? ax / ay : ay / ax;
+  float t2 = t * t;
+  float a = (((((((0.0028662257f * t2 - 0.0161657367f) * t2 + 0.0429096138f) * t2 - 0.0752896400f) * t2
+              + 0.1065626393f) * t2 - 0.1420889944f) * t2 + 0.1999355085f) * t2 - 0.3333314528f) * t2 * t + t;
+  if (steep) a = 1.57079633f - a;
+  if (x < 0) a = 3.14159265f - a;
+  return y < 0 ? -a : a;
+}
+
+void calculate_scara_angles(const float pos[2], float angles[2])
+{
+  float pSquared = sqr(pos[X_AXIS]) + sqr(pos[Y_AXIS]);
+  float p_inverse = 1 / sqrt(pSquared);
+  float rho = scara_atan2(pos[Y_AXIS], pos[X_AXIS]);
+  float D = scara_acos((pSquared + scara_theta_k) * (scara_theta_scale * p_inverse));
+  float C1 = scara_acos((pSquared + scara_psi_k) * (scara_psi_scale * p_inverse));
+
+  angles[X_AXIS] = (rho - D) * (float)SCARA_RAD2DEG;
+  angles[Y_AXIS] = (rho + C1) * (float)SCARA_RAD2DEG;
+}
+#elif defined(SCARA_IK_TABLE)
+// theta = rho - D and psi = rho + C1, with rho the direction of the nozzle from the tower and D and
+// C1 the angles the arms make with it, that only depend on how far out the nozzle is, p. The
+// tables hold D and C1 over the p of the bed and atan() over [0, 1], and the angles are cubics
+// through the 4 entries around the point. Close to full reach acos() gets too steep for them, so
+// the cells that are off by more than SCARA_IK_TABLE_TOLERANCE work D and C1 out with it instead.
+// The tables only depend on the arm lengths and SCARA_offset: M206 T P and M365 act around them.
+#define SCARA_IK_ATAN_TABLE 32
+
+static float scara_ik_d[SCARA_IK_TABLE], scara_ik_c1[SCARA_IK_TABLE];
+static float scara_ik_atan[SCARA_IK_ATAN_TABLE];
+static unsigned char scara_ik_exact[(SCARA_IK_TABLE + 6) / 8]; // A bit for each cell between entries
+static float scara_ik_p_min, scara_ik_p_step, scara_ik_p_scale;  // mm, mm and entries per mm
+
+// D and C1 with acos() for a nozzle p mm from the tower
+static void scara_ik_elbows(float p, float elbows[2])
+{
+  float pSquared = sqr(p);
+  elbows[0] = acos((sqr(LengthThetaExt) - sqr(LengthTheta) - pSquared) / (-2 * LengthTheta * p));
+  elbows[1] = acos((sqr(LengthPsiExt) - sqr(LengthPsi) - pSquared) / (-2 * LengthPsi * p));
+}
+
+// Cubic through the 4 entries around u, the position in the table in entries (Newton's forward
+// differences)
+static float scara_ik_interpolate(const float *table, int size, float u)
+{
+  int i = (int)u - 1;
+  if (i > size - 4) i = size - 4;
+  if (i < 0) i = 0;
+  float t = u - i;
+  float d1 = table[i + 1] - table[i];
+  float d2 = table[i + 2] - 2 * table[i + 1] + table[i];
+  float d3 = table[i + 3] - 3 * (table[i + 2] - table[i + 1]) - table[i];
+  return table[i] + t * (d1 + (t - 1) * (d2 * 0.5f + (t - 2) * d3 * (1.0f / 6)));
+}
+
+int scara_ik_table_build()
+{
+  // The nearest and the farthest the bed gets from the tower
+  float near_x = constrain(SCARA_offset_x, X_MIN_POS, X_MAX_POS) - SCARA_offset_x;
+  float near_y = constrain(SCARA_offset_y, Y_MIN_POS, Y_MAX_POS) - SCARA_offset_y;
+  float far_x = max(fabs(X_MIN_POS - SCARA_offset_x), fabs(X_MAX_POS - SCARA_offset_x));
+  float far_y = max(fabs(Y_MIN_POS - SCARA_offset_y), fabs(Y_MAX_POS - SCARA_offset_y));
+  scara_ik_p_min = sqrt(sqr(near_x) + sqr(near_y));
+  scara_ik_p_step = (sqrt(sqr(far_x) + sqr(far_y)) - scara_ik_p_min) / (SCARA_IK_TABLE - 1);
+  scara_ik_p_scale = 1 / scara_ik_p_step;
+
+  float elbows[2];
+  for (int i = 0; i < SCARA_IK_TABLE; i++) {
+    scara_ik_elbows(scara_ik_p_min + i * scara_ik_p_step, elbows);
+    scara_ik_d[i] = elbows[0];
+    scara_ik_c1[i] = elbows[1];
+  }
+  for (int i = 0; i < SCARA_IK_ATAN_TABLE; i++)
+    scara_ik_atan[i] = atan(i * (1.0 / (SCARA_IK_ATAN_TABLE - 1)));
+
+  // Check the cells a quarter, half and three quarters of the way through, a cubic is off the
+  // most in between its entries. NaN, the tower over the bed, goes to acos() too.
+  int exact = 0;
+  memset(scara_ik_exact, 0, sizeof(scara_ik_exact));
+  for (int cell = 0; cell < SCARA_IK_TABLE - 1; cell++) {
+    for (int quarter = 1; quarter < 4; quarter++) {
+      float u = cell + quarter * 0.25;
+      scara_ik_elbows(scara_ik_p_min + u * scara_ik_p_step, elbows);
+      if (!(fabs(scara_ik_interpolate(scara_ik_d, SCARA_IK_TABLE, u) - elbows[0]) <= SCARA_IK_TABLE_TOLERANCE) ||
+          !(fabs(scara_ik_interpolate(scara_ik_c1, SCARA_IK_TABLE, u) - elbows[1]) <= SCARA_IK_TABLE_TOLERANCE)) {
+        scara_ik_exact[cell >> 3] |= 1 << (cell & 7);
+        exact++;
+        break;
+      }
+    }
+  }
+  return exact;
+}
+
+void scara_ik_table_report()
+{
+  SERIAL_ECHO_START;
+  SERIAL_ECHOPAIR("IK table p ", scara_ik_p_min);
+  SERIAL_ECHOPAIR(" to ", scara_ik_p_min + (SCARA_IK_TABLE - 1) * scara_ik_p_step);
+  SERIAL_ECHOPAIR(" mm in ", (unsigned long)(SCARA_IK_TABLE - 1));
+  SERIAL_ECHOPGM(" cells, acos() in:");
+  for (int cell = 0; cell < SCARA_IK_TABLE - 1; cell++) {
+    if (scara_ik_exact[cell >> 3] & (1 << (cell & 7))) {
+      SERIAL_ECHOPAIR(" ", scara_ik_p_min + cell * scara_ik_p_step);
+      SERIAL_ECHOPAIR("-", scara_ik_p_min + (cell + 1) * scara_ik_p_step);
+    }
+  }
+  SERIAL_ECHOLN("");
+}
+
+void calculate_scara_angles(const float pos[2], float angles[2])
+{
+  float p = sqrt(sqr(pos[X_AXIS]) + sqr(pos[Y_AXIS]));
+
+  // rho from atan() on [0, 1] and the octant
+  float ax = fabs(pos[X_AXIS]), ay = fabs(pos[Y_AXIS]);
+  bool steep = ay > ax;
+  float rho = scara_ik_interpolate(scara_ik_atan, SCARA_IK_ATAN_TABLE,
+                                   (steep ? ax / ay : ay / ax) * (SCARA_IK_ATAN_TABLE - 1));
+  if (steep) rho = 1.57079633f - rho;
+  if (pos[X_AXIS] < 0) rho = 3.14159265f - rho;
+  if (pos[Y_AXIS] < 0) rho = -rho;
+
+  float elbows[2];
+  float u = (p - scara_ik_p_min) * scara_ik_p_scale;
+  int cell = u < SCARA_IK_TABLE - 2 ? (int)u : SCARA_IK_TABLE - 2;
+  if (u >= 0 && u <= SCARA_IK_TABLE - 1 && !(scara_ik_exact[cell >> 3] & (1 << (cell & 7)))) {
+    elbows[0] = scara_ik_interpolate(scara_ik_d, SCARA_IK_TABLE, u);
+    elbows[1] = scara_ik_interpolate(scara_ik_c1, SCARA_IK_TABLE, u);
+  }
+  else
+    scara_ik_elbows(p, elbows);
+
+  angles[X_AXIS] = (rho - elbows[0]) * (float)SCARA_RAD2DEG;
+  angles[Y_AXIS] = (rho + elbows[1]) * (float)SCARA_RAD2DEG;
+}
+#else
+void calculate_scara_angles(const float pos[2], float angles[2])
+{
+  float D, C1, p, rho; //, cos_rho;
   
-  rho = atan2(SCARA_pos[Y_AXIS], SCARA_pos[X_AXIS]);
+  rho = atan2(pos[Y_AXIS], pos[X_AXIS]);
   
   // Avoid divide by zero
 /*  cos_rho = cos(rho);
   if (cos_rho < 0.1)
-    p = SCARA_pos[Y_AXIS]/sin(rho);
+    p = pos[Y_AXIS]/sin(rho);
   else
-    p = SCARA_pos[X_AXIS]/cos_rho;
+    p = pos[X_AXIS]/cos_rho;
   */
 
-  float pSquared = sqr(SCARA_pos[X_AXIS]) + sqr(SCARA_pos[Y_AXIS]);
+  float pSquared = sqr(pos[X_AXIS]) + sqr(pos[Y_AXIS]);
   
   p = sqrt(pSquared);
   
@@ -2509,8 +2749,34 @@ void calculate_delta(float cartesian[3])
   D = acos((sqr(LengthThetaExt) - sqr(LengthTheta) - pSquared) / (-2 * LengthTheta * p));
   C1 = acos((sqr(LengthPsiExt) - sqr(LengthPsi) - pSquared) / (-2 * LengthPsi * p));
   
-  SCARA_theta = (rho - D) * SCARA_RAD2DEG - add_homeing[0];    // Convert to Angle in Degrees 
-  SCARA_psi = (rho + C1) * SCARA_RAD2DEG - add_homeing[1];     // Convert to Angle in Degrees 
+  angles[X_AXIS] = (rho - D) * SCARA_RAD2DEG;    // Convert to Angle in Degrees 
+  angles[Y_AXIS] = (rho + C1) * SCARA_RAD2DEG;   // Convert to Angle in Degrees 
+}
+#endif
+
+// Soft endstops on theta and psi
+#define MAX_THETA 150		
+#define MIN_THETA -50
+#define MAX_PSI 245
+#define MIN_PSI -30
+#define SMALLEST_DIFFERENCE_ANGLE 30	// Smallest angle between psi and theta
+
+void calculate_delta(float cartesian[3])
+{
+  // TODO Add scaling using axis_scaling[X_AXIS] and axis_scaling[Y_AXIS] to input on values to move commands (get_coordinates and all other functions manipulting destination)
+  
+  // SCARA "X" = theta
+  // SCARA "Y" = psi+theta, motor movement inverted.
+
+  float SCARA_pos[2], angles[2];
+  
+  SCARA_pos[X_AXIS] = (cartesian[X_AXIS] - SCARA_offset_x);  // Translate SCARA to standard X Y
+  SCARA_pos[Y_AXIS] = (cartesian[Y_AXIS] - SCARA_offset_y); 
+  
+  calculate_scara_angles(SCARA_pos, angles);
+  
+  SCARA_theta = angles[X_AXIS] - add_homeing[0];
+  SCARA_psi = angles[Y_AXIS] - add_homeing[1];
   
   if (SCARA_psi - SCARA_theta < SMALLEST_DIFFERENCE_ANGLE)
   {
@@ -2622,6 +2888,138 @@ float calc_bed_delta(float cartesian[3])
 }
 
 
+#ifdef SLOWDOWN
+static float segment_slowdown; // plan_slowdown_factor() when prepare_move() started on the move
+#endif
+
+// Plans a segment of the move prepare_move() is on, to the joint angles, E and mm at the tool
+static void plan_segment(const float joints[3], float e, float mm)
+{
+  // Waits for room here rather than in plan_buffer_line(), the LCD can stop the moves or change
+  // feedmultiply meanwhile
+  while (plan_buffer_full()) {
+    manage_heater();
+    manage_inactivity();
+    lcd_update();
+  }
+  if (moves_stopped) return;
+  float segment_feedrate = feedrate*feedmultiply/60/100.0;
+  #ifdef SLOWDOWN
+    segment_feedrate *= segment_slowdown;
+  #endif
+  plan_buffer_line(joints[X_AXIS], joints[Y_AXIS], joints[Z_AXIS], e, segment_feedrate,
+                   active_extruder, mm);
+}
+
+#ifdef KINEMATICS_STAGING
+// Segments whose joint angles are worked out, waiting for room in the buffer
+static struct {
+  float joints[3], e, mm;
+} staged_segments[KINEMATICS_STAGING];
+static unsigned char staged_first, staged_count;
+
+// Plans the oldest staged segment, waits in plan_segment() while the buffer is full
+static void plan_staged_segment()
+{
+  plan_segment(staged_segments[staged_first].joints, staged_segments[staged_first].e,
+               staged_segments[staged_first].mm);
+  if (moves_stopped) {
+    // Stopped while it waited, the staged segments go with the rest of the move
+    staged_count = 0;
+    return;
+  }
+  if (++staged_first == KINEMATICS_STAGING) staged_first = 0;
+  staged_count--;
+}
+
+// Stages the segment behind the others and plans as many as there is room for. Only waits for
+// the buffer once all the stages are taken, until then the caller goes on with the kinematics of
+// the next segments while the stepper interrupt works through the buffer.
+static void queue_segment(const float joints[3], float e, float mm)
+{
+  if (staged_count == KINEMATICS_STAGING) plan_staged_segment();
+  if (moves_stopped) return;
+  unsigned char i = staged_first + staged_count;
+  if (i >= KINEMATICS_STAGING) i -= KINEMATICS_STAGING;
+  for(int8_t j=0; j < 3; j++) {
+    staged_segments[i].joints[j] = joints[j];
+  }
+  staged_segments[i].e = e;
+  staged_segments[i].mm = mm;
+  staged_count++;
+  while (staged_count && !plan_buffer_full()) plan_staged_segment();
+  #ifdef MOTION_STATS
+    if (staged_count) motion_stats.kinematics_ahead++;
+  #endif
+}
+
+// Plans the segments still staged at the end of the move
+static void plan_staged_segments()
+{
+  while (staged_count) plan_staged_segment();
+}
+#else
+static void queue_segment(const float joints[3], float e, float mm)
+{
+  plan_segment(joints, e, mm);
+}
+#endif
+
+#ifdef SEGMENT_MAX_DEVIATION
+// The move prepare_move() is cutting into segments
+static float segment_start[NUM_AXIS], segment_difference[NUM_AXIS], segment_move_mm;
+
+// The point at fraction t of the move and its joint angles
+static void segment_point(float t, float point[NUM_AXIS], float joints[3])
+{
+  for(int8_t i=0; i < NUM_AXIS; i++) {
+    point[i] = segment_start[i] + segment_difference[i] * t;
+  }
+  calculate_delta(point);
+  for(int8_t i=0; i < 3; i++) {
+    joints[i] = delta[i];
+  }
+}
+
+// Plans the move from fraction t0 to t1, joints0 and joints1 are the angles there. The steppers
+// move the joints linearly along a block, which bends the line the most about halfway. Where the
+// nozzle gets more than SEGMENT_MAX_DEVIATION off the line there, the piece is cut into as many as
+// that takes, the deviation goes with the square of the length, and those are checked again.
+static void plan_segments(float t0, const float joints0[3], float t1, const float joints1[3])
+{
+  float mm = (t1 - t0) * segment_move_mm;
+  if (mm >= 2 * SEGMENT_MIN_LENGTH) {
+    float point[NUM_AXIS], joints[3], halfway[3];
+    segment_point((t0 + t1) / 2, point, joints);
+    halfway[X_AXIS] = (joints0[X_AXIS] + joints1[X_AXIS]) / 2 + add_homeing[X_AXIS];
+    halfway[Y_AXIS] = (joints0[Y_AXIS] + joints1[Y_AXIS]) / 2 + add_homeing[Y_AXIS];
+    calculate_forward(halfway);
+    float deviation = sqrt(sq(delta[X_AXIS] - point[X_AXIS]) + sq(delta[Y_AXIS] - point[Y_AXIS]));
+    if (deviation > SEGMENT_MAX_DEVIATION) {
+      int pieces = min(int(ceil(sqrt(deviation / SEGMENT_MAX_DEVIATION))), int(mm / SEGMENT_MIN_LENGTH));
+      pieces = max(pieces, 2);
+      float from[3], t_from = t0;
+      for(int8_t i=0; i < 3; i++) {
+        from[i] = joints0[i];
+      }
+      for (int s = 1; s < pieces; s++) {
+        float t = t0 + (t1 - t0) * s / pieces;
+        segment_point(t, point, joints);
+        plan_segments(t_from, from, t, joints);
+        if (moves_stopped) return;
+        for(int8_t i=0; i < 3; i++) {
+          from[i] = joints[i];
+        }
+        t_from = t;
+      }
+      plan_segments(t_from, from, t1, joints1);
+      return;
+    }
+  }
+  queue_segment(joints1, segment_start[E_AXIS] + segment_difference[E_AXIS] * t1, mm);
+}
+#endif
+
 void prepare_move()
 {
   
@@ -2646,6 +3044,27 @@ void prepare_move()
                             sq(difference[Z_AXIS]));
   if (cartesian_mm < 0.000001) { cartesian_mm = abs(difference[E_AXIS]); }
   if (cartesian_mm < 0.000001) { return; }
+  #ifdef SLOWDOWN
+    segment_slowdown = plan_slowdown_factor();
+  #endif
+#ifdef SEGMENT_MAX_DEVIATION
+  for(int8_t i=0; i < NUM_AXIS; i++) {
+    segment_start[i] = current_position[i];
+    segment_difference[i] = difference[i];
+  }
+  segment_move_mm = cartesian_mm;
+  int pieces = max(1, int(ceil(cartesian_mm / SEGMENT_MAX_LENGTH)));
+  float joints_from[3], joints_to[3];
+  segment_point(0, destination, joints_from);
+  for (int s = 1; s <= pieces; s++) {
+    segment_point(float(s) / pieces, destination, joints_to);
+    plan_segments(float(s - 1) / pieces, joints_from, float(s) / pieces, joints_to);
+    if (moves_stopped) return;
+    for(int8_t i=0; i < 3; i++) {
+      joints_from[i] = joints_to[i];
+    }
+  }
+#else
   float seconds = 6000 * cartesian_mm / feedrate / feedmultiply;
   int steps = max(1, int(DELTA_SEGMENTS_PER_SECOND * seconds));
   // SERIAL_ECHOPGM("mm="); SERIAL_ECHO(cartesian_mm);
@@ -2653,6 +3072,7 @@ void prepare_move()
   // SERIAL_ECHOPGM(" steps="); SERIAL_ECHOLN(steps);
   float fraction_steps = 1.0 / float(steps);
   float fraction = fraction_steps;
+  float segment_mm = cartesian_mm * fraction_steps; // Tool distance per segment, see plan_buffer_line()
   for (int s = 1; s <= steps; s++) {
     for(int8_t i=0; i < NUM_AXIS; i++) {
       destination[i] = current_position[i] + difference[i] * (fraction_steps * s);
@@ -2662,12 +3082,16 @@ void prepare_move()
 //    SERIAL_ECHOPGM(" y="); SERIAL_ECHOLN(destination[Y_AXIS]);
     
     calculate_delta(destination);
-    plan_buffer_line(delta[X_AXIS], delta[Y_AXIS], delta[Z_AXIS],
-                     destination[E_AXIS], feedrate*feedmultiply/60/100.0,
-                     active_extruder);
+    queue_segment(delta, destination[E_AXIS], segment_mm);
+    if (moves_stopped) return;
 
     fraction += fraction_steps;
   }
+#endif
+#ifdef KINEMATICS_STAGING
+  plan_staged_segments();
+  if (moves_stopped) return;
+#endif
   
    
   for(int8_t i=0; i < NUM_AXIS; i++) {
@@ -2675,11 +3099,20 @@ void prepare_move()
   }
 }
 
+void prepare_move_to(const float target[NUM_AXIS])
+{
+  for(int8_t i=0; i < NUM_AXIS; i++) {
+    destination[i] = target[i];
+  }
+  prepare_move();
+}
+
 void prepare_arc_move(char isclockwise) {
   float r = hypot(offset[X_AXIS], offset[Y_AXIS]); // Compute arc radius for mc_arc
 
-  // Trace the arc
-  mc_arc(current_position, destination, offset, X_AXIS, Y_AXIS, Z_AXIS, feedrate*feedmultiply/60/100.0, r, isclockwise, active_extruder);
+  // Trace the arc, mc_arc() hands the points to prepare_move() for the kinematics
+  mc_arc(current_position, destination, offset, X_AXIS, Y_AXIS, Z_AXIS, r, isclockwise);
+  if (moves_stopped) return;
   
   // As far as the parser is concerned, the position is now == target. In reality the
   // motion control system might still be processing the action and the real tool position
@@ -2690,6 +3123,49 @@ void prepare_arc_move(char isclockwise) {
   previous_millis_cmd = millis();
 }
 
+// Stops the moves in the buffer as fast as the acceleration allows and takes the position from
+// where the arms came to a stop. The planner works in the angles calculate_delta() makes, the
+// forward kinematics turn the ones the steppers counted back into X and Y.
+void stop_moves()
+{
+  moves_stopped = true;
+  st_stop();
+  float angles[3], joints[3];
+  for (int8_t i = 0; i < 3; i++) {
+    angles[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+  }
+  joints[X_AXIS] = angles[X_AXIS] + add_homeing[X_AXIS];
+  joints[Y_AXIS] = angles[Y_AXIS] + add_homeing[Y_AXIS];
+  joints[Z_AXIS] = angles[Z_AXIS];
+  calculate_forward(joints);
+  current_position[X_AXIS] = delta[X_AXIS];
+  current_position[Y_AXIS] = delta[Y_AXIS];
+  current_position[Z_AXIS] = angles[Z_AXIS];
+  if (!Y_gridcal) {
+    current_position[Z_AXIS] -= calc_bed_delta(current_position);
+  }
+  current_position[E_AXIS] = (float)st_get_position(E_AXIS) / axis_steps_per_unit[E_AXIS];
+  for (int8_t i = 0; i < 3; i++) {
+    delta[i] = angles[i];
+  }
+  plan_set_position(angles[X_AXIS], angles[Y_AXIS], angles[Z_AXIS], current_position[E_AXIS]);
+}
+
+#ifdef BABYSTEPPING
+// The planner and the step counters never see the baby-steps. The home offset takes them over on
+// M290 H: G28 then sets a Z that is off by them the other way, and the moves after it go to where
+// they went with the baby-steps.
+void babystep_z(float mm)
+{
+  babystep_z_steps += st_babystep_z(lround(mm * axis_steps_per_unit[Z_AXIS]));
+}
+
+float babystep_z_offset()
+{
+  return babystep_z_steps / axis_steps_per_unit[Z_AXIS];
+}
+#endif
+
 #ifdef CONTROLLERFAN_PIN
 unsigned long lastMotor = 0; //Save the time for when a motor was turned on last
 unsigned long lastMotorCheck = 0;
@@ -2726,6 +3202,9 @@ void controllerFan()
 
 void manage_inactivity() 
 { 
+  #ifdef STEP_SEGMENT_BUFFER
+    st_prepare_segments();
+  #endif
   if( (millis() - previous_millis_cmd) >  max_inactive_time ) 
     if(max_inactive_time) 
       kill(); 
@@ -942,6 +942,11 @@ pins
 #define	SCL					DIO21
 #define	SDA					DIO20
 
+// external interrupts (INTn) and pin change interrupts (PCINTn_vect, bit in PCMSKn), -1 for none
+#define	DIO_EXT_INTERRUPT(IO)	((IO) == 21 ? 0 : (IO) == 20 ? 1 : (IO) == 19 ? 2 : (IO) == 18 ? 3 : (IO) == 2 ? 4 : (IO) == 3 ? 5 : -1)
+#define	DIO_PCINT_BANK(IO)		(((IO) >= 10 && (IO) <= 13) || ((IO) >= 50 && (IO) <= 53) ? 0 : (IO) == 14 || (IO) == 15 ? 1 : (IO) >= 62 && (IO) <= 69 ? 2 : -1)
+#define	DIO_PCINT_BIT(IO)		((IO) >= 62 ? (IO) - 62 : (IO) >= 50 ? 53 - (IO) : (IO) >= 14 ? 16 - (IO) : (IO) - 6)
+
 // timers and PWM
 #define	OC0A				DIO13
 #define	OC0B				DIO4
@@ -0,0 +1,12 @@
+// Host simulator stand-in for the Arduino Print base class, see sim_avr.h
+#ifndef HOSTSIM_PRINT_H
+#define HOSTSIM_PRINT_H
+#include "sim_avr.h"
+
+class Print
+{
+  public:
+    virtual void write(uint8_t) = 0;
+};
+
+#endif
@@ -0,0 +1,1048 @@
+; Benchmark part for marlin_sim bench: a 30 mm ring with a 8 mm hole,
+; two perimeters and zig-zag infill, two layers. Dense short segments
+; like sliced curved parts, plus the long infill moves between them.
+G28
+G1 Z5 F6000
+G1 Z5.20 F6000
+G1 X115.000 Y130.000 F6000
+G1 X114.988 Y130.600 E0.0240 F1800
+G1 X114.952 Y131.199 E0.0480
+G1 X114.892 Y131.797 E0.0720
+G1 X114.808 Y132.391 E0.0960
+G1 X114.701 Y132.982 E0.1201
+G1 X114.570 Y133.567 E0.1441
+G1 X114.415 Y134.147 E0.1681
+G1 X114.238 Y134.721 E0.1921
+G1 X114.037 Y135.287 E0.2161
+G1 X113.815 Y135.844 E0.2401
+G1 X113.570 Y136.392 E0.2641
+G1 X113.303 Y136.930 E0.2881
+G1 X113.015 Y137.457 E0.3121
+G1 X112.707 Y137.971 E0.3361
+G1 X112.377 Y138.473 E0.3602
+G1 X112.029 Y138.962 E0.3842
+G1 X111.660 Y139.436 E0.4082
+G1 X111.273 Y139.895 E0.4322
+G1 X110.869 Y140.338 E0.4562
+G1 X110.446 Y140.765 E0.4802
+G1 X110.007 Y141.174 E0.5042
+G1 X109.552 Y141.565 E0.5282
+G1 X109.082 Y141.938 E0.5522
+G1 X108.597 Y142.292 E0.5763
+G1 X108.098 Y142.626 E0.6003
+G1 X107.586 Y142.940 E0.6243
+G1 X107.063 Y143.233 E0.6483
+G1 X106.528 Y143.505 E0.6723
+G1 X105.982 Y143.756 E0.6963
+G1 X105.427 Y143.984 E0.7203
+G1 X104.863 Y144.190 E0.7443
+G1 X104.291 Y144.373 E0.7683
+G1 X103.713 Y144.533 E0.7923
+G1 X103.128 Y144.670 E0.8164
+G1 X102.539 Y144.784 E0.8404
+G1 X101.945 Y144.873 E0.8644
+G1 X101.349 Y144.939 E0.8884
+G1 X100.750 Y144.981 E0.9124
+G1 X100.150 Y144.999 E0.9364
+G1 X99.550 Y144.993 E0.9604
+G1 X98.950 Y144.963 E0.9844
+G1 X98.352 Y144.909 E1.0084
+G1 X97.757 Y144.831 E1.0325
+G1 X97.166 Y144.730 E1.0565
+G1 X96.579 Y144.605 E1.0805
+G1 X95.997 Y144.456 E1.1045
+G1 X95.422 Y144.284 E1.1285
+G1 X94.854 Y144.090 E1.1525
+G1 X94.294 Y143.873 E1.1765
+G1 X93.744 Y143.633 E1.2005
+G1 X93.204 Y143.372 E1.2245
+G1 X92.674 Y143.089 E1.2485
+G1 X92.156 Y142.786 E1.2726
+G1 X91.651 Y142.462 E1.2966
+G1 X91.159 Y142.118 E1.3206
+G1 X90.681 Y141.754 E1.3446
+G1 X90.218 Y141.372 E1.3686
+G1 X89.771 Y140.971 E1.3926
+G1 X89.340 Y140.553 E1.4166
+G1 X88.927 Y140.118 E1.4406
+G1 X88.531 Y139.667 E1.4646
+G1 X88.153 Y139.201 E1.4887
+G1 X87.795 Y138.719 E1.5127
+G1 X87.455 Y138.224 E1.5367
+G1 X87.136 Y137.716 E1.5607
+G1 X86.838 Y137.195 E1.5847
+G1 X86.561 Y136.662 E1.6087
+G1 X86.305 Y136.119 E1.6327
+G1 X86.071 Y135.566 E1.6567
+G1 X85.860 Y135.005 E1.6807
+G1 X85.671 Y134.435 E1.7048
+G1 X85.505 Y133.858 E1.7288
+G1 X85.362 Y133.275 E1.7528
+G1 X85.243 Y132.687 E1.7768
+G1 X85.147 Y132.094 E1.8008
+G1 X85.075 Y131.498 E1.8248
+G1 X85.027 Y130.900 E1.8488
+G1 X85.003 Y130.300 E1.8728
+G1 X85.003 Y129.700 E1.8968
+G1 X85.027 Y129.100 E1.9208
+G1 X85.075 Y128.502 E1.9449
+G1 X85.147 Y127.906 E1.9689
+G1 X85.243 Y127.313 E1.9929
+G1 X85.362 Y126.725 E2.0169
+G1 X85.505 Y126.142 E2.0409
+G1 X85.671 Y125.565 E2.0649
+G1 X85.860 Y124.995 E2.0889
+G1 X86.071 Y124.434 E2.1129
+G1 X86.305 Y123.881 E2.1369
+G1 X86.561 Y123.338 E2.1610
+G1 X86.838 Y122.805 E2.1850
+G1 X87.136 Y122.284 E2.2090
+G1 X87.455 Y121.776 E2.2330
+G1 X87.795 Y121.281 E2.2570
+G1 X88.153 Y120.799 E2.2810
+G1 X88.531 Y120.333 E2.3050
+G1 X88.927 Y119.882 E2.3290
+G1 X89.340 Y119.447 E2.3530
+G1 X89.771 Y119.029 E2.3770
+G1 X90.218 Y118.628 E2.4011
+G1 X90.681 Y118.246 E2.4251
+G1 X91.159 Y117.882 E2.4491
+G1 X91.651 Y117.538 E2.4731
+G1 X92.156 Y117.214 E2.4971
+G1 X92.674 Y116.911 E2.5211
+G1 X93.204 Y116.628 E2.5451
+G1 X93.744 Y116.367 E2.5691
+G1 X94.294 Y116.127 E2.5931
+G1 X94.854 Y115.910 E2.6172
+G1 X95.422 Y115.716 E2.6412
+G1 X95.997 Y115.544 E2.6652
+G1 X96.579 Y115.395 E2.6892
+G1 X97.166 Y115.270 E2.7132
+G1 X97.757 Y115.169 E2.7372
+G1 X98.352 Y115.091 E2.7612
+G1 X98.950 Y115.037 E2.7852
+G1 X99.550 Y115.007 E2.8092
+G1 X100.150 Y115.001 E2.8332
+G1 X100.750 Y115.019 E2.8573
+G1 X101.349 Y115.061 E2.8813
+G1 X101.945 Y115.127 E2.9053
+G1 X102.539 Y115.216 E2.9293
+G1 X103.128 Y115.330 E2.9533
+G1 X103.713 Y115.467 E2.9773
+G1 X104.291 Y115.627 E3.0013
+G1 X104.863 Y115.810 E3.0253
+G1 X105.427 Y116.016 E3.0493
+G1 X105.982 Y116.244 E3.0734
+G1 X106.528 Y116.495 E3.0974
+G1 X107.063 Y116.767 E3.1214
+G1 X107.586 Y117.060 E3.1454
+G1 X108.098 Y117.374 E3.1694
+G1 X108.597 Y117.708 E3.1934
+G1 X109.082 Y118.062 E3.2174
+G1 X109.552 Y118.435 E3.2414
+G1 X110.007 Y118.826 E3.2654
+G1 X110.446 Y119.235 E3.2894
+G1 X110.869 Y119.662 E3.3135
+G1 X111.273 Y120.105 E3.3375
+G1 X111.660 Y120.564 E3.3615
+G1 X112.029 Y121.038 E3.3855
+G1 X112.377 Y121.527 E3.4095
+G1 X112.707 Y122.029 E3.4335
+G1 X113.015 Y122.543 E3.4575
+G1 X113.303 Y123.070 E3.4815
+G1 X113.570 Y123.608 E3.5055
+G1 X113.815 Y124.156 E3.5296
+G1 X114.037 Y124.713 E3.5536
+G1 X114.238 Y125.279 E3.5776
+G1 X114.415 Y125.853 E3.6016
+G1 X114.570 Y126.433 E3.6256
+G1 X114.701 Y127.018 E3.6496
+G1 X114.808 Y127.609 E3.6736
+G1 X114.892 Y128.203 E3.6976
+G1 X114.952 Y128.801 E3.7216
+G1 X114.988 Y129.400 E3.7456
+G1 X115.000 Y130.000 E3.7697
+G1 X114.600 Y130.000 F6000
+G1 X114.588 Y130.603 E3.7938 F1800
+G1 X114.550 Y131.206 E3.8179
+G1 X114.488 Y131.806 E3.8421
+G1 X114.401 Y132.403 E3.8662
+G1 X114.289 Y132.996 E3.8904
+G1 X114.153 Y133.584 E3.9145
+G1 X113.993 Y134.166 E3.9386
+G1 X113.809 Y134.741 E3.9628
+G1 X113.601 Y135.307 E3.9869
+G1 X113.370 Y135.865 E4.0110
+G1 X113.117 Y136.412 E4.0352
+G1 X112.840 Y136.949 E4.0593
+G1 X112.542 Y137.474 E4.0835
+G1 X112.223 Y137.985 E4.1076
+G1 X111.882 Y138.484 E4.1317
+G1 X111.521 Y138.968 E4.1559
+G1 X111.141 Y139.436 E4.1800
+G1 X110.742 Y139.888 E4.2042
+G1 X110.324 Y140.324 E4.2283
+G1 X109.888 Y140.742 E4.2524
+G1 X109.436 Y141.141 E4.2766
+G1 X108.968 Y141.521 E4.3007
+G1 X108.484 Y141.882 E4.3249
+G1 X107.985 Y142.223 E4.3490
+G1 X107.474 Y142.542 E4.3731
+G1 X106.949 Y142.840 E4.3973
+G1 X106.412 Y143.117 E4.4214
+G1 X105.865 Y143.370 E4.4455
+G1 X105.307 Y143.601 E4.4697
+G1 X104.741 Y143.809 E4.4938
+G1 X104.166 Y143.993 E4.5180
+G1 X103.584 Y144.153 E4.5421
+G1 X102.996 Y144.289 E4.5662
+G1 X102.403 Y144.401 E4.5904
+G1 X101.806 Y144.488 E4.6145
+G1 X101.206 Y144.550 E4.6387
+G1 X100.603 Y144.588 E4.6628
+G1 X100.000 Y144.600 E4.6869
+G1 X99.397 Y144.588 E4.7111
+G1 X98.794 Y144.550 E4.7352
+G1 X98.194 Y144.488 E4.7594
+G1 X97.597 Y144.401 E4.7835
+G1 X97.004 Y144.289 E4.8076
+G1 X96.416 Y144.153 E4.8318
+G1 X95.834 Y143.993 E4.8559
+G1 X95.259 Y143.809 E4.8801
+G1 X94.693 Y143.601 E4.9042
+G1 X94.135 Y143.370 E4.9283
+G1 X93.588 Y143.117 E4.9525
+G1 X93.051 Y142.840 E4.9766
+G1 X92.526 Y142.542 E5.0007
+G1 X92.015 Y142.223 E5.0249
+G1 X91.516 Y141.882 E5.0490
+G1 X91.032 Y141.521 E5.0732
+G1 X90.564 Y141.141 E5.0973
+G1 X90.112 Y140.742 E5.1214
+G1 X89.676 Y140.324 E5.1456
+G1 X89.258 Y139.888 E5.1697
+G1 X88.859 Y139.436 E5.1939
+G1 X88.479 Y138.968 E5.2180
+G1 X88.118 Y138.484 E5.2421
+G1 X87.777 Y137.985 E5.2663
+G1 X87.458 Y137.474 E5.2904
+G1 X87.160 Y136.949 E5.3146
+G1 X86.883 Y136.412 E5.3387
+G1 X86.630 Y135.865 E5.3628
+G1 X86.399 Y135.307 E5.3870
+G1 X86.191 Y134.741 E5.4111
+G1 X86.007 Y134.166 E5.4352
+G1 X85.847 Y133.584 E5.4594
+G1 X85.711 Y132.996 E5.4835
+G1 X85.599 Y132.403 E5.5077
+G1 X85.512 Y131.806 E5.5318
+G1 X85.450 Y131.206 E5.5559
+G1 X85.412 Y130.603 E5.5801
+G1 X85.400 Y130.000 E5.6042
+G1 X85.412 Y129.397 E5.6284
+G1 X85.450 Y128.794 E5.6525
+G1 X85.512 Y128.194 E5.6766
+G1 X85.599 Y127.597 E5.7008
+G1 X85.711 Y127.004 E5.7249
+G1 X85.847 Y126.416 E5.7491
+G1 X86.007 Y125.834 E5.7732
+G1 X86.191 Y125.259 E5.7973
+G1 X86.399 Y124.693 E5.8215
+G1 X86.630 Y124.135 E5.8456
+G1 X86.883 Y123.588 E5.8697
+G1 X87.160 Y123.051 E5.8939
+G1 X87.458 Y122.526 E5.9180
+G1 X87.777 Y122.015 E5.9422
+G1 X88.118 Y121.516 E5.9663
+G1 X88.479 Y121.032 E5.9904
+G1 X88.859 Y120.564 E6.0146
+G1 X89.258 Y120.112 E6.0387
+G1 X89.676 Y119.676 E6.0629
+G1 X90.112 Y119.258 E6.0870
+G1 X90.564 Y118.859 E6.1111
+G1 X91.032 Y118.479 E6.1353
+G1 X91.516 Y118.118 E6.1594
+G1 X92.015 Y117.777 E6.1836
+G1 X92.526 Y117.458 E6.2077
+G1 X93.051 Y117.160 E6.2318
+G1 X93.588 Y116.883 E6.2560
+G1 X94.135 Y116.630 E6.2801
+G1 X94.693 Y116.399 E6.3042
+G1 X95.259 Y116.191 E6.3284
+G1 X95.834 Y116.007 E6.3525
+G1 X96.416 Y115.847 E6.3767
+G1 X97.004 Y115.711 E6.4008
+G1 X97.597 Y115.599 E6.4249
+G1 X98.194 Y115.512 E6.4491
+G1 X98.794 Y115.450 E6.4732
+G1 X99.397 Y115.412 E6.4974
+G1 X100.000 Y115.400 E6.5215
+G1 X100.603 Y115.412 E6.5456
+G1 X101.206 Y115.450 E6.5698
+G1 X101.806 Y115.512 E6.5939
+G1 X102.403 Y115.599 E6.6181
+G1 X102.996 Y115.711 E6.6422
+G1 X103.584 Y115.847 E6.6663
+G1 X104.166 Y116.007 E6.6905
+G1 X104.741 Y116.191 E6.7146
+G1 X105.307 Y116.399 E6.7387
+G1 X105.865 Y116.630 E6.7629
+G1 X106.412 Y116.883 E6.7870
+G1 X106.949 Y117.160 E6.8112
+G1 X107.474 Y117.458 E6.8353
+G1 X107.985 Y117.777 E6.8594
+G1 X108.484 Y118.118 E6.8836
+G1 X108.968 Y118.479 E6.9077
+G1 X109.436 Y118.859 E6.9319
+G1 X109.888 Y119.258 E6.9560
+G1 X110.324 Y119.676 E6.9801
+G1 X110.742 Y120.112 E7.0043
+G1 X111.141 Y120.564 E7.0284
+G1 X111.521 Y121.032 E7.0526
+G1 X111.882 Y121.516 E7.0767
+G1 X112.223 Y122.015 E7.1008
+G1 X112.542 Y122.526 E7.1250
+G1 X112.840 Y123.051 E7.1491
+G1 X113.117 Y123.588 E7.1733
+G1 X113.370 Y124.135 E7.1974
+G1 X113.601 Y124.693 E7.2215
+G1 X113.809 Y125.259 E7.2457
+G1 X113.993 Y125.834 E7.2698
+G1 X114.153 Y126.416 E7.2939
+G1 X114.289 Y127.004 E7.3181
+G1 X114.401 Y127.597 E7.3422
+G1 X114.488 Y128.194 E7.3664
+G1 X114.550 Y128.794 E7.3905
+G1 X114.588 Y129.397 E7.4146
+G1 X114.600 Y130.000 E7.4388
+G1 X104.000 Y130.000 F6000
+G1 X103.979 Y130.405 E7.4550 F1800
+G1 X103.918 Y130.805 E7.4712
+G1 X103.817 Y131.197 E7.4874
+G1 X103.676 Y131.577 E7.5036
+G1 X103.497 Y131.941 E7.5198
+G1 X103.283 Y132.285 E7.5360
+G1 X103.035 Y132.605 E7.5522
+G1 X102.756 Y132.899 E7.5684
+G1 X102.448 Y133.163 E7.5846
+G1 X102.116 Y133.395 E7.6009
+G1 X101.762 Y133.591 E7.6171
+G1 X101.389 Y133.751 E7.6333
+G1 X101.003 Y133.872 E7.6495
+G1 X100.606 Y133.954 E7.6657
+G1 X100.203 Y133.995 E7.6819
+G1 X99.797 Y133.995 E7.6981
+G1 X99.394 Y133.954 E7.7143
+G1 X98.997 Y133.872 E7.7305
+G1 X98.611 Y133.751 E7.7467
+G1 X98.238 Y133.591 E7.7629
+G1 X97.884 Y133.395 E7.7791
+G1 X97.552 Y133.163 E7.7953
+G1 X97.244 Y132.899 E7.8116
+G1 X96.965 Y132.605 E7.8278
+G1 X96.717 Y132.285 E7.8440
+G1 X96.503 Y131.941 E7.8602
+G1 X96.324 Y131.577 E7.8764
+G1 X96.183 Y131.197 E7.8926
+G1 X96.082 Y130.805 E7.9088
+G1 X96.021 Y130.405 E7.9250
+G1 X96.000 Y130.000 E7.9412
+G1 X96.021 Y129.595 E7.9574
+G1 X96.082 Y129.195 E7.9736
+G1 X96.183 Y128.803 E7.9898
+G1 X96.324 Y128.423 E8.0060
+G1 X96.503 Y128.059 E8.0223
+G1 X96.717 Y127.715 E8.0385
+G1 X96.965 Y127.395 E8.0547
+G1 X97.244 Y127.101 E8.0709
+G1 X97.552 Y126.837 E8.0871
+G1 X97.884 Y126.605 E8.1033
+G1 X98.238 Y126.409 E8.1195
+G1 X98.611 Y126.249 E8.1357
+G1 X98.997 Y126.128 E8.1519
+G1 X99.394 Y126.046 E8.1681
+G1 X99.797 Y126.005 E8.1843
+G1 X100.203 Y126.005 E8.2005
+G1 X100.606 Y126.046 E8.2167
+G1 X101.003 Y126.128 E8.2330
+G1 X101.389 Y126.249 E8.2492
+G1 X101.762 Y126.409 E8.2654
+G1 X102.116 Y126.605 E8.2816
+G1 X102.448 Y126.837 E8.2978
+G1 X102.756 Y127.101 E8.3140
+G1 X103.035 Y127.395 E8.3302
+G1 X103.283 Y127.715 E8.3464
+G1 X103.497 Y128.059 E8.3626
+G1 X103.676 Y128.423 E8.3788
+G1 X103.817 Y128.803 E8.3950
+G1 X103.918 Y129.195 E8.4112
+G1 X103.979 Y129.595 E8.4275
+G1 X104.000 Y130.000 E8.4437
+G1 X104.400 Y130.000 F6000
+G1 X104.382 Y130.400 E8.4597 F1800
+G1 X104.327 Y130.797 E8.4757
+G1 X104.237 Y131.187 E8.4917
+G1 X104.111 Y131.567 E8.5077
+G1 X103.952 Y131.935 E8.5238
+G1 X103.759 Y132.286 E8.5398
+G1 X103.536 Y132.619 E8.5558
+G1 X103.283 Y132.929 E8.5718
+G1 X103.003 Y133.216 E8.5878
+G1 X102.698 Y133.475 E8.6039
+G1 X102.371 Y133.706 E8.6199
+G1 X102.024 Y133.907 E8.6359
+G1 X101.661 Y134.075 E8.6519
+G1 X101.283 Y134.209 E8.6680
+G1 X100.895 Y134.308 E8.6840
+G1 X100.500 Y134.372 E8.7000
+G1 X100.100 Y134.399 E8.7160
+G1 X99.700 Y134.390 E8.7320
+G1 X99.302 Y134.344 E8.7481
+G1 X98.910 Y134.263 E8.7641
+G1 X98.527 Y134.146 E8.7801
+G1 X98.156 Y133.995 E8.7961
+G1 X97.800 Y133.811 E8.8121
+G1 X97.463 Y133.595 E8.8282
+G1 X97.146 Y133.349 E8.8442
+G1 X96.854 Y133.076 E8.8602
+G1 X96.587 Y132.777 E8.8762
+G1 X96.349 Y132.455 E8.8922
+G1 X96.140 Y132.113 E8.9083
+G1 X95.964 Y131.753 E8.9243
+G1 X95.822 Y131.379 E8.9403
+G1 X95.714 Y130.993 E8.9563
+G1 X95.641 Y130.599 E8.9724
+G1 X95.605 Y130.200 E8.9884
+G1 X95.605 Y129.800 E9.0044
+G1 X95.641 Y129.401 E9.0204
+G1 X95.714 Y129.007 E9.0364
+G1 X95.822 Y128.621 E9.0525
+G1 X95.964 Y128.247 E9.0685
+G1 X96.140 Y127.887 E9.0845
+G1 X96.349 Y127.545 E9.1005
+G1 X96.587 Y127.223 E9.1165
+G1 X96.854 Y126.924 E9.1326
+G1 X97.146 Y126.651 E9.1486
+G1 X97.463 Y126.405 E9.1646
+G1 X97.800 Y126.189 E9.1806
+G1 X98.156 Y126.005 E9.1967
+G1 X98.527 Y125.854 E9.2127
+G1 X98.910 Y125.737 E9.2287
+G1 X99.302 Y125.656 E9.2447
+G1 X99.700 Y125.610 E9.2607
+G1 X100.100 Y125.601 E9.2768
+G1 X100.500 Y125.628 E9.2928
+G1 X100.895 Y125.692 E9.3088
+G1 X101.283 Y125.791 E9.3248
+G1 X101.661 Y125.925 E9.3408
+G1 X102.024 Y126.093 E9.3569
+G1 X102.371 Y126.294 E9.3729
+G1 X102.698 Y126.525 E9.3889
+G1 X103.003 Y126.784 E9.4049
+G1 X103.283 Y127.071 E9.4209
+G1 X103.536 Y127.381 E9.4370
+G1 X103.759 Y127.714 E9.4530
+G1 X103.952 Y128.065 E9.4690
+G1 X104.111 Y128.433 E9.4850
+G1 X104.237 Y128.813 E9.5011
+G1 X104.327 Y129.203 E9.5171
+G1 X104.382 Y129.600 E9.5331
+G1 X104.400 Y130.000 E9.5491
+G1 X100.000 Y115.800 F6000
+G1 X100.000 Y115.800 E9.5491 F2400
+G1 X105.235 Y116.800 F6000
+G1 X94.765 Y116.800 E9.9679 F2400
+G1 X92.734 Y117.800 F6000
+G1 X107.266 Y117.800 E10.5492 F2400
+G1 X108.729 Y118.800 F6000
+G1 X91.271 Y118.800 E11.2475 F2400
+G1 X90.121 Y119.800 F6000
+G1 X109.879 Y119.800 E12.0379 F2400
+G1 X110.817 Y120.800 F6000
+G1 X89.183 Y120.800 E12.9032 F2400
+G1 X88.407 Y121.800 F6000
+G1 X111.593 Y121.800 E13.8306 F2400
+G1 X112.239 Y122.800 F6000
+G1 X87.761 Y122.800 E14.8098 F2400
+G1 X87.225 Y123.800 F6000
+G1 X112.775 Y123.800 E15.8318 F2400
+G1 X113.214 Y124.800 F6000
+G1 X86.786 Y124.800 E16.8889 F2400
+G1 X86.435 Y125.800 F6000
+G1 X97.676 Y125.800 E17.3385 F2400
+G1 X102.324 Y125.800 F6000
+G1 X113.565 Y125.800 E17.7881 F2400
+G1 X113.835 Y126.800 F6000
+G1 X103.578 Y126.800 E18.1984 F2400
+G1 X96.422 Y126.800 F6000
+G1 X86.165 Y126.800 E18.6087 F2400
+G1 X85.971 Y127.800 F6000
+G1 X95.734 Y127.800 E18.9992 F2400
+G1 X104.266 Y127.800 F6000
+G1 X114.029 Y127.800 E19.3897 F2400
+G1 X114.149 Y128.800 F6000
+G1 X104.648 Y128.800 E19.7698 F2400
+G1 X95.352 Y128.800 F6000
+G1 X85.851 Y128.800 E20.1498 F2400
+G1 X85.801 Y129.800 F6000
+G1 X95.204 Y129.800 E20.5259 F2400
+G1 X104.796 Y129.800 F6000
+G1 X114.199 Y129.800 E20.9021 F2400
+G1 X114.177 Y130.800 F6000
+G1 X104.733 Y130.800 E21.2798 F2400
+G1 X95.267 Y130.800 F6000
+G1 X85.823 Y130.800 E21.6576 F2400
+G1 X85.915 Y131.800 F6000
+G1 X95.550 Y131.800 E22.0431 F2400
+G1 X104.450 Y131.800 F6000
+G1 X114.085 Y131.800 E22.4285 F2400
+G1 X113.921 Y132.800 F6000
+G1 X103.899 Y132.800 E22.8294 F2400
+G1 X96.101 Y132.800 F6000
+G1 X86.079 Y132.800 E23.2303 F2400
+G1 X86.318 Y133.800 F6000
+G1 X97.067 Y133.800 E23.6603 F2400
+G1 X102.933 Y133.800 F6000
+G1 X113.682 Y133.800 E24.0902 F2400
+G1 X113.364 Y134.800 F6000
+G1 X86.636 Y134.800 E25.1594 F2400
+G1 X87.039 Y135.800 F6000
+G1 X112.961 Y135.800 E26.1963 F2400
+G1 X112.466 Y136.800 F6000
+G1 X87.534 Y136.800 E27.1936 F2400
+G1 X88.134 Y137.800 F6000
+G1 X111.866 Y137.800 E28.1428 F2400
+G1 X111.145 Y138.800 F6000
+G1 X88.855 Y138.800 E29.0344 F2400
+G1 X89.724 Y139.800 F6000
+G1 X110.276 Y139.800 E29.8565 F2400
+G1 X109.220 Y140.800 F6000
+G1 X90.780 Y140.800 E30.5941 F2400
+G1 X92.101 Y141.800 F6000
+G1 X107.899 Y141.800 E31.2260 F2400
+G1 X106.148 Y142.800 F6000
+G1 X93.852 Y142.800 E31.7179 F2400
+G1 X96.653 Y143.800 F6000
+G1 X103.347 Y143.800 E31.9856 F2400
+G1 Z5.40 F6000
+G1 X115.000 Y130.000 F6000
+G1 X114.988 Y130.600 E32.0096 F1800
+G1 X114.952 Y131.199 E32.0336
+G1 X114.892 Y131.797 E32.0576
+G1 X114.808 Y132.391 E32.0816
+G1 X114.701 Y132.982 E32.1056
+G1 X114.570 Y133.567 E32.1297
+G1 X114.415 Y134.147 E32.1537
+G1 X114.238 Y134.721 E32.1777
+G1 X114.037 Y135.287 E32.2017
+G1 X113.815 Y135.844 E32.2257
+G1 X113.570 Y136.392 E32.2497
+G1 X113.303 Y136.930 E32.2737
+G1 X113.015 Y137.457 E32.2977
+G1 X112.707 Y137.971 E32.3217
+G1 X112.377 Y138.473 E32.3458
+G1 X112.029 Y138.962 E32.3698
+G1 X111.660 Y139.436 E32.3938
+G1 X111.273 Y139.895 E32.4178
+G1 X110.869 Y140.338 E32.4418
+G1 X110.446 Y140.765 E32.4658
+G1 X110.007 Y141.174 E32.4898
+G1 X109.552 Y141.565 E32.5138
+G1 X109.082 Y141.938 E32.5378
+G1 X108.597 Y142.292 E32.5618
+G1 X108.098 Y142.626 E32.5859
+G1 X107.586 Y142.940 E32.6099
+G1 X107.063 Y143.233 E32.6339
+G1 X106.528 Y143.505 E32.6579
+G1 X105.982 Y143.756 E32.6819
+G1 X105.427 Y143.984 E32.7059
+G1 X104.863 Y144.190 E32.7299
+G1 X104.291 Y144.373 E32.7539
+G1 X103.713 Y144.533 E32.7779
+G1 X103.128 Y144.670 E32.8020
+G1 X102.539 Y144.784 E32.8260
+G1 X101.945 Y144.873 E32.8500
+G1 X101.349 Y144.939 E32.8740
+G1 X100.750 Y144.981 E32.8980
+G1 X100.150 Y144.999 E32.9220
+G1 X99.550 Y144.993 E32.9460
+G1 X98.950 Y144.963 E32.9700
+G1 X98.352 Y144.909 E32.9940
+G1 X97.757 Y144.831 E33.0180
+G1 X97.166 Y144.730 E33.0421
+G1 X96.579 Y144.605 E33.0661
+G1 X95.997 Y144.456 E33.0901
+G1 X95.422 Y144.284 E33.1141
+G1 X94.854 Y144.090 E33.1381
+G1 X94.294 Y143.873 E33.1621
+G1 X93.744 Y143.633 E33.1861
+G1 X93.204 Y143.372 E33.2101
+G1 X92.674 Y143.089 E33.2341
+G1 X92.156 Y142.786 E33.2582
+G1 X91.651 Y142.462 E33.2822
+G1 X91.159 Y142.118 E33.3062
+G1 X90.681 Y141.754 E33.3302
+G1 X90.218 Y141.372 E33.3542
+G1 X89.771 Y140.971 E33.3782
+G1 X89.340 Y140.553 E33.4022
+G1 X88.927 Y140.118 E33.4262
+G1 X88.531 Y139.667 E33.4502
+G1 X88.153 Y139.201 E33.4742
+G1 X87.795 Y138.719 E33.4983
+G1 X87.455 Y138.224 E33.5223
+G1 X87.136 Y137.716 E33.5463
+G1 X86.838 Y137.195 E33.5703
+G1 X86.561 Y136.662 E33.5943
+G1 X86.305 Y136.119 E33.6183
+G1 X86.071 Y135.566 E33.6423
+G1 X85.860 Y135.005 E33.6663
+G1 X85.671 Y134.435 E33.6903
+G1 X85.505 Y133.858 E33.7144
+G1 X85.362 Y133.275 E33.7384
+G1 X85.243 Y132.687 E33.7624
+G1 X85.147 Y132.094 E33.7864
+G1 X85.075 Y131.498 E33.8104
+G1 X85.027 Y130.900 E33.8344
+G1 X85.003 Y130.300 E33.8584
+G1 X85.003 Y129.700 E33.8824
+G1 X85.027 Y129.100 E33.9064
+G1 X85.075 Y128.502 E33.9304
+G1 X85.147 Y127.906 E33.9545
+G1 X85.243 Y127.313 E33.9785
+G1 X85.362 Y126.725 E34.0025
+G1 X85.505 Y126.142 E34.0265
+G1 X85.671 Y125.565 E34.0505
+G1 X85.860 Y124.995 E34.0745
+G1 X86.071 Y124.434 E34.0985
+G1 X86.305 Y123.881 E34.1225
+G1 X86.561 Y123.338 E34.1465
+G1 X86.838 Y122.805 E34.1706
+G1 X87.136 Y122.284 E34.1946
+G1 X87.455 Y121.776 E34.2186
+G1 X87.795 Y121.281 E34.2426
+G1 X88.153 Y120.799 E34.2666
+G1 X88.531 Y120.333 E34.2906
+G1 X88.927 Y119.882 E34.3146
+G1 X89.340 Y119.447 E34.3386
+G1 X89.771 Y119.029 E34.3626
+G1 X90.218 Y118.628 E34.3866
+G1 X90.681 Y118.246 E34.4107
+G1 X91.159 Y117.882 E34.4347
+G1 X91.651 Y117.538 E34.4587
+G1 X92.156 Y117.214 E34.4827
+G1 X92.674 Y116.911 E34.5067
+G1 X93.204 Y116.628 E34.5307
+G1 X93.744 Y116.367 E34.5547
+G1 X94.294 Y116.127 E34.5787
+G1 X94.854 Y115.910 E34.6027
+G1 X95.422 Y115.716 E34.6268
+G1 X95.997 Y115.544 E34.6508
+G1 X96.579 Y115.395 E34.6748
+G1 X97.166 Y115.270 E34.6988
+G1 X97.757 Y115.169 E34.7228
+G1 X98.352 Y115.091 E34.7468
+G1 X98.950 Y115.037 E34.7708
+G1 X99.550 Y115.007 E34.7948
+G1 X100.150 Y115.001 E34.8188
+G1 X100.750 Y115.019 E34.8429
+G1 X101.349 Y115.061 E34.8669
+G1 X101.945 Y115.127 E34.8909
+G1 X102.539 Y115.216 E34.9149
+G1 X103.128 Y115.330 E34.9389
+G1 X103.713 Y115.467 E34.9629
+G1 X104.291 Y115.627 E34.9869
+G1 X104.863 Y115.810 E35.0109
+G1 X105.427 Y116.016 E35.0349
+G1 X105.982 Y116.244 E35.0589
+G1 X106.528 Y116.495 E35.0830
+G1 X107.063 Y116.767 E35.1070
+G1 X107.586 Y117.060 E35.1310
+G1 X108.098 Y117.374 E35.1550
+G1 X108.597 Y117.708 E35.1790
+G1 X109.082 Y118.062 E35.2030
+G1 X109.552 Y118.435 E35.2270
+G1 X110.007 Y118.826 E35.2510
+G1 X110.446 Y119.235 E35.2750
+G1 X110.869 Y119.662 E35.2991
+G1 X111.273 Y120.105 E35.3231
+G1 X111.660 Y120.564 E35.3471
+G1 X112.029 Y121.038 E35.3711
+G1 X112.377 Y121.527 E35.3951
+G1 X112.707 Y122.029 E35.4191
+G1 X113.015 Y122.543 E35.4431
+G1 X113.303 Y123.070 E35.4671
+G1 X113.570 Y123.608 E35.4911
+G1 X113.815 Y124.156 E35.5151
+G1 X114.037 Y124.713 E35.5392
+G1 X114.238 Y125.279 E35.5632
+G1 X114.415 Y125.853 E35.5872
+G1 X114.570 Y126.433 E35.6112
+G1 X114.701 Y127.018 E35.6352
+G1 X114.808 Y127.609 E35.6592
+G1 X114.892 Y128.203 E35.6832
+G1 X114.952 Y128.801 E35.7072
+G1 X114.988 Y129.400 E35.7312
+G1 X115.000 Y130.000 E35.7553
+G1 X114.600 Y130.000 F6000
+G1 X114.588 Y130.603 E35.7794 F1800
+G1 X114.550 Y131.206 E35.8035
+G1 X114.488 Y131.806 E35.8277
+G1 X114.401 Y132.403 E35.8518
+G1 X114.289 Y132.996 E35.8759
+G1 X114.153 Y133.584 E35.9001
+G1 X113.993 Y134.166 E35.9242
+G1 X113.809 Y134.741 E35.9484
+G1 X113.601 Y135.307 E35.9725
+G1 X113.370 Y135.865 E35.9966
+G1 X113.117 Y136.412 E36.0208
+G1 X112.840 Y136.949 E36.0449
+G1 X112.542 Y137.474 E36.0691
+G1 X112.223 Y137.985 E36.0932
+G1 X111.882 Y138.484 E36.1173
+G1 X111.521 Y138.968 E36.1415
+G1 X111.141 Y139.436 E36.1656
+G1 X110.742 Y139.888 E36.1898
+G1 X110.324 Y140.324 E36.2139
+G1 X109.888 Y140.742 E36.2380
+G1 X109.436 Y141.141 E36.2622
+G1 X108.968 Y141.521 E36.2863
+G1 X108.484 Y141.882 E36.3104
+G1 X107.985 Y142.223 E36.3346
+G1 X107.474 Y142.542 E36.3587
+G1 X106.949 Y142.840 E36.3829
+G1 X106.412 Y143.117 E36.4070
+G1 X105.865 Y143.370 E36.4311
+G1 X105.307 Y143.601 E36.4553
+G1 X104.741 Y143.809 E36.4794
+G1 X104.166 Y143.993 E36.5036
+G1 X103.584 Y144.153 E36.5277
+G1 X102.996 Y144.289 E36.5518
+G1 X102.403 Y144.401 E36.5760
+G1 X101.806 Y144.488 E36.6001
+G1 X101.206 Y144.550 E36.6243
+G1 X100.603 Y144.588 E36.6484
+G1 X100.000 Y144.600 E36.6725
+G1 X99.397 Y144.588 E36.6967
+G1 X98.794 Y144.550 E36.7208
+G1 X98.194 Y144.488 E36.7449
+G1 X97.597 Y144.401 E36.7691
+G1 X97.004 Y144.289 E36.7932
+G1 X96.416 Y144.153 E36.8174
+G1 X95.834 Y143.993 E36.8415
+G1 X95.259 Y143.809 E36.8656
+G1 X94.693 Y143.601 E36.8898
+G1 X94.135 Y143.370 E36.9139
+G1 X93.588 Y143.117 E36.9381
+G1 X93.051 Y142.840 E36.9622
+G1 X92.526 Y142.542 E36.9863
+G1 X92.015 Y142.223 E37.0105
+G1 X91.516 Y141.882 E37.0346
+G1 X91.032 Y141.521 E37.0588
+G1 X90.564 Y141.141 E37.0829
+G1 X90.112 Y140.742 E37.1070
+G1 X89.676 Y140.324 E37.1312
+G1 X89.258 Y139.888 E37.1553
+G1 X88.859 Y139.436 E37.1794
+G1 X88.479 Y138.968 E37.2036
+G1 X88.118 Y138.484 E37.2277
+G1 X87.777 Y137.985 E37.2519
+G1 X87.458 Y137.474 E37.2760
+G1 X87.160 Y136.949 E37.3001
+G1 X86.883 Y136.412 E37.3243
+G1 X86.630 Y135.865 E37.3484
+G1 X86.399 Y135.307 E37.3726
+G1 X86.191 Y134.741 E37.3967
+G1 X86.007 Y134.166 E37.4208
+G1 X85.847 Y133.584 E37.4450
+G1 X85.711 Y132.996 E37.4691
+G1 X85.599 Y132.403 E37.4933
+G1 X85.512 Y131.806 E37.5174
+G1 X85.450 Y131.206 E37.5415
+G1 X85.412 Y130.603 E37.5657
+G1 X85.400 Y130.000 E37.5898
+G1 X85.412 Y129.397 E37.6140
+G1 X85.450 Y128.794 E37.6381
+G1 X85.512 Y128.194 E37.6622
+G1 X85.599 Y127.597 E37.6864
+G1 X85.711 Y127.004 E37.7105
+G1 X85.847 Y126.416 E37.7346
+G1 X86.007 Y125.834 E37.7588
+G1 X86.191 Y125.259 E37.7829
+G1 X86.399 Y124.693 E37.8071
+G1 X86.630 Y124.135 E37.8312
+G1 X86.883 Y123.588 E37.8553
+G1 X87.160 Y123.051 E37.8795
+G1 X87.458 Y122.526 E37.9036
+G1 X87.777 Y122.015 E37.9278
+G1 X88.118 Y121.516 E37.9519
+G1 X88.479 Y121.032 E37.9760
+G1 X88.859 Y120.564 E38.0002
+G1 X89.258 Y120.112 E38.0243
+G1 X89.676 Y119.676 E38.0485
+G1 X90.112 Y119.258 E38.0726
+G1 X90.564 Y118.859 E38.0967
+G1 X91.032 Y118.479 E38.1209
+G1 X91.516 Y118.118 E38.1450
+G1 X92.015 Y117.777 E38.1691
+G1 X92.526 Y117.458 E38.1933
+G1 X93.051 Y117.160 E38.2174
+G1 X93.588 Y116.883 E38.2416
+G1 X94.135 Y116.630 E38.2657
+G1 X94.693 Y116.399 E38.2898
+G1 X95.259 Y116.191 E38.3140
+G1 X95.834 Y116.007 E38.3381
+G1 X96.416 Y115.847 E38.3623
+G1 X97.004 Y115.711 E38.3864
+G1 X97.597 Y115.599 E38.4105
+G1 X98.194 Y115.512 E38.4347
+G1 X98.794 Y115.450 E38.4588
+G1 X99.397 Y115.412 E38.4830
+G1 X100.000 Y115.400 E38.5071
+G1 X100.603 Y115.412 E38.5312
+G1 X101.206 Y115.450 E38.5554
+G1 X101.806 Y115.512 E38.5795
+G1 X102.403 Y115.599 E38.6036
+G1 X102.996 Y115.711 E38.6278
+G1 X103.584 Y115.847 E38.6519
+G1 X104.166 Y116.007 E38.6761
+G1 X104.741 Y116.191 E38.7002
+G1 X105.307 Y116.399 E38.7243
+G1 X105.865 Y116.630 E38.7485
+G1 X106.412 Y116.883 E38.7726
+G1 X106.949 Y117.160 E38.7968
+G1 X107.474 Y117.458 E38.8209
+G1 X107.985 Y117.777 E38.8450
+G1 X108.484 Y118.118 E38.8692
+G1 X108.968 Y118.479 E38.8933
+G1 X109.436 Y118.859 E38.9175
+G1 X109.888 Y119.258 E38.9416
+G1 X110.324 Y119.676 E38.9657
+G1 X110.742 Y120.112 E38.9899
+G1 X111.141 Y120.564 E39.0140
+G1 X111.521 Y121.032 E39.0381
+G1 X111.882 Y121.516 E39.0623
+G1 X112.223 Y122.015 E39.0864
+G1 X112.542 Y122.526 E39.1106
+G1 X112.840 Y123.051 E39.1347
+G1 X113.117 Y123.588 E39.1588
+G1 X113.370 Y124.135 E39.1830
+G1 X113.601 Y124.693 E39.2071
+G1 X113.809 Y125.259 E39.2313
+G1 X113.993 Y125.834 E39.2554
+G1 X114.153 Y126.416 E39.2795
+G1 X114.289 Y127.004 E39.3037
+G1 X114.401 Y127.597 E39.3278
+G1 X114.488 Y128.194 E39.3520
+G1 X114.550 Y128.794 E39.3761
+G1 X114.588 Y129.397 E39.4002
+G1 X114.600 Y130.000 E39.4244
+G1 X104.000 Y130.000 F6000
+G1 X103.979 Y130.405 E39.4406 F1800
+G1 X103.918 Y130.805 E39.4568
+G1 X103.817 Y131.197 E39.4730
+G1 X103.676 Y131.577 E39.4892
+G1 X103.497 Y131.941 E39.5054
+G1 X103.283 Y132.285 E39.5216
+G1 X103.035 Y132.605 E39.5378
+G1 X102.756 Y132.899 E39.5540
+G1 X102.448 Y133.163 E39.5702
+G1 X102.116 Y133.395 E39.5864
+G1 X101.762 Y133.591 E39.6027
+G1 X101.389 Y133.751 E39.6189
+G1 X101.003 Y133.872 E39.6351
+G1 X100.606 Y133.954 E39.6513
+G1 X100.203 Y133.995 E39.6675
+G1 X99.797 Y133.995 E39.6837
+G1 X99.394 Y133.954 E39.6999
+G1 X98.997 Y133.872 E39.7161
+G1 X98.611 Y133.751 E39.7323
+G1 X98.238 Y133.591 E39.7485
+G1 X97.884 Y133.395 E39.7647
+G1 X97.552 Y133.163 E39.7809
+G1 X97.244 Y132.899 E39.7971
+G1 X96.965 Y132.605 E39.8134
+G1 X96.717 Y132.285 E39.8296
+G1 X96.503 Y131.941 E39.8458
+G1 X96.324 Y131.577 E39.8620
+G1 X96.183 Y131.197 E39.8782
+G1 X96.082 Y130.805 E39.8944
+G1 X96.021 Y130.405 E39.9106
+G1 X96.000 Y130.000 E39.9268
+G1 X96.021 Y129.595 E39.9430
+G1 X96.082 Y129.195 E39.9592
+G1 X96.183 Y128.803 E39.9754
+G1 X96.324 Y128.423 E39.9916
+G1 X96.503 Y128.059 E40.0078
+G1 X96.717 Y127.715 E40.0241
+G1 X96.965 Y127.395 E40.0403
+G1 X97.244 Y127.101 E40.0565
+G1 X97.552 Y126.837 E40.0727
+G1 X97.884 Y126.605 E40.0889
+G1 X98.238 Y126.409 E40.1051
+G1 X98.611 Y126.249 E40.1213
+G1 X98.997 Y126.128 E40.1375
+G1 X99.394 Y126.046 E40.1537
+G1 X99.797 Y126.005 E40.1699
+G1 X100.203 Y126.005 E40.1861
+G1 X100.606 Y126.046 E40.2023
+G1 X101.003 Y126.128 E40.2186
+G1 X101.389 Y126.249 E40.2348
+G1 X101.762 Y126.409 E40.2510
+G1 X102.116 Y126.605 E40.2672
+G1 X102.448 Y126.837 E40.2834
+G1 X102.756 Y127.101 E40.2996
+G1 X103.035 Y127.395 E40.3158
+G1 X103.283 Y127.715 E40.3320
+G1 X103.497 Y128.059 E40.3482
+G1 X103.676 Y128.423 E40.3644
+G1 X103.817 Y128.803 E40.3806
+G1 X103.918 Y129.195 E40.3968
+G1 X103.979 Y129.595 E40.4130
+G1 X104.000 Y130.000 E40.4293
+G1 X104.400 Y130.000 F6000
+G1 X104.382 Y130.400 E40.4453 F1800
+G1 X104.327 Y130.797 E40.4613
+G1 X104.237 Y131.187 E40.4773
+G1 X104.111 Y131.567 E40.4933
+G1 X103.952 Y131.935 E40.5094
+G1 X103.759 Y132.286 E40.5254
+G1 X103.536 Y132.619 E40.5414
+G1 X103.283 Y132.929 E40.5574
+G1 X103.003 Y133.216 E40.5734
+G1 X102.698 Y133.475 E40.5895
+G1 X102.371 Y133.706 E40.6055
+G1 X102.024 Y133.907 E40.6215
+G1 X101.661 Y134.075 E40.6375
+G1 X101.283 Y134.209 E40.6535
+G1 X100.895 Y134.308 E40.6696
+G1 X100.500 Y134.372 E40.6856
+G1 X100.100 Y134.399 E40.7016
+G1 X99.700 Y134.390 E40.7176
+G1 X99.302 Y134.344 E40.7337
+G1 X98.910 Y134.263 E40.7497
+G1 X98.527 Y134.146 E40.7657
+G1 X98.156 Y133.995 E40.7817
+G1 X97.800 Y133.811 E40.7977
+G1 X97.463 Y133.595 E40.8138
+G1 X97.146 Y133.349 E40.8298
+G1 X96.854 Y133.076 E40.8458
+G1 X96.587 Y132.777 E40.8618
+G1 X96.349 Y132.455 E40.8778
+G1 X96.140 Y132.113 E40.8939
+G1 X95.964 Y131.753 E40.9099
+G1 X95.822 Y131.379 E40.9259
+G1 X95.714 Y130.993 E40.9419
+G1 X95.641 Y130.599 E40.9579
+G1 X95.605 Y130.200 E40.9740
+G1 X95.605 Y129.800 E40.9900
+G1 X95.641 Y129.401 E41.0060
+G1 X95.714 Y129.007 E41.0220
+G1 X95.822 Y128.621 E41.0381
+G1 X95.964 Y128.247 E41.0541
+G1 X96.140 Y127.887 E41.0701
+G1 X96.349 Y127.545 E41.0861
+G1 X96.587 Y127.223 E41.1021
+G1 X96.854 Y126.924 E41.1182
+G1 X97.146 Y126.651 E41.1342
+G1 X97.463 Y126.405 E41.1502
+G1 X97.800 Y126.189 E41.1662
+G1 X98.156 Y126.005 E41.1822
+G1 X98.527 Y125.854 E41.1983
+G1 X98.910 Y125.737 E41.2143
+G1 X99.302 Y125.656 E41.2303
+G1 X99.700 Y125.610 E41.2463
+G1 X100.100 Y125.601 E41.2623
+G1 X100.500 Y125.628 E41.2784
+G1 X100.895 Y125.692 E41.2944
+G1 X101.283 Y125.791 E41.3104
+G1 X101.661 Y125.925 E41.3264
+G1 X102.024 Y126.093 E41.3425
+G1 X102.371 Y126.294 E41.3585
+G1 X102.698 Y126.525 E41.3745
+G1 X103.003 Y126.784 E41.3905
+G1 X103.283 Y127.071 E41.4065
+G1 X103.536 Y127.381 E41.4226
+G1 X103.759 Y127.714 E41.4386
+G1 X103.952 Y128.065 E41.4546
+G1 X104.111 Y128.433 E41.4706
+G1 X104.237 Y128.813 E41.4866
+G1 X104.327 Y129.203 E41.5027
+G1 X104.382 Y129.600 E41.5187
+G1 X104.400 Y130.000 E41.5347
+G1 X85.800 Y130.000 F6000
+G1 X85.800 Y130.000 E41.5347 F2400
+G1 X86.800 Y135.235 F6000
+G1 X86.800 Y124.765 E41.9535 F2400
+G1 X87.800 Y122.734 F6000
+G1 X87.800 Y137.266 E42.5348 F2400
+G1 X88.800 Y138.729 F6000
+G1 X88.800 Y121.271 E43.2331 F2400
+G1 X89.800 Y120.121 F6000
+G1 X89.800 Y139.879 E44.0235 F2400
+G1 X90.800 Y140.817 F6000
+G1 X90.800 Y119.183 E44.8888 F2400
+G1 X91.800 Y118.407 F6000
+G1 X91.800 Y141.593 E45.8162 F2400
+G1 X92.800 Y142.239 F6000
+G1 X92.800 Y117.761 E46.7954 F2400
+G1 X93.800 Y117.225 F6000
+G1 X93.800 Y142.775 E47.8174 F2400
+G1 X94.800 Y143.214 F6000
+G1 X94.800 Y116.786 E48.8745 F2400
+G1 X95.800 Y116.435 F6000
+G1 X95.800 Y127.676 E49.3241 F2400
+G1 X95.800 Y132.324 F6000
+G1 X95.800 Y143.565 E49.7737 F2400
+G1 X96.800 Y143.835 F6000
+G1 X96.800 Y133.578 E50.1840 F2400
+G1 X96.800 Y126.422 F6000
+G1 X96.800 Y116.165 E50.5943 F2400
+G1 X97.800 Y115.971 F6000
+G1 X97.800 Y125.734 E50.9848 F2400
+G1 X97.800 Y134.266 F6000
+G1 X97.800 Y144.029 E51.3753 F2400
+G1 X98.800 Y144.149 F6000
+G1 X98.800 Y134.648 E51.7554 F2400
+G1 X98.800 Y125.352 F6000
+G1 X98.800 Y115.851 E52.1354 F2400
+G1 X99.800 Y115.801 F6000
+G1 X99.800 Y125.204 E52.5115 F2400
+G1 X99.800 Y134.796 F6000
+G1 X99.800 Y144.199 E52.8876 F2400
+G1 X100.800 Y144.177 F6000
+G1 X100.800 Y134.733 E53.2654 F2400
+G1 X100.800 Y125.267 F6000
+G1 X100.800 Y115.823 E53.6432 F2400
+G1 X101.800 Y115.915 F6000
+G1 X101.800 Y125.550 E54.0286 F2400
+G1 X101.800 Y134.450 F6000
+G1 X101.800 Y144.085 E54.4141 F2400
+G1 X102.800 Y143.921 F6000
+G1 X102.800 Y133.899 E54.8150 F2400
+G1 X102.800 Y126.101 F6000
+G1 X102.800 Y116.079 E55.2159 F2400
+G1 X103.800 Y116.318 F6000
+G1 X103.800 Y127.067 E55.6459 F2400
+G1 X103.800 Y132.933 F6000
+G1 X103.800 Y143.682 E56.0758 F2400
+G1 X104.800 Y143.364 F6000
+G1 X104.800 Y116.636 E57.1450 F2400
+G1 X105.800 Y117.039 F6000
+G1 X105.800 Y142.961 E58.1819 F2400
+G1 X106.800 Y142.466 F6000
+G1 X106.800 Y117.534 E59.1792 F2400
+G1 X107.800 Y118.134 F6000
+G1 X107.800 Y141.866 E60.1284 F2400
+G1 X108.800 Y141.145 F6000
+G1 X108.800 Y118.855 E61.0200 F2400
+G1 X109.800 Y119.724 F6000
+G1 X109.800 Y140.276 E61.8421 F2400
+G1 X110.800 Y139.220 F6000
+G1 X110.800 Y120.780 E62.5797 F2400
+G1 X111.800 Y122.101 F6000
+G1 X111.800 Y137.899 E63.2116 F2400
+G1 X112.800 Y136.148 F6000
+G1 X112.800 Y123.852 E63.7035 F2400
+G1 X113.800 Y126.653 F6000
+G1 X113.800 Y133.347 E63.9712 F2400
+G1 Z10 F6000
@@ -0,0 +1,2685 @@
+/*
+  hostsim.cpp - runs the Marlin motion code on a desktop machine
+
+  Marlin_main.cpp, planner.cpp, stepper.cpp, motion_control.cpp,
+  MarlinSerial.cpp and ConfigurationStore.cpp are built unmodified against
+  the stand-in headers in this directory (make hostsim). A virtual clock
+  running at F_CPU stands in for the hardware:
+
+  - Timer1 runs in CTC mode from TCCR1B/OCR1A and fires the stepper ISR
+    whenever it is enabled in TIMSK1, exactly as on the ATmega.
+  - A simulated host streams G-code into the UART receive interrupt at
+    BAUDRATE and waits for "ok" before sending the next line.
+  - The firmware idles in manage_heater() (see sim_stubs.cpp), each call lets
+    one main loop pass worth of time go by. Foreground code itself takes no
+    virtual time and neither do interrupts.
+  - Writes to the step pins are watched, every step is timestamped and the
+    endstop inputs follow the motor positions, so G28 works. A change of an
+    endstop input runs its INTn or PCINTn interrupt if the firmware enabled
+    it, as soon as interrupts are allowed.
+
+  Usage:
+    marlin_sim run [-v] [-t trace.txt] [-d ms] [file.gcode]
+        Stream a G-code file (or a built-in demo) through the firmware.
+        -v echoes what the firmware sends back, -t writes every step as
+        "<cycle> <axis> <+1|-1>", -d makes the host wait ms after each ok
+        before it sends the next line, like a busy or stalling host.
+    marlin_sim bench [blocks]
+        Home, then feed plan_buffer_line() directly and report the host time
+        per planned block and per stepper interrupt, and the port writes the
+        interrupt does per step.
+    marlin_sim bench file.gcode
+        Stream a G-code file and report the same timings for the blocks the
+        firmware plans from it (hostsim/bench.gcode is a sliced-like part).
+    marlin_sim check
+        Run a fixed program and check the step stream: pin level steps must
+        match the firmware's step counters, returning to a point must give
+        the same counts, and a second run must produce the same stream.
+    marlin_sim trapezoid [reference.txt | -]
+        Print calculate_trapezoid_for_block() results for a fixed set of
+        random blocks, or compare them with the output of a build with the
+        other trapezoid math (make hostsim-fixed does that).
+    marlin_sim timers
+        Check the timer values the stepper interrupt uses for every step rate
+        up to MAX_STEP_FREQUENCY against STEPPER_TIMER_RATE / rate.
+    marlin_sim multistep
+        Ramp through the rates where the stepper interrupt changes the step
+        events it takes each time and check it stays under
+        MAX_STEP_ISR_FREQUENCY, the step interval stays smooth and the count
+        doesn't switch back and forth.
+    marlin_sim stop
+        Stop moves of the X arm and a G1 with stop_moves() (M410) and check
+        the arm slows down on a ramp, stops within the steps the acceleration
+        takes, and the planner and current_position go on from where it
+        stopped. Stop a G1 and a G2 from the wait for room in the buffer, the
+        way the LCD does, and check the rest of the move is dropped. Stop a
+        run of blocks from plan_buffer_line()'s wait and check only the block
+        that waited runs after it.
+    marlin_sim override
+        (SPEED_OVERRIDE_REPLAN builds) Change the speed override in the middle
+        of a run of blocks and after a G1 and check the blocks already in the
+        buffer change speed from the next one on, on a ramp.
+    marlin_sim trace [-b] [-r rates.txt] [serial.log | -]
+        Analyze the last M123 step trace (STEP_TRACE) in a serial log: step
+        rates of each axis, interrupt latency, missed deadlines, step interval
+        jitter and the trapezoids the blocks ran against their plans (-b
+        lists them, -r writes the rates at each interrupt). Without a log
+        (STEP_TRACE builds) trace moves in the simulator and check the trace
+        against the steps on the pins.
+    marlin_sim advance
+        (LIN_ADVANCE builds) Set the advance with M900, store and read it back,
+        then extrude along a move and check the extruder runs ahead of the
+        arm by K seconds of its rate and gives the lead back by the end.
+    marlin_sim babystep
+        (BABYSTEPPING builds) Baby-step Z with M290 standing still and while
+        G1 moves run, check the Z pins take the baby-steps on top of the
+        counted steps and the moves don't change, then fold the offset into
+        the home offset with M290 H and check G28 keeps the height.
+    marlin_sim ik
+        Sweep the bed and check the arm angles of calculate_delta()'s kernel
+        (SCARA_FAST_IK, SCARA_IK_TABLE or libm) against double precision:
+        largest theta and psi error and how far off the nozzle ends up in um,
+        and the host time per call against the libm kernel in float.
+    marlin_sim chord
+        Run G1 moves over the bed and check how far the nozzle strays from
+        the lines between the ends of the blocks prepare_move() cut them
+        into, and with SEGMENT_MAX_DEVIATION that it stays within it and the
+        moves take fewer blocks than DELTA_SEGMENTS_PER_SECOND makes.
+    marlin_sim arc
+        Run G2/G3 arcs and check the blocks they make end on the circle
+        through the forward kinematics of their joint angles, within
+        ARC_MAX_DEVIATION inside of it, and at the end of the arc.
+    marlin_sim staging
+        (KINEMATICS_STAGING builds) Run G1 moves of many segments and check
+        the planner gets the joint angles of each segment in order, and with
+        MOTION_STATS that some were worked out while the buffer was full.
+    marlin_sim endstops
+        (ENDSTOP_INTERRUPTS builds) Press the X endstop the arm moves towards
+        in the middle of a move, once only until the next stepper interrupt
+        and once held, and check the spike leaves the move alone and the
+        held press stops it within two interrupts.
+*/
+
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "Marlin.h"
+#include "planner.h"
+#include "stepper.h"
+#include "speed_lookuptable.h"
+#include "hostsim.h"
+
+void setup();
+void loop();
+extern volatile long count_position[NUM_AXIS];
+extern "C" void TIMER1_COMPA_vect(void);
+extern "C" void USART0_RX_vect(void);
+// Only there when the firmware takes endstops from their pin interrupts
+extern "C" void INT0_vect(void) __attribute__((weak));
+extern "C" void INT1_vect(void) __attribute__((weak));
+extern "C" void INT2_vect(void) __attribute__((weak));
+extern "C" void INT3_vect(void) __attribute__((weak));
+extern "C" void INT4_vect(void) __attribute__((weak));
+extern "C" void INT5_vect(void) __attribute__((weak));
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+
+//===========================================================================
+//============================= registers ===================================
+//===========================================================================
+
+#define SIM_PORT_DEFS(P, ID) sim_reg8 PORT##P = { 0, ID }, PIN##P = { 0, 0 }, DDR##P = { 0, 0 };
+SIM_PORT_DEFS(A, 1) SIM_PORT_DEFS(B, 2) SIM_PORT_DEFS(C, 3) SIM_PORT_DEFS(D, 4)
+SIM_PORT_DEFS(E, 5) SIM_PORT_DEFS(F, 6) SIM_PORT_DEFS(G, 7) SIM_PORT_DEFS(H, 8)
+SIM_PORT_DEFS(J, 9) SIM_PORT_DEFS(K, 10) SIM_PORT_DEFS(L, 11)
+
+sim_udr UDR0;
+sim_ucsra UCSR0A;
+volatile uint8_t SREG, MCUSR;
+volatile uint8_t UCSR0B, UBRR0H, UBRR0L;
+volatile uint8_t TCCR0A, TCCR0B, TCCR1A, TCCR1B, TCCR2A, TCCR2B;
+volatile uint8_t TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+volatile uint8_t TIMSK0, TIMSK1, OCR0A, OCR0B;
+volatile uint16_t OCR1A, TCNT1;
+volatile uint8_t EICRA, EICRB, EIMSK, PCICR, PCMSK0, PCMSK1, PCMSK2;
+SPIClass SPI;
+
+// fastio.h style two level macros to get at the port behind a pin number
+#define SIM_WPORT(IO) _SIM_WPORT(IO)
+#define _SIM_WPORT(IO) DIO ## IO ## _WPORT
+#define SIM_RPORT(IO) _SIM_RPORT(IO)
+#define _SIM_RPORT(IO) DIO ## IO ## _RPORT
+#define SIM_MASK(IO) _SIM_MASK(IO)
+#define _SIM_MASK(IO) MASK(DIO ## IO ## _PIN)
+
+//===========================================================================
+//============================= state =======================================
+//===========================================================================
+
+#define SIM_LOOP_CYCLES (F_CPU / 10000)               // one main loop pass, 100us
+#define SIM_BYTE_CYCLES (F_CPU * 10 / BAUDRATE)       // one 8N1 character
+#define SIM_TIME_LIMIT ((uint64_t)F_CPU * 3600)       // give up after an hour
+
+uint64_t sim_clock = 0;
+
+static uint64_t timer1_match = 0;      // cycle of the last compare match
+static bool timer1_pending = false;    // OCF1A, set while the interrupt is masked
+
+struct sim_axis {
+  uint8_t step_id, step_mask;
+  bool step_invert;
+  sim_reg8 *dir_port;
+  uint8_t dir_mask;
+  bool dir_invert;
+  long pulses;                         // signed step pulses seen on the pins
+  unsigned long travel;                // all step pulses seen on the pins
+};
+static sim_axis axes[NUM_AXIS];
+
+// Endstops are placed at fixed motor positions, counted from power up
+struct sim_endstop {
+  int axis;
+  int side;                            // -1 triggers at or below trigger, 1 at or above
+  long trigger;
+  sim_reg8 *pin;
+  uint8_t mask;
+  bool inverting;
+  int ext, bank, bit;                  // INTn and PCINTn of the pin, -1 for none
+  bool pending;                        // the pin changed, its interrupt has not run yet
+  bool forced;                         // held pressed wherever the motor is
+};
+static sim_endstop endstops[6];
+static int endstop_count = 0;
+
+struct sim_stats {
+  uint64_t hash;                       // FNV-1a over the step stream
+  unsigned long steps;
+  unsigned long isr_count, isr_stepping;
+  uint64_t isr_ns, isr_ns_max, isr_stepping_ns;
+  unsigned long port_writes;           // writes to PORTx registers
+  unsigned long isr_port_writes;       // those from the stepper ISR
+  uint64_t advance_ns;                 // host time spent inside sim_advance()
+  unsigned long planner_calls;
+  uint64_t planner_ns, planner_ns_max; // plan_buffer_line(), without waiting for room
+  unsigned long blocks_done;
+  unsigned long buffer_dry;            // blocks finished with nothing queued behind them
+  unsigned long errors, warnings, endstop_hits, lines_acked;
+};
+static sim_stats stats;
+static unsigned long isr_steps;        // steps taken by the running interrupt
+// Stepping interrupts recorded while isr_log is set
+struct sim_isr_entry {
+  uint64_t clock;
+  unsigned char steps;
+  bool block_end;                      // the interrupt finished its block
+};
+static sim_isr_entry *isr_log = NULL;
+static unsigned long isr_log_len = 0, isr_log_size = 0;
+static uint64_t host_ns_overhead;
+
+static float *joint_log = NULL;        // x, y and cartesian_mm of each plan_buffer_line(), when set
+static unsigned long joint_log_len = 0, joint_log_size = 0;
+static FILE *trace_file = NULL;
+static FILE *host_capture = NULL;      // gets what the firmware sends, when set
+static bool verbose = false;
+
+//===========================================================================
+//============================= host side of the serial port ================
+//===========================================================================
+
+static char *host_script = NULL;
+static size_t host_len = 0, host_pos = 0;
+static bool host_in_line = false;
+static int host_unacked = 0;
+static const int host_window = 1;      // lines in flight, 1 is ping-pong like Pronterface
+static uint64_t host_delay = 0;        // cycles the host takes to answer an ok
+static uint64_t host_ready = 0;
+static uint64_t rx_next = 0;
+static int rx_byte = -1;               // character waiting in UDR0
+static char out_line[MAX_CMD_SIZE * 2];
+static size_t out_len = 0;
+
+// Queues G-code for the host to send. Comments and blank lines are dropped
+// like a host program would.
+static void host_queue(const char *text)
+{
+  size_t n = strlen(text);
+  host_script = (char *)realloc(host_script, host_len + n + 2);
+  bool in_comment = false, line_empty = true;
+  for (size_t i = 0; i < n; i++) {
+    char c = text[i];
+    if (c == '\r') continue;
+    if (c == '\n') {
+      if (!line_empty) host_script[host_len++] = '\n';
+      in_comment = false;
+      line_empty = true;
+      continue;
+    }
+    if (c == ';') in_comment = true;
+    if (in_comment) continue;
+    if (line_empty && (c == ' ' || c == '\t')) continue;
+    host_script[host_len++] = c;
+    line_empty = false;
+  }
+  if (!line_empty) host_script[host_len++] = '\n';
+}
+
+static bool host_queue_file(const char *file)
+{
+  FILE *f = fopen(file, "r");
+  if (!f) { perror(file); return false; }
+  // host_queue() works on whole lines, so read the file in one piece
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *text = (char *)malloc(size + 1);
+  size_t n = fread(text, 1, size, f);
+  text[n] = 0;
+  fclose(f);
+  host_queue(text);
+  free(text);
+  return true;
+}
+
+static bool host_can_send()
+{
+  return host_pos < host_len && (host_in_line || host_unacked < host_window);
+}
+
+static bool host_done()
+{
+  return host_pos >= host_len && host_unacked == 0;
+}
+
+static void host_line(const char *line)
+{
+  if (verbose) printf("< %s\n", line);
+  if (host_capture) fprintf(host_capture, "%s\n", line);
+  if (strncmp(line, "ok", 2) == 0) {
+    if (host_unacked > 0) host_unacked--;
+    stats.lines_acked++;
+    host_ready = sim_clock + host_delay;
+  }
+  else if (strncmp(line, "Error", 5) == 0 || strncmp(line, "!!", 2) == 0)
+    stats.errors++;
+  if (strstr(line, "halted")) {
+    fprintf(stderr, "marlin_sim: firmware killed: %s\n", line);
+    exit(3);
+  }
+  if (strstr(line, "endstops hit")) stats.endstop_hits++;
+  if (strstr(line, "out of bounds") || strstr(line, "too small")) stats.warnings++;
+}
+
+sim_udr::operator uint8_t() const
+{
+  uint8_t c = rx_byte < 0 ? 0 : rx_byte;
+  rx_byte = -1;
+  return c;
+}
+
+sim_udr &sim_udr::operator=(uint8_t c)
+{
+  if (c == '\n') {
+    out_line[out_len] = 0;
+    host_line(out_line);
+    out_len = 0;
+  }
+  else if (c != '\r' && out_len < sizeof(out_line) - 1)
+    out_line[out_len++] = c;
+  return *this;
+}
+
+sim_ucsra::operator uint8_t() const
+{
+  return value | (1 << UDRE0) | (rx_byte >= 0 ? (1 << RXC0) : 0);
+}
+
+//===========================================================================
+//============================= pins ========================================
+//===========================================================================
+
+static void sim_update_endstops(int axis)
+{
+  for (int i = 0; i < endstop_count; i++) {
+    sim_endstop &e = endstops[i];
+    if (e.axis != axis) continue;
+    bool triggered = e.forced || (e.side < 0 ? axes[axis].pulses <= e.trigger : axes[axis].pulses >= e.trigger);
+    uint8_t old = e.pin->value;
+    if (triggered != e.inverting)
+      e.pin->value |= e.mask;
+    else
+      e.pin->value &= ~e.mask;
+    if (e.pin->value != old) {
+      const volatile uint8_t *pcmsk[] = { &PCMSK0, &PCMSK1, &PCMSK2 };
+      if (e.ext >= 0 ? (EIMSK & (1 << e.ext)) != 0 :
+          e.bank >= 0 && (PCICR & (1 << e.bank)) && (*pcmsk[e.bank] & (1 << e.bit)))
+        e.pending = true;
+    }
+  }
+}
+
+// Runs the interrupts of the endstop pins that changed, returns whether there were any
+static bool sim_pin_interrupts()
+{
+  bool ran = false;
+  for (int i = 0; i < endstop_count; i++) {
+    sim_endstop &e = endstops[i];
+    if (!e.pending) continue;
+    e.pending = false;
+    void (*const ext_vect[])(void) = { INT0_vect, INT1_vect, INT2_vect, INT3_vect, INT4_vect, INT5_vect };
+    void (*const pcint_vect[])(void) = { PCINT0_vect, PCINT1_vect, PCINT2_vect };
+    void (*vect)(void) = e.ext >= 0 ? ext_vect[e.ext] : pcint_vect[e.bank];
+    if (!vect) continue;
+    uint8_t sreg = SREG;
+    SREG &= ~0x80;
+    vect();
+    SREG = sreg;
+    ran = true;
+  }
+  return ran;
+}
+
+static void sim_step(int axis, int dir)
+{
+  axes[axis].pulses += dir;
+  axes[axis].travel++;
+  stats.steps++;
+  isr_steps++;
+
+  uint64_t h = stats.hash;
+  uint8_t rec[10];
+  memcpy(rec, &sim_clock, 8);
+  rec[8] = axis;
+  rec[9] = dir > 0;
+  for (int i = 0; i < 10; i++) { h ^= rec[i]; h *= 1099511628211ULL; }
+  stats.hash = h;
+
+  if (trace_file) fprintf(trace_file, "%llu %c %+d\n", (unsigned long long)sim_clock, "XYZE"[axis], dir);
+  sim_update_endstops(axis);
+}
+
+void sim_port_write(uint8_t id, uint8_t old_value, uint8_t new_value)
+{
+  stats.port_writes++;
+  for (int a = 0; a < NUM_AXIS; a++) {
+    sim_axis &ax = axes[a];
+    if (ax.step_id != id) continue;
+    bool was = (old_value & ax.step_mask) != 0, now = (new_value & ax.step_mask) != 0;
+    if (was != now && now != ax.step_invert) {
+      bool level = (ax.dir_port->value & ax.dir_mask) != 0;
+      sim_step(a, level != ax.dir_invert ? 1 : -1);
+    }
+  }
+}
+
+#define SIM_AXIS(A, LETTER, STEP_INV, DIR_INV) { \
+    axes[A].step_id = SIM_WPORT(LETTER##_STEP_PIN).id; \
+    axes[A].step_mask = SIM_MASK(LETTER##_STEP_PIN); \
+    axes[A].step_invert = STEP_INV; \
+    axes[A].dir_port = __builtin_addressof(SIM_WPORT(LETTER##_DIR_PIN)); \
+    axes[A].dir_mask = SIM_MASK(LETTER##_DIR_PIN); \
+    axes[A].dir_invert = DIR_INV; }
+
+#define SIM_ENDSTOP(A, PIN, SIDE, MM, INVERTING) { \
+    sim_endstop &e = endstops[endstop_count++]; \
+    e.axis = A; e.side = SIDE; e.trigger = lround((MM) * steps_per_unit[A]); \
+    e.pin = __builtin_addressof(SIM_RPORT(PIN)); e.mask = SIM_MASK(PIN); e.inverting = INVERTING; \
+    e.ext = DIO_EXT_INTERRUPT(PIN); e.bank = DIO_PCINT_BANK(PIN); e.bit = DIO_PCINT_BIT(PIN); \
+    e.pending = false; e.forced = false; }
+
+static void sim_init_pins()
+{
+  // Idle inputs read high (pullups), that keeps the kill button released
+  #define SIM_PIN_IDLE(P) PIN##P.value = 0xff;
+  SIM_PIN_IDLE(A) SIM_PIN_IDLE(B) SIM_PIN_IDLE(C) SIM_PIN_IDLE(D)
+  SIM_PIN_IDLE(E) SIM_PIN_IDLE(F) SIM_PIN_IDLE(G) SIM_PIN_IDLE(H)
+  SIM_PIN_IDLE(J) SIM_PIN_IDLE(K) SIM_PIN_IDLE(L)
+
+  SIM_AXIS(X_AXIS, X, INVERT_X_STEP_PIN, INVERT_X_DIR);
+  SIM_AXIS(Y_AXIS, Y, INVERT_Y_STEP_PIN, INVERT_Y_DIR);
+  SIM_AXIS(Z_AXIS, Z, INVERT_Z_STEP_PIN, INVERT_Z_DIR);
+  SIM_AXIS(E_AXIS, E0, INVERT_E_STEP_PIN, INVERT_E0_DIR);
+
+  // The arm switches sit 30 degrees above the power up angles, psi can
+  // swing 120 degrees below it before the calibration switch. The bed is
+  // 15mm under the nozzle.
+  const float steps_per_unit[] = DEFAULT_AXIS_STEPS_PER_UNIT;
+  #if X_MIN_PIN > -1
+    SIM_ENDSTOP(X_AXIS, X_MIN_PIN, -1, -1000, X_ENDSTOPS_INVERTING);
+  #endif
+  #if X_MAX_PIN > -1
+    SIM_ENDSTOP(X_AXIS, X_MAX_PIN, 1, 30, X_ENDSTOPS_INVERTING);
+  #endif
+  #if Y_MIN_PIN > -1
+    SIM_ENDSTOP(Y_AXIS, Y_MIN_PIN, -1, -120, Y_ENDSTOPS_INVERTING);
+  #endif
+  #if Y_MAX_PIN > -1
+    SIM_ENDSTOP(Y_AXIS, Y_MAX_PIN, 1, 30, Y_ENDSTOPS_INVERTING);
+  #endif
+  #if Z_MIN_PIN > -1
+    SIM_ENDSTOP(Z_AXIS, Z_MIN_PIN, -1, -15, Z_ENDSTOPS_INVERTING);
+  #endif
+  #if Z_MAX_PIN > -1
+    SIM_ENDSTOP(Z_AXIS, Z_MAX_PIN, 1, 1000, Z_ENDSTOPS_INVERTING);
+  #endif
+  for (int a = 0; a < NUM_AXIS; a++) sim_update_endstops(a);
+}
+
+//===========================================================================
+//============================= virtual clock ===============================
+//===========================================================================
+
+uint64_t sim_host_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Time stamp counter of the host CPU where there is one, for per call timings
+static uint64_t sim_host_ticks()
+{
+  #if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+  #else
+    return 0;
+  #endif
+}
+
+// plan_buffer_line() is linked with --wrap (see the Makefile), so every call
+// from the firmware and from the benchmark comes through here. Waiting for
+// room in the buffer runs the virtual clock and is not counted.
+void __real_plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder, const float &cartesian_mm)
+  __asm__("__real__Z16plan_buffer_lineRKfS0_S0_S0_fRKhS0_");
+void sim_plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder, const float &cartesian_mm)
+  __asm__("__wrap__Z16plan_buffer_lineRKfS0_S0_S0_fRKhS0_");
+
+void sim_plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder, const float &cartesian_mm)
+{
+  uint64_t t0 = sim_host_ns(), adv0 = stats.advance_ns;
+  __real_plan_buffer_line(x, y, z, e, feed_rate, extruder, cartesian_mm);
+  uint64_t dt = (sim_host_ns() - t0) - (stats.advance_ns - adv0);
+  dt = dt > host_ns_overhead ? dt - host_ns_overhead : 0;
+  stats.planner_calls++;
+  stats.planner_ns += dt;
+  if (dt > stats.planner_ns_max) stats.planner_ns_max = dt;
+  if (joint_log && joint_log_len < joint_log_size) {
+    float *entry = joint_log + 3 * joint_log_len++;
+    entry[0] = x;
+    entry[1] = y;
+    entry[2] = cartesian_mm;
+  }
+}
+
+static uint32_t timer1_prescaler()
+{
+  static const uint32_t div[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+  return div[TCCR1B & 0x07];
+}
+
+static void sim_timer1_isr()
+{
+  uint8_t sreg = SREG;
+  SREG &= ~0x80;
+  unsigned char tail = block_buffer_tail;
+  isr_steps = 0;
+
+  unsigned long writes = stats.port_writes;
+  uint64_t t0 = sim_host_ns();
+  TIMER1_COMPA_vect();
+  uint64_t dt = sim_host_ns() - t0;
+  stats.isr_port_writes += stats.port_writes - writes;
+  dt = dt > host_ns_overhead ? dt - host_ns_overhead : 0;
+
+  SREG = sreg;
+  stats.isr_count++;
+  stats.isr_ns += dt;
+  if (dt > stats.isr_ns_max) stats.isr_ns_max = dt;
+  if (isr_steps) {
+    stats.isr_stepping++;
+    stats.isr_stepping_ns += dt;
+    if (isr_log_len < isr_log_size) {
+      sim_isr_entry *entry = &isr_log[isr_log_len++];
+      entry->clock = sim_clock;
+      entry->steps = isr_steps;
+      entry->block_end = tail != block_buffer_tail;
+    }
+  }
+  if (tail != block_buffer_tail) {
+    stats.blocks_done++;
+    if (!blocks_queued() && !host_done()) stats.buffer_dry++;
+  }
+}
+
+void sim_advance(uint64_t cycles)
+{
+  uint64_t t0 = sim_host_ns();
+  uint64_t target = sim_clock + cycles;
+  for (;;) {
+    bool timer1_on = timer1_prescaler() != 0;
+    bool timer1_enabled = (TIMSK1 & (1 << OCIE1A)) && (SREG & 0x80);
+    if ((SREG & 0x80) && sim_pin_interrupts()) continue;
+    if (timer1_pending && timer1_enabled) {
+      // A match happened while masked, the interrupt runs as soon as it
+      // is allowed and the counter restarts from there.
+      timer1_pending = false;
+      timer1_match = sim_clock;
+      sim_timer1_isr();
+      continue;
+    }
+    uint64_t next = target + 1;
+    int event = 0;
+    if (timer1_on) {
+      uint64_t t = timer1_match + ((uint64_t)OCR1A + 1) * timer1_prescaler();
+      if (t < next) { next = t; event = 1; }
+    }
+    if (rx_byte < 0 && host_can_send() && (UCSR0B & (1 << RXCIE0)) && (SREG & 0x80)) {
+      uint64_t t = rx_next > sim_clock ? rx_next : sim_clock;
+      if (!host_in_line && host_ready > t) t = host_ready;
+      if (t < next) { next = t; event = 2; }
+    }
+    if (event == 0) break;
+    sim_clock = next;
+    if (event == 1) {
+      timer1_match = next;
+      if (timer1_enabled)
+        sim_timer1_isr();
+      else
+        timer1_pending = true;
+    }
+    else {
+      char c = host_script[host_pos++];
+      host_in_line = c != '\n';
+      if (c == '\n') host_unacked++;
+      rx_byte = (uint8_t)c;
+      rx_next = sim_clock + SIM_BYTE_CYCLES;
+      USART0_RX_vect();
+    }
+  }
+  sim_clock = target;
+  stats.advance_ns += sim_host_ns() - t0;
+}
+
+// Called from the foreground's idle calls, stands in for the LCD buttons
+static void (*idle_hook)() = NULL;
+
+void sim_idle()
+{
+  sim_advance(SIM_LOOP_CYCLES);
+  if (idle_hook != NULL) idle_hook();
+}
+
+//===========================================================================
+//============================= Arduino core ================================
+//===========================================================================
+
+unsigned long millis(void) { return sim_clock / (F_CPU / 1000); }
+unsigned long micros(void) { return sim_clock / (F_CPU / 1000000); }
+void delay(unsigned long ms) { sim_advance((uint64_t)ms * (F_CPU / 1000)); }
+void delayMicroseconds(unsigned int us) { sim_advance((uint64_t)us * (F_CPU / 1000000)); }
+void _delay_ms(double ms) { sim_advance((uint64_t)(ms * (F_CPU / 1000))); }
+void _delay_us(double us) { sim_advance((uint64_t)(us * (F_CPU / 1000000))); }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+int digitalRead(uint8_t pin) { return LOW; }
+void analogWrite(uint8_t pin, int value) {}
+
+static uint8_t eeprom[4096];
+uint8_t eeprom_read_byte(const uint8_t *addr) { return eeprom[(size_t)addr % sizeof(eeprom)]; }
+void eeprom_write_byte(uint8_t *addr, uint8_t value) { eeprom[(size_t)addr % sizeof(eeprom)] = value; }
+
+//===========================================================================
+//============================= driver ======================================
+//===========================================================================
+
+static void sim_reset()
+{
+  memset(eeprom, 0xff, sizeof(eeprom));
+  sim_init_pins();
+  uint64_t t0 = sim_host_ns();
+  for (int i = 0; i < 1000; i++) sim_host_ns();
+  host_ns_overhead = (sim_host_ns() - t0) / 1001;
+  setup();
+}
+
+// Runs the main loop until the host has sent everything, all of it has been
+// acknowledged and the steppers have stopped.
+static bool sim_run_until_idle()
+{
+  while (!host_done() || blocks_queued() || current_block != NULL) {
+    loop();
+    if (sim_clock > SIM_TIME_LIMIT) {
+      fprintf(stderr, "marlin_sim: no progress after %lu virtual seconds\n", (unsigned long)(SIM_TIME_LIMIT / F_CPU));
+      return false;
+    }
+  }
+  return true;
+}
+
+static void sim_report(const char *title)
+{
+  printf("%s\n", title);
+  printf("  virtual time      %.3f s\n", (double)sim_clock / F_CPU);
+  printf("  lines acked       %lu, errors %lu, warnings %lu, endstop hits %lu\n",
+         stats.lines_acked, stats.errors, stats.warnings, stats.endstop_hits);
+  printf("  blocks executed   %lu, buffer ran dry %lu times while the host was sending\n",
+         stats.blocks_done, stats.buffer_dry);
+  printf("  steps             X %ld  Y %ld  Z %ld  E %ld (pin level, signed)\n",
+         axes[X_AXIS].pulses, axes[Y_AXIS].pulses, axes[Z_AXIS].pulses, axes[E_AXIS].pulses);
+  printf("  step stream hash  %016llx (%lu steps)\n", (unsigned long long)stats.hash, stats.steps);
+  if (stats.planner_calls)
+    printf("  plan_buffer_line  %lu calls, avg %.2f us, max %.2f us (host)\n", stats.planner_calls,
+           stats.planner_ns / 1000.0 / stats.planner_calls, stats.planner_ns_max / 1000.0);
+  printf("  stepper ISR       %lu calls, avg %.0f ns, max %llu ns (host)\n", stats.isr_count,
+         stats.isr_count ? (double)stats.isr_ns / stats.isr_count : 0.0, (unsigned long long)stats.isr_ns_max);
+  if (stats.isr_stepping)
+    printf("  stepping ISR      %lu calls, avg %.0f ns, %.1f ns per step (host)\n", stats.isr_stepping,
+           (double)stats.isr_stepping_ns / stats.isr_stepping, (double)stats.isr_stepping_ns / stats.steps);
+}
+
+static const char demo_gcode[] =
+  "G28\n"
+  "G1 X100 Y100 Z5 F6000\n"
+  "G1 X150 Y100 E2 F3000\n"
+  "G1 X150 Y150 E4\n"
+  "G1 X100 Y150 E6\n"
+  "G1 X100 Y100 E8\n";
+
+static int cmd_run(int argc, char **argv)
+{
+  const char *file = NULL;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+      host_delay = (uint64_t)(atof(argv[++i]) * (F_CPU / 1000));
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      trace_file = fopen(argv[++i], "w");
+      if (!trace_file) { perror(argv[i]); return 1; }
+    }
+    else file = argv[i];
+  }
+
+  if (file) {
+    if (!host_queue_file(file)) return 1;
+  }
+  else
+    host_queue(demo_gcode);
+
+  sim_reset();
+  bool ok = sim_run_until_idle();
+  if (trace_file) fclose(trace_file);
+  sim_report(file ? file : "demo");
+  return ok && stats.errors == 0 ? 0 : 1;
+}
+
+static int cmd_bench(int argc, char **argv)
+{
+  // With a G-code file, time the planner on the blocks prepare_move() makes
+  if (argc > 0 && !isdigit(argv[0][0])) {
+    if (!host_queue_file(argv[0])) return 1;
+    sim_reset();
+    bool ok = sim_run_until_idle();
+    sim_report(argv[0]);
+    return ok ? 0 : 1;
+  }
+
+  long blocks = argc > 0 ? atol(argv[0]) : 20000;
+  host_queue("G28\n");
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+
+  // Small circles in joint space around the homed angles, 0.3 degree per
+  // block at 50 degrees/s is 6ms per block, close to what prepare_move
+  // produces at DELTA_SEGMENTS_PER_SECOND.
+  float base[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) base[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+  const float radius = 10, seg = 0.3;
+  const int per_circle = (int)(2 * M_PI * radius / seg);
+  unsigned long isr_before = stats.isr_count, stepping_before = stats.isr_stepping, steps_before = stats.steps;
+  uint64_t isr_ns_before = stats.isr_ns, stepping_ns_before = stats.isr_stepping_ns;
+  uint64_t planner_ns_before = stats.planner_ns;
+  unsigned long writes_before = stats.isr_port_writes;
+  stats.isr_ns_max = 0;
+
+  for (long n = 1; n <= blocks; n++) {
+    float a = 2 * M_PI * (n % per_circle) / per_circle;
+    float x = base[X_AXIS] - radius + radius * cos(a);
+    float y = base[Y_AXIS] + radius * sin(a);
+    float e = base[E_AXIS] + n * 0.01;
+    plan_buffer_line(x, y, base[Z_AXIS], e, 50, 0);
+  }
+  st_synchronize();
+
+  unsigned long isrs = stats.isr_count - isr_before, stepping = stats.isr_stepping - stepping_before;
+  unsigned long steps = stats.steps - steps_before;
+  uint64_t planner_ns = stats.planner_ns - planner_ns_before;
+  printf("plan_buffer_line    %ld blocks, %.2f us per block, %.0f blocks/s (host, BLOCK_BUFFER_SIZE %d)\n",
+         blocks, planner_ns / 1000.0 / blocks, blocks * 1e9 / planner_ns, BLOCK_BUFFER_SIZE);
+  printf("stepper ISR         %lu calls, avg %.0f ns, max %llu ns (host)\n",
+         isrs, (double)(stats.isr_ns - isr_ns_before) / isrs, (unsigned long long)stats.isr_ns_max);
+  printf("stepping ISR        %lu calls, %.1f ns per step over %lu steps (host)\n",
+         stepping, (double)(stats.isr_stepping_ns - stepping_ns_before) / steps, steps);
+  printf("ISR port writes     %.2f per step\n", (double)(stats.isr_port_writes - writes_before) / steps);
+  printf("virtual time        %.3f s\n", (double)sim_clock / F_CPU);
+  return 0;
+}
+
+struct check_result {
+  uint64_t hash, clock;
+  unsigned long steps;
+  long counts[NUM_AXIS];
+};
+
+static const char check_home[] =
+  "G28\n"
+  "G1 X100 Y100 Z5 F6000\n"
+  "M400\n";
+
+// Runs the check program, returns the number of failed checks
+static int check_program(check_result &res)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  // Homing resets the firmware's counters, compare from here on
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  unsigned long endstop_hits = stats.endstop_hits;
+
+  // Straight lines, a 72 sided circle and a short zig-zag, then back
+  char buf[96];
+  host_queue("G1 X150 Y100 E2 F3000\nG1 X150 Y150 Z6 E4\nG1 X60 Y60 E8 F9000\n");
+  for (int i = 0; i <= 72; i++) {
+    float a = 2 * M_PI * i / 72;
+    sprintf(buf, "G1 X%.3f Y%.3f E%.3f F4800\n", 100 + 40 * cos(a), 90 + 40 * sin(a), 8 + i * 0.05);
+    host_queue(buf);
+  }
+  for (int i = 0; i < 20; i++) {
+    sprintf(buf, "G1 X%d Y%d F6000\n", 80 + (i & 1) * 2, 80 + i);
+    host_queue(buf);
+  }
+  host_queue("G1 X100 Y100 Z5 F6000\nM400\n");
+  if (!sim_run_until_idle()) return 1;
+
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld\n", "XYZE"[i], pins, counted);
+      failed++;
+    }
+  }
+  for (int i = X_AXIS; i <= Z_AXIS; i++) {
+    if (st_get_position(i) != start[i]) {
+      printf("FAIL: axis %c ended at %ld steps, started at %ld\n", "XYZE"[i], st_get_position(i), start[i]);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings || stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu errors, %lu warnings, %lu unexpected endstop hits\n",
+           stats.errors, stats.warnings, stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+  res.hash = stats.hash;
+  res.clock = sim_clock;
+  res.steps = stats.steps;
+  for (int i = 0; i < NUM_AXIS; i++) res.counts[i] = st_get_position(i);
+  return failed;
+}
+
+static int cmd_check(int argc, char **argv)
+{
+  // The second run happens in a child process so it starts from the same
+  // power up state as the first.
+  int fds[2];
+  if (pipe(fds) != 0) { perror("pipe"); return 1; }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    check_result res;
+    memset(&res, 0, sizeof(res));
+    freopen("/dev/null", "w", stdout);
+    check_program(res);
+    ssize_t written = write(fds[1], &res, sizeof(res));
+    _exit(written == sizeof(res) ? 0 : 1);
+  }
+  close(fds[1]);
+
+  check_result res, twin;
+  memset(&res, 0, sizeof(res));
+  memset(&twin, 0, sizeof(twin));
+  int failed = check_program(res);
+  if (read(fds[0], &twin, sizeof(twin)) != sizeof(twin)) {
+    printf("FAIL: second run did not report back\n");
+    failed++;
+  }
+  else if (memcmp(&res, &twin, sizeof(res)) != 0) {
+    printf("FAIL: second run produced a different step stream (%016llx, %016llx)\n",
+           (unsigned long long)res.hash, (unsigned long long)twin.hash);
+    failed++;
+  }
+  waitpid(pid, NULL, 0);
+
+  sim_report("check");
+  printf(failed ? "check: %d FAILED\n" : "check: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+// Runs calculate_trapezoid_for_block() on pseudo random blocks and prints the results. Given the
+// output of a build with the other trapezoid math (PLANNER_FIXED_POINT), compares against it
+// instead: the rates have to match exactly, the step indexes within 1 step + 0.01% of the block.
+static int cmd_trapezoid(int argc, char **argv)
+{
+  FILE *ref = NULL;
+  if (argc > 0) {
+    ref = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "r");
+    if (!ref) { perror(argv[0]); return 1; }
+  }
+  const long blocks = 200000;
+  uint32_t seed = 1;
+  long failed = 0, worst = 0, differ = 0;
+  for (long n = 0; n < blocks; n++) {
+    block_t block;
+    memset(&block, 0, sizeof(block));
+    // Log distributed lengths, rates and accelerations over what the firmware can see
+    seed = seed * 1103515245 + 12345;
+    block.step_event_count = (unsigned long)exp((seed >> 8) % 1000 * 0.011);        // 1 .. 60000
+    seed = seed * 1103515245 + 12345;
+    block.nominal_rate = (unsigned long)(120 * exp((seed >> 8) % 1000 * 0.0068));    // 120 .. 107000
+    seed = seed * 1103515245 + 12345;
+    block.acceleration_st = (unsigned long)(50 * exp((seed >> 8) % 1000 * 0.0106));  // 50 .. 2000000
+    seed = seed * 1103515245 + 12345;
+    float entry_factor = (seed >> 8) % 1001 / 1000.0;
+    seed = seed * 1103515245 + 12345;
+    float exit_factor = (seed >> 8) % 1001 / 1000.0;
+#ifdef PLANNER_FIXED_POINT
+    calculate_acceleration_inverse(&block);
+#endif
+    calculate_trapezoid_for_block(&block, entry_factor, exit_factor);
+    if (!ref) {
+      printf("%ld %ld %lu %lu\n", block.accelerate_until, block.decelerate_after,
+             block.initial_rate, block.final_rate);
+      continue;
+    }
+    long accelerate_until, decelerate_after;
+    unsigned long initial_rate, final_rate;
+    if (fscanf(ref, "%ld %ld %lu %lu", &accelerate_until, &decelerate_after, &initial_rate, &final_rate) != 4) {
+      printf("FAIL: reference ends at block %ld\n", n);
+      return 1;
+    }
+    long tolerance = 1 + block.step_event_count / 10000;
+    long error = max(labs(block.accelerate_until - accelerate_until), labs(block.decelerate_after - decelerate_after));
+    if (error) differ++;
+    worst = max(worst, error);
+    if (block.initial_rate != initial_rate || block.final_rate != final_rate || error > tolerance) {
+      if (failed++ < 10) {
+        printf("FAIL: %lu steps, rate %lu, acceleration %lu, factors %.3f %.3f: %ld %ld %lu %lu, reference %ld %ld %lu %lu\n",
+               block.step_event_count, block.nominal_rate, block.acceleration_st, entry_factor, exit_factor,
+               block.accelerate_until, block.decelerate_after, block.initial_rate, block.final_rate,
+               accelerate_until, decelerate_after, initial_rate, final_rate);
+      }
+    }
+  }
+  if (ref) {
+    printf("trapezoid: %ld blocks, %ld differ from the reference, by at most %ld steps\n", blocks, differ, worst);
+    printf(failed ? "trapezoid: %ld FAILED\n" : "trapezoid: all passed\n", failed);
+  }
+  return failed ? 1 : 0;
+}
+
+// Runs every step rate up to MAX_STEP_FREQUENCY as a cruising block and compares the timer value
+// the stepper interrupt sets with the exact division. Between two table entries at rates a and b
+// linear interpolation of 1/rate is off by (rate-a)(b-rate)/(ab), the timer has to be within that
+// and 2 ticks of rounding. The interrupt is called directly, the timer does not run.
+static int cmd_timers(int argc, char **argv)
+{
+  host_queue("G28\n");
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+
+  double worst = 0, worst_exact = 0, total = 0;
+  unsigned long worst_rate = 0, worst_timer = 0, failed = 0;
+  for (unsigned long rate = 1; rate <= MAX_STEP_FREQUENCY; rate++) {
+    block_t *block = &block_buffer[block_buffer_head];
+    memset(block, 0, sizeof(*block));
+    block->steps_x = block->step_event_count = 1000;
+    block->decelerate_after = block->step_event_count;
+    block->nominal_rate = block->initial_rate = block->final_rate = rate;
+    block->direction_bits = (rate & 1) << X_AXIS; // Back and forth, away from the endstops
+    block_buffer_head = (block_buffer_head + 1) & (BLOCK_BUFFER_SIZE - 1);
+#ifdef STEP_SEGMENT_BUFFER
+    st_prepare_segments();
+#endif
+    TIMER1_COMPA_vect();
+    unsigned long timer = OCR1A;
+    quickStop();
+
+    // Above MAX_STEP_ISR_FREQUENCY the interrupt does 2, 4 or 8 steps each time
+    unsigned long x = rate;
+    while (x > MAX_STEP_ISR_FREQUENCY) x >>= 1;
+    x = max(x, (unsigned long)SPEED_LOOKUPTABLE_OFFSET) - SPEED_LOOKUPTABLE_OFFSET;
+    unsigned long h = x < 8 * 256 ? 8 : 1 << SPEED_LOOKUPTABLE_FAST_SHIFT;
+    double a = (x & ~(h - 1)) + SPEED_LOOKUPTABLE_OFFSET, b = a + h, r = x + SPEED_LOOKUPTABLE_OFFSET;
+    double exact = STEPPER_TIMER_RATE / r;
+    double error = fabs(timer - exact) / exact;
+    total += error;
+    if (error > worst) { worst = error; worst_exact = exact; worst_rate = rate; worst_timer = timer; }
+    if (error > (r - a) * (b - r) / (a * b) + 2 / exact && failed++ < 10)
+      printf("FAIL: rate %lu timer %lu, exact %.1f\n", rate, timer, exact);
+  }
+  printf("timers: timer 1 at %lu Hz, fast table entries of %d steps/s\n",
+         (unsigned long)STEPPER_TIMER_RATE, 1 << SPEED_LOOKUPTABLE_FAST_SHIFT);
+  printf("  error             mean %.4f%%, max %.4f%% (rate %lu timer %lu, exact %.1f)\n",
+         total * 100 / MAX_STEP_FREQUENCY, worst * 100, worst_rate, worst_timer, worst_exact);
+  printf(failed ? "timers: %lu FAILED\n" : "timers: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+// Moves the X arm out and back in joint space from where check_home leaves it, the path the
+// multistep check watches.
+static void multistep_move(float degrees, float feedrate, float base[NUM_AXIS])
+{
+  plan_buffer_line(base[X_AXIS] + degrees, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], feedrate, 0);
+  plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], feedrate, 0);
+}
+
+// Goes through the stepping interrupts recorded over one run of moves. The interval to the next
+// interrupt divided by the step events taken is the step interval. Where an interrupt took fewer
+// step events than both its neighbours, it ended a block or a segment early and its interval says
+// nothing, the same for the interrupts that finished a block. From one interrupt to the next the
+// step interval may change by what twice the acceleration does over the interval (over a segment
+// with STEP_SEGMENT_BUFFER, the rate only changes between them), the rest is reported as a jump.
+// Rates under a quarter of MAX_STEP_ISR_FREQUENCY take a step per interrupt and are left out.
+struct multistep_result {
+  double fastest_isr;                  // Hz
+  double worst_jump;                   // largest change of the step interval the ramps don't explain
+  unsigned long switches;              // changes of the step events per interrupt
+  unsigned char max_loops;
+};
+
+static void multistep_analyze(multistep_result &res)
+{
+  const double acceleration = 2.0 * axis_steps_per_sqr_second[X_AXIS];
+  double last_interval = 0, last_ramp = 0;
+  unsigned char loops = 0;
+  res.fastest_isr = res.worst_jump = 0;
+  res.switches = 0;
+  res.max_loops = 0;
+  for (unsigned long i = 0; i + 1 < isr_log_len; i++) {
+    sim_isr_entry *entry = &isr_log[i];
+    double isr_interval = (double)(isr_log[i + 1].clock - entry->clock) / F_CPU;
+    res.fastest_isr = max(res.fastest_isr, 1 / isr_interval);
+    bool partial = i > 0 && entry->steps < isr_log[i - 1].steps && entry->steps < isr_log[i + 1].steps;
+    if (entry->block_end || partial) {
+      last_interval = 0;
+      continue;
+    }
+    if (loops && entry->steps != loops) res.switches++;
+    loops = entry->steps;
+    res.max_loops = max(res.max_loops, loops);
+    double interval = isr_interval / entry->steps;
+    if (interval > 4.0 / MAX_STEP_ISR_FREQUENCY) interval = 0;
+    if (last_interval && interval) {
+      double jump = fabs(interval - last_interval) / last_interval - last_ramp;
+      res.worst_jump = max(res.worst_jump, jump);
+    }
+    // Relative change of the rate the acceleration can make before the next interrupt
+    #ifdef STEP_SEGMENT_BUFFER
+      last_ramp = acceleration * STEP_SEGMENT_TIME / 1000000 * interval;
+    #else
+      last_ramp = acceleration * isr_interval * interval;
+    #endif
+    last_interval = interval;
+  }
+}
+
+// Runs moves that cross the MAX_STEP_ISR_FREQUENCY multiples: ramps up to MAX_STEP_FREQUENCY and
+// back, moves cruising at rates around the first threshold and a run of short blocks whose rates
+// alternate just over and under it. The interrupt must not run faster than the ceiling (1% for the
+// speed tables), the step interval must not jump by more than 2% from one interrupt to the next
+// and over a run from rest to rest the count may only switch up and down once per threshold.
+static int cmd_multistep(int argc, char **argv)
+{
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  float base[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) base[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+  long start[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) start[i] = st_get_position(i);
+  unsigned long endstop_hits = stats.endstop_hits;
+
+  isr_log_size = 1 << 20;
+  isr_log = (sim_isr_entry *)malloc(isr_log_size * sizeof(sim_isr_entry));
+  const float steps_per_degree = axis_steps_per_unit[X_AXIS];
+  unsigned long failed = 0, runs = 0, switches = 0;
+  double fastest_isr = 0, worst_jump = 0;
+  unsigned char max_loops = 0;
+  for (int run = 0; run < 33; run++) {
+    isr_log_len = 0;
+    if (run == 0) {
+      multistep_move(60, 1.1 * MAX_STEP_FREQUENCY / steps_per_degree, base);
+    }
+    else if (run < 32) {
+      // Cruise at 15 rates each side of the ceiling
+      float rate = MAX_STEP_ISR_FREQUENCY + (run - 16) * MAX_STEP_ISR_FREQUENCY / 500;
+      multistep_move(15, rate / steps_per_degree, base);
+    }
+    else {
+      for (int i = 1; i <= 40; i++) {
+        float rate = MAX_STEP_ISR_FREQUENCY * (i & 1 ? 1.03 : 0.97);
+        plan_buffer_line(base[X_AXIS] + i * 1.5, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], rate / steps_per_degree, 0);
+      }
+      plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], MAX_STEP_ISR_FREQUENCY / steps_per_degree, 0);
+    }
+    st_synchronize();
+    runs++;
+
+    multistep_result res;
+    multistep_analyze(res);
+    unsigned char thresholds = 0;
+    for (unsigned char loops = res.max_loops; loops > 1; loops >>= 1) thresholds++;
+    // Out and back are two runs from rest to rest
+    unsigned long allowed = (run < 32 ? 4 : 2) * thresholds;
+    if (res.fastest_isr > MAX_STEP_ISR_FREQUENCY * 1.01 || res.worst_jump > 0.02 || res.switches > allowed) {
+      if (failed++ < 10)
+        printf("FAIL: run %d interrupt up to %.0f Hz, step interval jumps %.2f%%, %lu switches of %lu allowed\n",
+               run, res.fastest_isr, res.worst_jump * 100, res.switches, allowed);
+    }
+    fastest_isr = max(fastest_isr, res.fastest_isr);
+    worst_jump = max(worst_jump, res.worst_jump);
+    switches += res.switches;
+    max_loops = max(max_loops, res.max_loops);
+  }
+  free(isr_log);
+  isr_log = NULL;
+  isr_log_size = 0;
+
+  for (int i = 0; i < NUM_AXIS; i++) {
+    if (st_get_position(i) != start[i]) {
+      printf("FAIL: axis %c ended at %ld steps, started at %ld\n", "XYZE"[i], st_get_position(i), start[i]);
+      failed++;
+    }
+  }
+  if (stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu unexpected endstop hits\n", stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+  printf("multistep: %lu runs up to %d steps/s, interrupt ceiling %d Hz\n",
+         runs, MAX_STEP_FREQUENCY, MAX_STEP_ISR_FREQUENCY);
+  printf("  interrupt         fastest %.0f Hz, up to %d step events each\n", fastest_isr, max_loops);
+  printf("  step interval     jumps by at most %.2f%% between interrupts, beyond the ramps\n", worst_jump * 100);
+  printf("  step events       %lu changes of the count per interrupt\n", switches);
+  printf(failed ? "multistep: %lu FAILED\n" : "multistep: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+// Runs the steppers until the X arm has taken steps steps from where it was, then stops the moves
+// with stop_moves(). Returns the step rate of the arm when it was stopped and in stop_steps the
+// steps it took to come to a stop, from the intervals of the stepping interrupts.
+static double stop_after(long steps, long &stop_steps)
+{
+  unsigned long travel = axes[X_AXIS].travel + steps;
+  while (axes[X_AXIS].travel < travel && (blocks_queued() || current_block != NULL)) {
+    manage_inactivity();
+    sim_advance(F_CPU / 20000);
+  }
+  double rate = 0;
+  if (isr_log_len >= 2) {
+    sim_isr_entry *last = &isr_log[isr_log_len - 1];
+    rate = isr_log[isr_log_len - 2].steps * (double)F_CPU / (last->clock - isr_log[isr_log_len - 2].clock);
+  }
+  travel = axes[X_AXIS].travel;
+  stop_moves();
+  stop_steps = axes[X_AXIS].travel - travel;
+  return rate;
+}
+
+// Where the LCD stop below left the arms, it stops once the arms have stepped lcd_stop_travel
+static unsigned long lcd_stop_travel;
+static float lcd_stopped[NUM_AXIS];
+static long lcd_stopped_at[NUM_AXIS];
+
+// Stops the moves like the LCD does once a move waits for room in the buffer
+static void lcd_stop_hook()
+{
+  if (axes[X_AXIS].travel + axes[Y_AXIS].travel < lcd_stop_travel || !plan_buffer_full()) return;
+  idle_hook = NULL;
+  stop_moves();
+  for (int i = 0; i < NUM_AXIS; i++) {
+    lcd_stopped[i] = current_position[i];
+    lcd_stopped_at[i] = st_get_position(i);
+  }
+}
+
+// Stops moves of the X arm at full speed, while accelerating and in the middle of a run of short
+// blocks. The arm has to slow down like it does on a planned ramp (step interval jumps of at most
+// 2% at the rates the multistep check looks at), within the steps a stop from its rate takes at
+// the acceleration plus one block, and end at a crawl. With the moves after it discarded, the
+// planner takes over from where the arm stopped. A stop in a G1 of the G-code has to leave
+// current_position where the forward kinematics put the arms: the angles back from it are the
+// ones counted. The LCD stopping a G1 and a G2 while they wait for room in the buffer has to drop
+// the rest of them: the arms stay where they stopped and so does current_position. A stop while
+// plan_buffer_line() itself waits leaves only the block that waited, from where the arm stopped. Throughout, the
+// pins have to take the steps the firmware counted.
+static int cmd_stop(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  float base[NUM_AXIS], home[NUM_AXIS];
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    home[i] = current_position[i];
+    base[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  unsigned long endstop_hits = stats.endstop_hits;
+
+  isr_log_size = 1 << 20;
+  isr_log = (sim_isr_entry *)malloc(isr_log_size * sizeof(sim_isr_entry));
+  const float steps_per_degree = axis_steps_per_unit[X_AXIS];
+  const double acceleration = axis_steps_per_sqr_second[X_AXIS];
+  double worst_jump = 0, worst_end = 0;
+  long worst_over = 0, chain_over = 0;
+  for (int run = 0; run < 4; run++) {
+    isr_log_len = 0;
+    long block_steps;
+    long steps;
+    if (run < 3) {
+      // Cruising, accelerating and cruising close to MAX_STEP_FREQUENCY
+      float rate = run == 2 ? 0.9 * MAX_STEP_FREQUENCY : 0.5 * MAX_STEP_FREQUENCY;
+      plan_buffer_line(base[X_AXIS] + 60, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], rate / steps_per_degree, 0);
+      block_steps = lround(60 * steps_per_degree);
+      steps = run == 1 ? block_steps / 50 : block_steps / 2;
+    }
+    else {
+      for (int i = 1; i <= 40; i++) {
+        plan_buffer_line(base[X_AXIS] + i * 1.5, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 0.5 * MAX_STEP_FREQUENCY / steps_per_degree, 0);
+      }
+      block_steps = lround(1.5 * steps_per_degree);
+      steps = block_steps * 12;
+    }
+    long stop_steps;
+    double rate = stop_after(steps, stop_steps);
+
+    multistep_result res;
+    multistep_analyze(res);
+    double end_rate = 0;
+    if (isr_log_len >= 2) {
+      sim_isr_entry *last = &isr_log[isr_log_len - 1];
+      end_rate = isr_log[isr_log_len - 2].steps * (double)F_CPU / (last->clock - isr_log[isr_log_len - 2].clock);
+    }
+    // The steps it took beyond the ramp from rate down to the lowest rate. A stop in the block
+    // may run out the segment being stepped first, in a run of short blocks the block it is on,
+    // the one the ramp ends in and the ones already cut into segments.
+    long over = stop_steps - (long)ceil((rate * rate - 120.0 * 120.0) / (2 * acceleration));
+    double allowed = run < 3 ? (stop_steps - over) / 20.0 + 16 : 2 * block_steps;
+    #ifdef STEP_SEGMENT_BUFFER
+      allowed += rate * STEP_SEGMENT_TIME / 1000000 * (run < 3 ? 1 : STEP_SEGMENT_BUFFER_SIZE);
+    #endif
+    if (res.worst_jump > 0.02 || over > allowed || end_rate > sqrt(2 * acceleration * 32) || stop_steps == 0) {
+      printf("FAIL: run %d stopped from %.0f steps/s in %ld steps (%ld over), down to %.0f steps/s, step interval jumps %.2f%%\n",
+             run, rate, stop_steps, over, end_rate, res.worst_jump * 100);
+      failed++;
+    }
+    worst_jump = max(worst_jump, res.worst_jump);
+    worst_end = max(worst_end, end_rate);
+    if (run < 3) worst_over = max(worst_over, over);
+    else chain_over = over;
+
+    // The planner goes on from where the arm stopped
+    plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 0.5 * MAX_STEP_FREQUENCY / steps_per_degree, 0);
+    st_synchronize();
+    if (st_get_position(X_AXIS) != start[X_AXIS]) {
+      printf("FAIL: run %d went back to %ld steps, started at %ld\n", run, st_get_position(X_AXIS), start[X_AXIS]);
+      failed++;
+    }
+  }
+
+  // The LCD stops a run of blocks while plan_buffer_line() waits for room, the way it can in M600
+  // or G28. The block that waited goes from where the arm stopped, the discarded ones stay gone.
+  isr_log_len = 0;
+  lcd_stop_travel = axes[X_AXIS].travel + axes[Y_AXIS].travel + 2000;
+  idle_hook = lcd_stop_hook;
+  float waited = base[X_AXIS];
+  for (int i = 1; i <= 2 * BLOCK_BUFFER_SIZE && idle_hook != NULL; i++) {
+    waited = base[X_AXIS] + i * 1.5;
+    plan_buffer_line(waited, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 0.5 * MAX_STEP_FREQUENCY / steps_per_degree, 0);
+  }
+  st_synchronize();
+  long waited_error = labs(st_get_position(X_AXIS) - lround(waited * steps_per_degree));
+  if (idle_hook != NULL || waited_error != 0) {
+    idle_hook = NULL;
+    printf("FAIL: stopped at %ld steps in plan_buffer_line(), ended at %ld, the block that waited goes to %ld\n",
+           lcd_stopped_at[X_AXIS], st_get_position(X_AXIS), lround(waited * steps_per_degree));
+    failed++;
+  }
+  plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 0.5 * MAX_STEP_FREQUENCY / steps_per_degree, 0);
+  st_synchronize();
+
+  free(isr_log);
+  isr_log = NULL;
+  isr_log_size = 0;
+  // The planner took the arm back, the G-code goes on from there
+  for (int i = 0; i < NUM_AXIS; i++) current_position[i] = home[i];
+
+  // A G1 cut short. Over to where check_home left the arms and back to where it stopped, the
+  // arms have to get to the angles they stopped at again, then back to the start.
+  host_queue("G1 X160 Y60 F9000\n");
+  while (axes[X_AXIS].travel + axes[Y_AXIS].travel < 2000 || !blocks_queued()) loop();
+  stop_moves();
+  float stopped[NUM_AXIS];
+  long stopped_at[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    stopped[i] = current_position[i];
+    stopped_at[i] = st_get_position(i);
+  }
+  char buf[96];
+  sprintf(buf, "G1 X100 Y100 F6000\nG1 X%.4f Y%.4f\nM400\n", stopped[X_AXIS], stopped[Y_AXIS]);
+  host_queue(buf);
+  if (!sim_run_until_idle()) return 1;
+  long error = 0;
+  for (int i = X_AXIS; i <= Y_AXIS; i++) {
+    error = max(error, labs(st_get_position(i) - stopped_at[i]));
+  }
+  if (error > 1 || fabs(stopped[X_AXIS] - 100) < 1) {
+    printf("FAIL: stopped at X%.3f Y%.3f, back there %ld steps off the angles it stopped at\n",
+           stopped[X_AXIS], stopped[Y_AXIS], error);
+    failed++;
+  }
+  host_queue("G1 X100 Y100 F6000\nM400\n");
+  if (!sim_run_until_idle()) return 1;
+
+  // The LCD stops a G1 and a G2 from the wait for room in the buffer
+  const char *lcd_moves[2] = { "G1 X180 Y20 F9000\n", "G2 X100 Y140 I0 J20 F9000\n" };
+  float lcd_off = 0;
+  long lcd_error = 0;
+  for (int m = 0; m < 2; m++) {
+    lcd_stop_travel = axes[X_AXIS].travel + axes[Y_AXIS].travel + 2000;
+    idle_hook = lcd_stop_hook;
+    host_queue(lcd_moves[m]);
+    if (!sim_run_until_idle()) return 1;
+    if (idle_hook != NULL) {
+      idle_hook = NULL;
+      printf("FAIL: %.2s never waited for room in the buffer\n", lcd_moves[m]);
+      failed++;
+      continue;
+    }
+    long error = 0;
+    for (int i = X_AXIS; i <= Y_AXIS; i++) {
+      error = max(error, labs(st_get_position(i) - lcd_stopped_at[i]));
+    }
+    float off = max(fabs(current_position[X_AXIS] - lcd_stopped[X_AXIS]),
+                    fabs(current_position[Y_AXIS] - lcd_stopped[Y_AXIS]));
+    if (error || off > 0.001) {
+      printf("FAIL: %.2s stopped at X%.3f Y%.3f, went on %ld steps, current_position X%.3f Y%.3f\n",
+             lcd_moves[m], lcd_stopped[X_AXIS], lcd_stopped[Y_AXIS], error,
+             current_position[X_AXIS], current_position[Y_AXIS]);
+      failed++;
+    }
+    lcd_error = max(lcd_error, error);
+    lcd_off = max(lcd_off, off);
+    // Z too, calc_bed_delta() goes by whole mm and the arms stopped in between
+    sprintf(buf, "G1 X100 Y100 Z%.4f F6000\nM400\n", home[Z_AXIS]);
+    host_queue(buf);
+    if (!sim_run_until_idle()) return 1;
+  }
+
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted || (i <= Z_AXIS && st_get_position(i) != start[i])) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld, ended at %ld steps, started at %ld\n",
+             "XYZE"[i], pins, counted, st_get_position(i), start[i]);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings || stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu errors, %lu warnings, %lu unexpected endstop hits\n",
+           stats.errors, stats.warnings, stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+  printf("stop: 4 stops of the X arm, one in a G1 and three from the LCD\n");
+  printf("  step interval     jumps by at most %.2f%% between interrupts, beyond the ramps\n", worst_jump * 100);
+  printf("  stop              at most %ld steps beyond the ramp in the block, %ld over short blocks\n",
+         worst_over, chain_over);
+  printf("  end               down to %.0f steps/s\n", worst_end);
+  printf("  G1                stopped at X%.3f Y%.3f, back there %ld steps off\n",
+         stopped[X_AXIS], stopped[Y_AXIS], error);
+  printf("  LCD stop          G1 and G2 went on %ld steps, current_position %.4f mm off\n",
+         lcd_error, lcd_off);
+  printf("  LCD stop          in plan_buffer_line(), %ld steps off the block that waited\n", waited_error);
+  printf(failed ? "stop: %d FAILED\n" : "stop: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+#ifdef SPEED_OVERRIDE_REPLAN
+// Step rate of the X arm over n stepping interrupts from the i-th recorded on
+static double override_rate(unsigned long i, unsigned long n)
+{
+  n = min(n, isr_log_len - 1 - i);
+  unsigned long steps = 0;
+  for (unsigned long j = i; j < i + n; j++) steps += isr_log[j].steps;
+  return steps * (double)F_CPU / (isr_log[i + n].clock - isr_log[i].clock);
+}
+
+// Changes the speed override (M220) ten blocks into a run of short blocks of the X arm, up to 150%
+// and down to 50%. The arm has to run at the new rate (within 2%) after the block it is on, the
+// one after it and the steps the acceleration takes to get there (plus the segments cut ahead with
+// STEP_SEGMENT_BUFFER), without the step interval jumping by more than 2%. A G1 of the G-code with
+// M220 S200 after it has to take less time from the blocks it had in the buffer, at least half of
+// what the override saves on them. Throughout, the pins have to take the steps the firmware counted.
+static int cmd_override(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  float base[NUM_AXIS], home[NUM_AXIS];
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    home[i] = current_position[i];
+    base[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  unsigned long endstop_hits = stats.endstop_hits;
+
+  isr_log_size = 1 << 20;
+  isr_log = (sim_isr_entry *)malloc(isr_log_size * sizeof(sim_isr_entry));
+  const float steps_per_degree = axis_steps_per_unit[X_AXIS];
+  const double acceleration = axis_steps_per_sqr_second[X_AXIS];
+  const double rate = 0.4 * MAX_STEP_FREQUENCY;
+  const long block_steps = lround(1.5 * steps_per_degree);
+  const int multiplies[2] = { 150, 50 };
+  long reached[2], allowed[2];
+  double worst_jump = 0;
+  for (int run = 0; run < 2; run++) {
+    isr_log_len = 0;
+    for (int i = 1; i <= 60; i++) {
+      plan_buffer_line(base[X_AXIS] + i * 1.5, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], rate / steps_per_degree, 0);
+    }
+    unsigned long travel = axes[X_AXIS].travel + 10 * block_steps;
+    while (axes[X_AXIS].travel < travel) {
+      manage_inactivity();
+      sim_advance(F_CPU / 20000);
+    }
+    unsigned long changed_at = isr_log_len;
+    feedmultiply = multiplies[run];
+    plan_apply_feed_multiply();
+    st_synchronize();
+    feedmultiply = 100;
+
+    multistep_result res;
+    multistep_analyze(res);
+    double target = rate * multiplies[run] / 100;
+    double before = override_rate(changed_at - 16, 16);
+    long steps = 0;
+    reached[run] = -1;
+    for (unsigned long i = changed_at; i + 8 < isr_log_len; i++) {
+      if (fabs(override_rate(i, 8) - target) < 0.02 * target) {
+        reached[run] = steps;
+        break;
+      }
+      steps += isr_log[i].steps;
+    }
+    allowed[run] = 2 * block_steps + (long)ceil(fabs(target * target - rate * rate) / (2 * acceleration));
+    #ifdef STEP_SEGMENT_BUFFER
+      allowed[run] += lround(rate * STEP_SEGMENT_TIME / 1000000 * STEP_SEGMENT_BUFFER_SIZE);
+    #endif
+    if (res.worst_jump > 0.02 || fabs(before - rate) > 0.02 * rate || reached[run] < 0 || reached[run] > allowed[run]) {
+      printf("FAIL: run %d at %d%% from %.0f steps/s got to %.0f steps/s after %ld steps of %ld, step interval jumps %.2f%%\n",
+             run, multiplies[run], before, target, reached[run], allowed[run], res.worst_jump * 100);
+      failed++;
+    }
+    worst_jump = max(worst_jump, res.worst_jump);
+
+    plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], rate / steps_per_degree, 0);
+    st_synchronize();
+    if (st_get_position(X_AXIS) != start[X_AXIS]) {
+      printf("FAIL: run %d went back to %ld steps, started at %ld\n", run, st_get_position(X_AXIS), start[X_AXIS]);
+      failed++;
+    }
+  }
+  free(isr_log);
+  isr_log = NULL;
+  isr_log_size = 0;
+  for (int i = 0; i < NUM_AXIS; i++) current_position[i] = home[i];
+
+  // The G1 as it is and with the override raised once it is in the buffer. The blocks it has in
+  // the buffer then are the ones it takes more than BLOCK_BUFFER_SIZE back from its end.
+  double seconds[2];
+  for (int run = 0; run < 2; run++) {
+    uint64_t clock = sim_clock;
+    host_queue(run ? "G1 X160 Y60 F1200\nM220 S200\nM400\nM220 S100\n" : "G1 X160 Y60 F1200\nM400\n");
+    if (!sim_run_until_idle()) return 1;
+    seconds[run] = (double)(sim_clock - clock) / F_CPU;
+    host_queue("G1 X100 Y100 F6000\nM400\n");
+    if (!sim_run_until_idle()) return 1;
+  }
+  double buffered = min(seconds[0], (double)(BLOCK_BUFFER_SIZE - 1) / DELTA_SEGMENTS_PER_SECOND);
+  if (seconds[0] - seconds[1] < buffered / 4) {
+    printf("FAIL: G1 took %.3f s, %.3f s with M220 S200 after it, %.3f s of it in the buffer\n",
+           seconds[0], seconds[1], buffered);
+    failed++;
+  }
+
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted || (i <= Z_AXIS && st_get_position(i) != start[i])) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld, ended at %ld steps, started at %ld\n",
+             "XYZE"[i], pins, counted, st_get_position(i), start[i]);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings || stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu errors, %lu warnings, %lu unexpected endstop hits\n",
+           stats.errors, stats.warnings, stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+  printf("override: speed override of the X arm in a run of blocks and of a G1 in the buffer\n");
+  for (int run = 0; run < 2; run++) {
+    printf("  %3d%%              new rate after %ld steps, %ld allowed\n", multiplies[run], reached[run], allowed[run]);
+  }
+  printf("  step interval     jumps by at most %.2f%% between interrupts, beyond the ramps\n", worst_jump * 100);
+  printf("  G1                %.3f s, %.3f s with M220 S200 after it\n", seconds[0], seconds[1]);
+  printf(failed ? "override: %d FAILED\n" : "override: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+#endif // SPEED_OVERRIDE_REPLAN
+
+#ifdef LIN_ADVANCE
+struct advance_result {
+  double lead_min, lead_max;           // E steps ahead of the arm, over the extruding move
+  double expected;                     // K times the E rate of the block at its nominal rate
+};
+
+// Extrudes along a move of the X arm out from base and back without extruding, watching the
+// pins every 0.5ms. The lead is the E steps taken beyond what the X steps taken so far call for.
+static void advance_move(float base[NUM_AXIS], advance_result &res)
+{
+  const float degrees = 60, extrude = 5;
+  long x0 = axes[X_AXIS].pulses, e0 = axes[E_AXIS].pulses;
+  plan_buffer_line(base[X_AXIS] + degrees, base[Y_AXIS], base[Z_AXIS], base[E_AXIS] + extrude, 55, 0);
+  block_t *block = &block_buffer[(block_buffer_head - 1) & (BLOCK_BUFFER_SIZE - 1)];
+  double e_per_x = (double)block->steps_e / block->steps_x;
+  res.expected = extruder_advance_k * block->nominal_rate * block->steps_e / block->step_event_count;
+  res.lead_min = res.lead_max = 0;
+  while (blocks_queued() || current_block != NULL) {
+    manage_inactivity();
+    sim_advance(F_CPU / 2000);
+    double lead = (axes[E_AXIS].pulses - e0) - (axes[X_AXIS].pulses - x0) * e_per_x;
+    res.lead_min = min(res.lead_min, lead);
+    res.lead_max = max(res.lead_max, lead);
+  }
+  base[E_AXIS] += extrude;
+  plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 55, 0);
+  st_synchronize();
+}
+
+// Runs the move without advance and with it. Without it the extruder must keep within a step of
+// the arm. With it the lead has to reach K times the nominal E rate (5% and 2 steps for the ramps
+// and the rounding) and never turn into a lag. Either way, after the travel back the extruder has
+// to stand where the planner put it, with every E step on the pins counted.
+static int cmd_advance(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  host_queue("M900 K0.05\nM500\nM900 K0\nM501\n");
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  if (fabs(extruder_advance_k - 0.05) > 1e-6) {
+    printf("FAIL: M501 read back K%.4f, M500 stored K0.05\n", extruder_advance_k);
+    failed++;
+  }
+  float base[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) base[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+  long start_pulses = axes[E_AXIS].pulses, start = st_get_position(E_AXIS);
+
+  advance_result off, on;
+  extruder_advance_k = 0;
+  advance_move(base, off);
+  if (off.lead_max > 1 || off.lead_min < -1) {
+    printf("FAIL: without advance the extruder was %.1f to %.1f steps off the arm\n", off.lead_min, off.lead_max);
+    failed++;
+  }
+  extruder_advance_k = 0.05;
+  advance_move(base, on);
+  if (fabs(on.lead_max - on.expected) > on.expected * 0.05 + 2 || on.lead_min < -1) {
+    printf("FAIL: K%.2f lead %.1f to %.1f steps, expected up to %.1f\n", extruder_advance_k,
+           on.lead_min, on.lead_max, on.expected);
+    failed++;
+  }
+
+  long planned = lround(base[E_AXIS] * axis_steps_per_unit[E_AXIS]);
+  long pins = axes[E_AXIS].pulses - start_pulses, counted = st_get_position(E_AXIS) - start;
+  if (pins != counted || st_get_position(E_AXIS) != planned) {
+    printf("FAIL: E pins stepped %ld, firmware counted %ld, ended at %ld steps, planned %ld\n",
+           pins, counted, st_get_position(E_AXIS), planned);
+    failed++;
+  }
+  if (stats.errors || stats.warnings) {
+    printf("FAIL: %lu errors, %lu warnings\n", stats.errors, stats.warnings);
+    failed++;
+  }
+  printf("advance: K%.2f\n", extruder_advance_k);
+  printf("  without advance   extruder %.1f to %.1f steps ahead of the arm\n", off.lead_min, off.lead_max);
+  printf("  with advance      extruder %.1f to %.1f steps ahead, %.1f expected at the nominal rate\n",
+         on.lead_min, on.lead_max, on.expected);
+  printf(failed ? "advance: %d FAILED\n" : "advance: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+#endif // LIN_ADVANCE
+
+#ifdef BABYSTEPPING
+// Lets the stepper interrupt run with nothing queued for ms milliseconds
+static void babystep_idle(unsigned long ms)
+{
+  for (unsigned long i = 0; i < ms; i++) {
+    manage_inactivity();
+    sim_advance(F_CPU / 1000);
+  }
+}
+
+// Baby-steps Z with M290 standing still and in the middle of a run of G1 moves. The Z pins have to
+// take the baby-steps on top of what the firmware counted, and the moves have to take the same
+// steps in the same time as without them. M290 H then has to move the offset into add_homeing, so
+// the tool comes back to the same height after another G28.
+static int cmd_babystep(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  unsigned long endstop_hits = stats.endstop_hits;
+  const float steps_per_mm = axis_steps_per_unit[Z_AXIS];
+
+  // Standing still the interrupt runs at 1kHz, one baby-step each time
+  host_queue("M290 Z0.02\n");
+  if (!sim_run_until_idle()) return 1;
+  babystep_idle(500);
+  long expected = lround(0.02 * steps_per_mm);
+  long idle_steps = axes[Z_AXIS].pulses - start_pulses[Z_AXIS];
+  if (idle_steps != expected || st_get_position(Z_AXIS) != start[Z_AXIS]) {
+    printf("FAIL: standing still Z took %ld baby-steps of %ld, the counter moved %ld\n",
+           idle_steps, expected, st_get_position(Z_AXIS) - start[Z_AXIS]);
+    failed++;
+  }
+
+  // A circle with a Z move in it, as it is and with baby-steps up and down while it runs
+  char buf[96];
+  double seconds[2];
+  unsigned long travel[2][NUM_AXIS];
+  long moving_steps = 0;
+  for (int run = 0; run < 2; run++) {
+    unsigned long travel_before[NUM_AXIS];
+    for (int i = 0; i < NUM_AXIS; i++) travel_before[i] = axes[i].travel;
+    long pulses_before = axes[Z_AXIS].pulses, counted_before = st_get_position(Z_AXIS);
+    uint64_t clock = sim_clock;
+    host_queue("G1 X140 Y90 Z6 F4800\n");
+    for (int i = 0; i <= 72; i++) {
+      float a = 2 * M_PI * i / 72;
+      sprintf(buf, "G1 X%.3f Y%.3f F4800\n", 100 + 40 * cos(a), 90 + 40 * sin(a));
+      host_queue(buf);
+      if (run && i == 10) host_queue("M290 Z0.1\n");
+      if (run && i == 40) host_queue("M290 Z-0.03\n");
+    }
+    host_queue("G1 X100 Y100 Z5 F4800\nM400\n");
+    if (!sim_run_until_idle()) return 1;
+    seconds[run] = (double)(sim_clock - clock) / F_CPU;
+    for (int i = 0; i < NUM_AXIS; i++) travel[run][i] = axes[i].travel - travel_before[i];
+    // The Z moves are counted, the baby-steps are not
+    moving_steps = (axes[Z_AXIS].pulses - pulses_before) - (st_get_position(Z_AXIS) - counted_before);
+  }
+  expected = lround(0.1 * steps_per_mm) + lround(-0.03 * steps_per_mm);
+  if (moving_steps != expected) {
+    printf("FAIL: while moving Z took %ld baby-steps of %ld by the end of the moves\n", moving_steps, expected);
+    failed++;
+  }
+  for (int i = X_AXIS; i <= Y_AXIS; i++) {
+    if (travel[1][i] != travel[0][i]) {
+      printf("FAIL: axis %c stepped %lu times with baby-steps, %lu without\n", "XYZE"[i], travel[1][i], travel[0][i]);
+      failed++;
+    }
+  }
+  unsigned long z_babysteps = lround(0.1 * steps_per_mm) + lround(0.03 * steps_per_mm);
+  if (travel[1][Z_AXIS] != travel[0][Z_AXIS] + z_babysteps) {
+    printf("FAIL: Z stepped %lu times with baby-steps, %lu without and %lu baby-steps\n",
+           travel[1][Z_AXIS], travel[0][Z_AXIS], z_babysteps);
+    failed++;
+  }
+  if (fabs(seconds[1] - seconds[0]) > 0.01 * seconds[0]) {
+    printf("FAIL: the moves took %.3f s with baby-steps, %.3f s without\n", seconds[1], seconds[0]);
+    failed++;
+  }
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (i != Z_AXIS && pins != counted) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld\n", "XYZE"[i], pins, counted);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings || stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu errors, %lu warnings, %lu unexpected endstop hits\n",
+           stats.errors, stats.warnings, stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+
+  // Fold the offset into the home offset, home again and go back to the same point
+  float offset = babystep_z_offset(), home_offset = add_homeing[Z_AXIS];
+  long height = axes[Z_AXIS].pulses;
+  host_queue("M290 H\nG28\nG1 X100 Y100 Z5 F6000\nM400\n");
+  if (!sim_run_until_idle()) return 1;
+  long height_error = axes[Z_AXIS].pulses - height;
+  if (fabs(add_homeing[Z_AXIS] - (home_offset - offset)) > 1e-4 || babystep_z_offset() != 0 || labs(height_error) > 1) {
+    printf("FAIL: M290 H made the home offset %.4f from %.4f and %.4f baby-stepped, Z came back %ld steps off\n",
+           add_homeing[Z_AXIS], home_offset, offset, height_error);
+    failed++;
+  }
+  if (stats.errors || stats.warnings) {
+    printf("FAIL: %lu errors, %lu warnings\n", stats.errors, stats.warnings);
+    failed++;
+  }
+
+  printf("babystep: Z baby-steps standing still and between the step events of moves, M290 H\n");
+  printf("  standing still    %ld baby-steps\n", idle_steps);
+  printf("  moving            %ld baby-steps, moves took %.3f s, %.3f s without\n", moving_steps, seconds[1], seconds[0]);
+  printf("  M290 H            home offset Z %.4f, back at the same height %ld steps off\n", add_homeing[Z_AXIS], height_error);
+  printf(failed ? "babystep: %d FAILED\n" : "babystep: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+#endif // BABYSTEPPING
+
+// Inverse and forward kinematics of the Morgan arms in double precision, the reference for ik
+static void ik_reference(double x, double y, double angles[2])
+{
+  const double lt = LengthTheta, lp = LengthPsi, lte = LengthThetaExt, lpe = LengthPsiExt;
+  double p2 = x * x + y * y, p = sqrt(p2), rho = atan2(y, x);
+  angles[X_AXIS] = (rho - acos((lt * lt + p2 - lte * lte) / (2 * lt * p))) * 180 / M_PI;
+  angles[Y_AXIS] = (rho + acos((lp * lp + p2 - lpe * lpe) / (2 * lp * p))) * 180 / M_PI;
+}
+
+static void fk_reference(const double angles[2], double &x, double &y)
+{
+  const double lt = LengthTheta, lp = LengthPsi, lte = LengthThetaExt, lpe = LengthPsiExt;
+  double theta = angles[X_AXIS] * M_PI / 180, psi = angles[Y_AXIS] * M_PI / 180;
+  double s2 = lt * lt + lp * lp - 2 * lt * lp * cos(psi - theta), s = sqrt(s2);
+  double elbow = acos((s2 + lte * lte - lpe * lpe) / (2 * s * lte)) + acos((s2 + lt * lt - lp * lp) / (2 * s * lt));
+  double p2 = lt * lt + lte * lte - 2 * lt * lte * cos(elbow), p = sqrt(p2);
+  double rho = theta + acos((lt * lt + p2 - lte * lte) / (2 * lt * p));
+  x = p * cos(rho);
+  y = p * sin(rho);
+}
+
+// The libm kernel of calculate_delta() in float throughout, as the AVR runs it
+static void ik_libm_float(const float pos[2], float angles[2])
+{
+  const float lt = LengthTheta, lp = LengthPsi, lte = LengthThetaExt, lpe = LengthPsiExt;
+  float p2 = pos[X_AXIS] * pos[X_AXIS] + pos[Y_AXIS] * pos[Y_AXIS], p = sqrtf(p2);
+  float rho = atan2f(pos[Y_AXIS], pos[X_AXIS]);
+  float D = acosf((lte * lte - lt * lt - p2) / (-2 * lt * p));
+  float C1 = acosf((lpe * lpe - lp * lp - p2) / (-2 * lp * p));
+  angles[X_AXIS] = (rho - D) * (float)SCARA_RAD2DEG;
+  angles[Y_AXIS] = (rho + C1) * (float)SCARA_RAD2DEG;
+}
+
+struct ik_error {
+  double theta, psi, tip;              // largest errors, degrees and um
+  float tip_x, tip_y;                  // where the nozzle is off the most
+};
+
+static void ik_measure(void (*kernel)(const float pos[2], float angles[2]), const float *points, long n, ik_error &err)
+{
+  memset(&err, 0, sizeof(err));
+  for (long i = 0; i < n; i++) {
+    const float *pos = points + 2 * i;
+    float angles[2];
+    double ref[2], got[2], x, y;
+    kernel(pos, angles);
+    ik_reference(pos[X_AXIS], pos[Y_AXIS], ref);
+    got[X_AXIS] = angles[X_AXIS];
+    got[Y_AXIS] = angles[Y_AXIS];
+    fk_reference(got, x, y);
+    double tip = hypot(x - pos[X_AXIS], y - pos[Y_AXIS]) * 1000;
+    err.theta = max(err.theta, fabs(got[X_AXIS] - ref[X_AXIS]));
+    err.psi = max(err.psi, fabs(got[Y_AXIS] - ref[Y_AXIS]));
+    if (!(tip <= err.tip)) {
+      err.tip = tip;
+      err.tip_x = pos[X_AXIS] + SCARA_offset_x;
+      err.tip_y = pos[Y_AXIS] + SCARA_offset_y;
+    }
+  }
+}
+
+// Host time and time stamp counter ticks per call of the kernel over the points
+static void ik_time(void (*kernel)(const float pos[2], float angles[2]), const float *points, long n, double &ns, double &ticks)
+{
+  const int rounds = 20;
+  volatile float sink = 0;
+  uint64_t t0 = sim_host_ns(), c0 = sim_host_ticks();
+  for (int r = 0; r < rounds; r++) {
+    for (long i = 0; i < n; i++) {
+      float angles[2];
+      kernel(points + 2 * i, angles);
+      sink = sink + angles[X_AXIS] + angles[Y_AXIS];
+    }
+  }
+  ns = (double)(sim_host_ns() - t0) / rounds / n;
+  ticks = (double)(sim_host_ticks() - c0) / rounds / n;
+}
+
+// Sweeps the bed in 0.5mm steps and compares the arm angles calculate_scara_angles() gives with a
+// double precision reference: the largest theta and psi errors and how far the nozzle ends up from
+// the point, through the forward kinematics of the angles. The nozzle has to be within 1um and the
+// angles within a tenth of a step. Times the kernel against the libm one in float.
+static int cmd_ik(int argc, char **argv)
+{
+  int failed = 0;
+  const float steps_per_unit[] = DEFAULT_AXIS_STEPS_PER_UNIT;
+  long n = 0, size = (long)((X_MAX_POS - X_MIN_POS) * 2 + 1) * (long)((Y_MAX_POS - Y_MIN_POS) * 2 + 1);
+  float *points = (float *)malloc(size * 2 * sizeof(float));
+  for (long i = 0; i <= (X_MAX_POS - X_MIN_POS) * 2; i++) {
+    for (long j = 0; j <= (Y_MAX_POS - Y_MIN_POS) * 2; j++) {
+      points[2 * n + X_AXIS] = X_MIN_POS + i * 0.5 - SCARA_offset_x;
+      points[2 * n + Y_AXIS] = Y_MIN_POS + j * 0.5 - SCARA_offset_y;
+      n++;
+    }
+  }
+
+  // The reference has to come back to the points through its forward kinematics
+  double roundtrip = 0;
+  for (long i = 0; i < n; i++) {
+    double ref[2], x, y;
+    ik_reference(points[2 * i + X_AXIS], points[2 * i + Y_AXIS], ref);
+    fk_reference(ref, x, y);
+    roundtrip = max(roundtrip, hypot(x - points[2 * i + X_AXIS], y - points[2 * i + Y_AXIS]) * 1000);
+  }
+  if (!(roundtrip < 1e-3)) {
+    printf("FAIL: the double precision kinematics are %.6f um off going there and back\n", roundtrip);
+    failed++;
+  }
+
+  #ifdef SCARA_IK_TABLE
+    int exact_cells = scara_ik_table_build();
+  #endif
+  ik_error err, libm;
+  ik_measure(calculate_scara_angles, points, n, err);
+  ik_measure(ik_libm_float, points, n, libm);
+  double step = 0.1 / min(steps_per_unit[X_AXIS], steps_per_unit[Y_AXIS]);
+  if (!(err.tip < 1) || !(err.theta < step) || !(err.psi < step)) {
+    printf("FAIL: the nozzle is up to %.3f um off at X%.1f Y%.1f, theta %.6f and psi %.6f degrees, %.6f allowed\n",
+           err.tip, err.tip_x, err.tip_y, err.theta, err.psi, step);
+    failed++;
+  }
+
+  double ns, ticks, libm_ns, libm_ticks;
+  ik_time(calculate_scara_angles, points, n, ns, ticks);
+  ik_time(ik_libm_float, points, n, libm_ns, libm_ticks);
+
+  #ifdef SCARA_FAST_IK
+    printf("ik: polynomial kernel (SCARA_FAST_IK) against double precision over %ld points of the bed\n", n);
+  #elif defined(SCARA_IK_TABLE)
+    printf("ik: table kernel (SCARA_IK_TABLE) against double precision over %ld points of the bed\n", n);
+    printf("  tables            %d entries, %d of the %d cells with acos()\n",
+           SCARA_IK_TABLE, exact_cells, SCARA_IK_TABLE - 1);
+  #else
+    printf("ik: libm kernel against double precision over %ld points of the bed\n", n);
+  #endif
+  printf("  kernel            theta %.2e, psi %.2e degrees, nozzle %.3f um at X%.1f Y%.1f\n",
+         err.theta, err.psi, err.tip, err.tip_x, err.tip_y);
+  printf("  libm in float     theta %.2e, psi %.2e degrees, nozzle %.3f um at X%.1f Y%.1f\n",
+         libm.theta, libm.psi, libm.tip, libm.tip_x, libm.tip_y);
+  printf("  time per call     kernel %.1f ns, %.0f ticks; libm in float %.1f ns, %.0f ticks (host)\n",
+         ns, ticks, libm_ns, libm_ticks);
+  printf(failed ? "ik: %d FAILED\n" : "ik: all passed\n", failed);
+  free(points);
+  return failed ? 1 : 0;
+}
+
+// Cuts a set of G1 moves over the bed into segments and checks how far the nozzle strays from the
+// lines in between the block ends, where the joints move linearly: at a quarter, half and three
+// quarters of each block, through the double precision forward kinematics. With
+// SEGMENT_MAX_DEVIATION that has to stay within it, the blocks have to be between
+// SEGMENT_MIN_LENGTH and SEGMENT_MAX_LENGTH long and there have to be fewer of them than
+// DELTA_SEGMENTS_PER_SECOND makes. Either way the pins have to take the steps the firmware counted.
+static int cmd_chord(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  unsigned long endstop_hits = stats.endstop_hits;
+
+  struct { float x, y, f; } moves[] = {
+    { 100, 0, 1200 }, { -10, 175, 9000 }, { 200, 175, 9000 }, { 200, -2, 3000 }, { 100, 100, 6000 }
+  };
+  const int n_moves = sizeof(moves) / sizeof(moves[0]);
+  joint_log_size = 1 << 16;
+  joint_log = (float *)malloc(joint_log_size * 3 * sizeof(float));
+  double from_x = 100, from_y = 100, joints[2];
+  ik_reference(from_x - SCARA_offset_x, from_y - SCARA_offset_y, joints);
+  unsigned long blocks = 0, timed_blocks = 0;
+  double worst = 0;
+  float shortest = 1e9, longest = 0;
+  printf("chord: nozzle off the line between the block ends\n");
+  for (int m = 0; m < n_moves; m++) {
+    char buf[64];
+    sprintf(buf, "G1 X%.1f Y%.1f F%.0f\nM400\n", moves[m].x, moves[m].y, moves[m].f);
+    joint_log_len = 0;
+    uint64_t clock = sim_clock;
+    host_queue(buf);
+    if (!sim_run_until_idle()) return 1;
+    double to_x = moves[m].x, to_y = moves[m].y, mm = hypot(to_x - from_x, to_y - from_y);
+    double move_worst = 0;
+    for (unsigned long b = 0; b < joint_log_len; b++) {
+      const float *block = joint_log + 3 * b;
+      for (int q = 1; q <= 3; q++) {
+        double between[2], x, y;
+        for (int i = X_AXIS; i <= Y_AXIS; i++)
+          between[i] = joints[i] + (block[i] - joints[i]) * q / 4 + add_homeing[i];
+        fk_reference(between, x, y);
+        x += SCARA_offset_x;
+        y += SCARA_offset_y;
+        double off = fabs((x - from_x) * (to_y - from_y) - (y - from_y) * (to_x - from_x)) / mm;
+        move_worst = max(move_worst, off);
+      }
+      joints[X_AXIS] = block[X_AXIS];
+      joints[Y_AXIS] = block[Y_AXIS];
+      if (b + 1 < joint_log_len || joint_log_len == 1) {
+        shortest = min(shortest, block[2]);
+      }
+      longest = max(longest, block[2]);
+    }
+    unsigned long timed = max(1, int(DELTA_SEGMENTS_PER_SECOND * mm * 60 / moves[m].f));
+    printf("  G1 X%-5.0f Y%-5.0f F%-5.0f %3lu blocks (%lu by time), %.2f um off, %.3f s\n",
+           moves[m].x, moves[m].y, moves[m].f, joint_log_len, timed, move_worst * 1000, (double)(sim_clock - clock) / F_CPU);
+    blocks += joint_log_len;
+    timed_blocks += timed;
+    worst = max(worst, move_worst);
+    from_x = to_x;
+    from_y = to_y;
+  }
+  free(joint_log);
+  joint_log = NULL;
+  joint_log_size = 0;
+
+  #ifdef SEGMENT_MAX_DEVIATION
+    if (worst > SEGMENT_MAX_DEVIATION * 1.05 + 0.0005) {
+      printf("FAIL: the nozzle is up to %.2f um off the line, %.2f um allowed\n", worst * 1000, SEGMENT_MAX_DEVIATION * 1000.0);
+      failed++;
+    }
+    if (shortest < SEGMENT_MIN_LENGTH * 0.999 || longest > SEGMENT_MAX_LENGTH * 1.001) {
+      printf("FAIL: blocks from %.3f to %.3f mm long, %.3f to %.3f mm allowed\n",
+             shortest, longest, (double)SEGMENT_MIN_LENGTH, (double)SEGMENT_MAX_LENGTH);
+      failed++;
+    }
+    if (blocks >= timed_blocks) {
+      printf("FAIL: %lu blocks, %lu by time\n", blocks, timed_blocks);
+      failed++;
+    }
+  #endif
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted || (i <= Z_AXIS && counted != 0)) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld, ended at %ld steps, started at %ld\n",
+             "XYZE"[i], pins, counted, st_get_position(i), start[i]);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings || stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu errors, %lu warnings, %lu unexpected endstop hits\n",
+           stats.errors, stats.warnings, stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+  printf("  all moves         %lu blocks (%lu by time), %.2f um off, blocks %.3f to %.3f mm\n",
+         blocks, timed_blocks, worst * 1000, shortest, longest);
+  printf(failed ? "chord: %d FAILED\n" : "chord: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+// Runs G2/G3 arcs, full circles and a helix, and checks the blocks they make end on the circle
+// through the double precision forward kinematics of their joint angles: no further in than the
+// middle of a chord (ARC_MAX_DEVIATION, or the chords of MM_PER_ARC_SEGMENT) and no further out
+// than 1um, the last one at the end of the arc. The pins have to take the steps the firmware counted.
+static int cmd_arc(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  unsigned long endstop_hits = stats.endstop_hits;
+
+  struct { const char *gcode; float x, y, i, j; } arcs[] = {
+    { "G2", 100, 100, 10, 0 },         // full circle of 10mm around X110 Y100
+    { "G3", 160, 100, 30, 0 },         // half circle of 30mm
+    { "G2", 160, 100, -2, 0 },         // full circle of 2mm
+    { "G2", 60, 100, -50, 40 },        // helix of 64mm up Z
+  };
+  const int n_arcs = sizeof(arcs) / sizeof(arcs[0]);
+  joint_log_size = 1 << 16;
+  joint_log = (float *)malloc(joint_log_size * 3 * sizeof(float));
+  unsigned long blocks = 0;
+  double worst_in = 0, worst_out = 0, worst_end = 0, allowed_in = 0;
+  host_queue("G1 X100 Y100 Z5 F6000\nM400\n");
+  if (!sim_run_until_idle()) return 1;
+  printf("arc: block ends off the circle, through the forward kinematics\n");
+  for (int a = 0; a < n_arcs; a++) {
+    float from_x = current_position[X_AXIS], from_y = current_position[Y_AXIS];
+    double center_x = from_x + arcs[a].i, center_y = from_y + arcs[a].j, r = hypot(arcs[a].i, arcs[a].j);
+    #ifdef ARC_MAX_DEVIATION
+      double chord = constrain(2 * sqrt(2 * r * ARC_MAX_DEVIATION), MIN_MM_PER_ARC_SEGMENT, MM_PER_ARC_SEGMENT);
+    #else
+      double chord = 2.0 * MM_PER_ARC_SEGMENT;   // the last one can be up to twice as long
+    #endif
+    double in_allowed = r - sqrt(max(r * r - chord * chord / 4, 0.0)) + 1e-3;
+    char buf[96];
+    sprintf(buf, "%s X%.1f Y%.1f Z%.1f E%.1f I%.1f J%.1f F3000\nM400\n", arcs[a].gcode, arcs[a].x, arcs[a].y,
+            a == n_arcs - 1 ? 7.0 : 5.0, current_position[E_AXIS] + 2, arcs[a].i, arcs[a].j);
+    joint_log_len = 0;
+    host_queue(buf);
+    if (!sim_run_until_idle()) return 1;
+    double in = 0, out = 0, end = 0;
+    for (unsigned long b = 0; b < joint_log_len; b++) {
+      const float *block = joint_log + 3 * b;
+      double joints[2], x, y;
+      for (int i = X_AXIS; i <= Y_AXIS; i++)
+        joints[i] = block[i] + add_homeing[i];
+      fk_reference(joints, x, y);
+      x += SCARA_offset_x;
+      y += SCARA_offset_y;
+      double d = hypot(x - center_x, y - center_y);
+      in = max(in, r - d);
+      out = max(out, d - r);
+      if (b + 1 == joint_log_len) end = hypot(x - arcs[a].x, y - arcs[a].y);
+    }
+    printf("  %s I%-5.0f J%-5.0f %4lu blocks, %6.2f um in, %5.2f um out, %5.2f um off the end (%.2f um in allowed)\n",
+           arcs[a].gcode, arcs[a].i, arcs[a].j, joint_log_len, in * 1000, out * 1000, end * 1000, in_allowed * 1000);
+    if (joint_log_len == 0 || in > in_allowed || out > 1e-3 || end > 1e-3) {
+      printf("FAIL: %s to X%.1f Y%.1f I%.1f J%.1f strays from the circle or misses the end\n",
+             arcs[a].gcode, arcs[a].x, arcs[a].y, arcs[a].i, arcs[a].j);
+      failed++;
+    }
+    blocks += joint_log_len;
+    worst_in = max(worst_in, in);
+    worst_out = max(worst_out, out);
+    worst_end = max(worst_end, end);
+    allowed_in = max(allowed_in, in_allowed);
+  }
+  free(joint_log);
+  joint_log = NULL;
+  joint_log_size = 0;
+
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld\n", "XYZE"[i], pins, counted);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings || stats.endstop_hits != endstop_hits) {
+    printf("FAIL: %lu errors, %lu warnings, %lu unexpected endstop hits\n",
+           stats.errors, stats.warnings, stats.endstop_hits - endstop_hits);
+    failed++;
+  }
+  printf("  all arcs          %lu blocks, %.2f um in, %.2f um out, %.2f um off the ends\n",
+         blocks, worst_in * 1000, worst_out * 1000, worst_end * 1000);
+  printf(failed ? "arc: %d FAILED\n" : "arc: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+#ifdef KINEMATICS_STAGING
+// Runs G1 moves that take many segments and checks the planner gets the joint angles of all of
+// them in order, as prepare_move() cut the moves, and the pins take the steps the firmware counted.
+// With MOTION_STATS some of the segments have to have been worked out while the buffer was full.
+static int cmd_staging(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+  }
+  #ifdef MOTION_STATS
+    motion_stats_reset();
+  #endif
+
+  struct { float x, y, f; } moves[] = {
+    { 150, 50, 600 }, { 20, 160, 3000 }, { 180, 120, 9000 }, { 100, 100, 1200 }
+  };
+  const int n_moves = sizeof(moves) / sizeof(moves[0]);
+  joint_log_size = 1 << 16;
+  joint_log = (float *)malloc(joint_log_size * 3 * sizeof(float));
+  unsigned long blocks = 0;
+  double worst = 0;
+  for (int m = 0; m < n_moves; m++) {
+    char buf[64];
+    sprintf(buf, "G1 X%.1f Y%.1f F%.0f\nM400\n", moves[m].x, moves[m].y, moves[m].f);
+    float from[2] = { current_position[X_AXIS], current_position[Y_AXIS] };
+    joint_log_len = 0;
+    host_queue(buf);
+    if (!sim_run_until_idle()) return 1;
+    blocks += joint_log_len;
+    #ifndef SEGMENT_MAX_DEVIATION
+      // The segments prepare_move() cuts the move into by time
+      float difference[2] = { moves[m].x - from[X_AXIS], moves[m].y - from[Y_AXIS] };
+      float mm = sqrt(sq(difference[X_AXIS]) + sq(difference[Y_AXIS]));
+      int segments = max(1, int(DELTA_SEGMENTS_PER_SECOND * (6000 * mm / moves[m].f / 100)));
+      if (joint_log_len != (unsigned long)segments) {
+        printf("FAIL: G1 X%.0f Y%.0f F%.0f planned %lu segments, %d expected\n",
+               moves[m].x, moves[m].y, moves[m].f, joint_log_len, segments);
+        failed++;
+        continue;
+      }
+      for (int s = 1; s <= segments; s++) {
+        float pos[2], angles[2];
+        for (int i = X_AXIS; i <= Y_AXIS; i++)
+          pos[i] = from[i] + difference[i] * (1.0f / segments * s);
+        pos[X_AXIS] -= SCARA_offset_x;
+        pos[Y_AXIS] -= SCARA_offset_y;
+        calculate_scara_angles(pos, angles);
+        const float *block = joint_log + 3 * (s - 1);
+        for (int i = X_AXIS; i <= Y_AXIS; i++)
+          worst = max(worst, (double)fabs(block[i] - (angles[i] - add_homeing[i])));
+      }
+    #endif
+  }
+  free(joint_log);
+  joint_log = NULL;
+  joint_log_size = 0;
+
+  if (worst > 1e-3) {
+    printf("FAIL: the planner got joint angles up to %.6f degrees off the segments\n", worst);
+    failed++;
+  }
+  #ifdef MOTION_STATS
+    if (motion_stats.kinematics_ahead == 0) {
+      printf("FAIL: no segment was worked out while the buffer was full\n");
+      failed++;
+    }
+  #endif
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld\n", "XYZE"[i], pins, counted);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings) {
+    printf("FAIL: %lu errors, %lu warnings\n", stats.errors, stats.warnings);
+    failed++;
+  }
+  printf("staging: %d segments staged ahead of the planner\n", KINEMATICS_STAGING);
+  printf("  planned           %lu segments, joint angles up to %.2e degrees off\n", blocks, worst);
+  #ifdef MOTION_STATS
+    printf("  staged ahead      %lu segments worked out while the buffer was full\n", motion_stats.kinematics_ahead);
+  #endif
+  printf(failed ? "staging: %d FAILED\n" : "staging: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+#endif
+
+#ifdef ENDSTOP_INTERRUPTS
+// Presses the endstop, or lets it go, wherever the motor is and runs its pin interrupt
+static void endstop_force(sim_endstop &e, bool pressed)
+{
+  e.forced = pressed;
+  sim_update_endstops(e.axis);
+  sim_pin_interrupts();
+}
+
+static int cmd_endstops(int argc, char **argv)
+{
+  int failed = 0;
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  sim_endstop *e = NULL;
+  for (int i = 0; i < endstop_count; i++) {
+    if (endstops[i].axis == X_AXIS && endstops[i].side < 0 && (endstops[i].ext >= 0 || endstops[i].bank >= 0))
+      e = &endstops[i];
+  }
+  if (e == NULL) {
+    printf("endstops: X_MIN_PIN has no interrupt, nothing to check\n");
+    return 0;
+  }
+  long start[NUM_AXIS], start_pulses[NUM_AXIS];
+  float base[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    start[i] = st_get_position(i);
+    start_pulses[i] = axes[i].pulses;
+    base[i] = (float)start[i] / axis_steps_per_unit[i];
+  }
+
+  // Down towards X_MIN, which sits far below the arm, pressed half way
+  const float steps_per_degree = axis_steps_per_unit[X_AXIS];
+  const long block_steps = lround(20 * steps_per_degree);
+  long spike_steps = 0, held_steps = 0;
+  enable_endstops(true);
+  for (int run = 0; run < 2; run++) {
+    unsigned long travel = axes[X_AXIS].travel;
+    plan_buffer_line(base[X_AXIS] - 20, base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 0.5 * MAX_STEP_FREQUENCY / steps_per_degree, 0);
+    while (axes[X_AXIS].travel < travel + block_steps / 2) {
+      manage_inactivity();
+      sim_advance(F_CPU / 20000);
+    }
+    unsigned long pressed_at = axes[X_AXIS].travel;
+    endstop_force(*e, true);
+    if (run == 0) endstop_force(*e, false); // gone before the stepper interrupt reads it again
+    st_synchronize();
+    endstop_force(*e, false);
+    if (run == 0) {
+      spike_steps = axes[X_AXIS].travel - travel;
+      if (spike_steps != block_steps) {
+        printf("FAIL: a spike on the endstop line stopped the move after %ld of %ld steps\n", spike_steps, block_steps);
+        failed++;
+      }
+    }
+    else {
+      held_steps = axes[X_AXIS].travel - pressed_at;
+      if (held_steps > 16 || axes[X_AXIS].travel - travel >= (unsigned long)block_steps) {
+        printf("FAIL: a held endstop stopped the move %ld steps after it was pressed\n", held_steps);
+        failed++;
+      }
+    }
+    // The planner goes on from where the arm stopped
+    endstops_hit_on_purpose();
+    base[X_AXIS] = (float)st_get_position(X_AXIS) / steps_per_degree;
+    plan_set_position(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS]);
+  }
+  enable_endstops(false);
+
+  for (int i = 0; i < NUM_AXIS; i++) {
+    long pins = axes[i].pulses - start_pulses[i], counted = st_get_position(i) - start[i];
+    if (pins != counted) {
+      printf("FAIL: axis %c pins stepped %ld, firmware counted %ld\n", "XYZE"[i], pins, counted);
+      failed++;
+    }
+  }
+  if (stats.errors || stats.warnings) {
+    printf("FAIL: %lu errors, %lu warnings\n", stats.errors, stats.warnings);
+    failed++;
+  }
+  printf("endstops: X_MIN pressed in the middle of a %ld step move\n", block_steps);
+  printf("  spike             move ran %ld of %ld steps\n", spike_steps, block_steps);
+  printf("  held              move stopped %ld steps after the press\n", held_steps);
+  printf(failed ? "endstops: %d FAILED\n" : "endstops: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+#endif
+
+//===========================================================================
+//============================= step trace ==================================
+//===========================================================================
+
+// What M123 sends (STEP_TRACE, see stepper.cpp), read back from a log of the serial port
+struct steptrace_record {
+  unsigned long ticks;                 // timer ticks since the interrupt before
+  unsigned latency;                    // timer ticks from the compare match to the first step
+  int steps[NUM_AXIS];                 // signed
+  int flags;                           // 1 first interrupt of a block, 2 ran into the next match
+  int block;
+};
+
+struct steptrace_block {
+  int block;
+  unsigned long step_event_count, initial_rate, nominal_rate, final_rate;
+  long accelerate_until, decelerate_after;
+};
+
+struct steptrace_dump {
+  unsigned long lost;
+  double timer_rate;                   // ticks/s
+  steptrace_record *records;
+  unsigned long len;
+  steptrace_block *blocks;
+  int block_len;
+};
+
+// Takes the trace out of the lines of a serial log, whatever else is in it. Returns false if
+// there is no trace in it.
+static bool steptrace_read(FILE *f, steptrace_dump &dump)
+{
+  memset(&dump, 0, sizeof(dump));
+  bool found = false;
+  unsigned long size = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    const char *p;
+    unsigned long records;
+    if ((p = strstr(line, "Step trace: ")) && sscanf(p, "Step trace: %lu records, %lu lost, %lf ticks/s",
+                                                      &records, &dump.lost, &dump.timer_rate) == 3) {
+      // A later dump replaces an earlier one
+      found = true;
+      dump.len = 0;
+      dump.block_len = 0;
+    }
+    else if (found && (p = strstr(line, "TS "))) {
+      steptrace_record r;
+      if (sscanf(p, "TS %lu %u %d %d %d %d %d %d", &r.ticks, &r.latency, &r.steps[X_AXIS], &r.steps[Y_AXIS],
+                 &r.steps[Z_AXIS], &r.steps[E_AXIS], &r.flags, &r.block) != 8) continue;
+      if (dump.len == size) {
+        size = size ? size * 2 : 1024;
+        dump.records = (steptrace_record *)realloc(dump.records, size * sizeof(steptrace_record));
+      }
+      dump.records[dump.len++] = r;
+    }
+    else if (found && (p = strstr(line, "TB "))) {
+      steptrace_block b;
+      if (sscanf(p, "TB %d %lu %lu %lu %lu %ld %ld", &b.block, &b.step_event_count, &b.initial_rate,
+                 &b.nominal_rate, &b.final_rate, &b.accelerate_until, &b.decelerate_after) != 7) continue;
+      dump.blocks = (steptrace_block *)realloc(dump.blocks, (dump.block_len + 1) * sizeof(steptrace_block));
+      dump.blocks[dump.block_len++] = b;
+    }
+  }
+  // The firmware numbers blocks in 8 bits. Count on from the first record, the blocks with a plan
+  // are the last ones, within 128 of the last record.
+  for (unsigned long i = 1; i < dump.len; i++)
+    dump.records[i].block = dump.records[i - 1].block + ((dump.records[i].block - dump.records[i - 1].block) & 255);
+  int last = dump.len ? dump.records[dump.len - 1].block : 0;
+  for (int b = 0; b < dump.block_len; b++)
+    dump.blocks[b].block = last + (((dump.blocks[b].block - last + 128) & 255) - 128);
+  return found;
+}
+
+static void steptrace_free(steptrace_dump &dump)
+{
+  free(dump.records);
+  free(dump.blocks);
+  memset(&dump, 0, sizeof(dump));
+}
+
+// The step events an interrupt took: the axis with the most steps steps on every one
+static int steptrace_events(const steptrace_record &r)
+{
+  int events = 0;
+  for (int i = 0; i < NUM_AXIS; i++) events = max(events, abs(r.steps[i]));
+  return events;
+}
+
+// Time from the first step of interrupt i to the first step of the next one, in timer ticks. 0
+// where that says nothing about the step rate: the last record, a gap longer than the record
+// holds and an interrupt that ran late.
+static double steptrace_interval(const steptrace_dump &dump, unsigned long i)
+{
+  if (i + 1 >= dump.len) return 0;
+  const steptrace_record &r = dump.records[i], &next = dump.records[i + 1];
+  if (next.ticks >= 65535 || (r.flags & 2)) return 0;
+  return (double)next.ticks + next.latency - r.latency;
+}
+
+// A block as it ran, from its first interrupt in the trace to its last
+struct steptrace_run {
+  unsigned long events;
+  double initial_rate, peak_rate, final_rate;  // step events/s over the first, fastest and last interrupt
+  long accelerate_until, decelerate_after;     // step events before the rate got to 99% of the
+                                               // peak and after it last was there
+  bool complete;                               // all the step events the plan has are in the trace
+};
+
+struct steptrace_report {
+  double span;                         // s from the first interrupt to the last
+  unsigned long interrupts, late, gaps;
+  double latency_avg, latency_max;     // us
+  double jitter_max, jitter_rms;       // of the step interval against the average of its neighbours
+  long steps[NUM_AXIS];
+  double peak[NUM_AXIS];               // steps/s, over STEPTRACE_WINDOW interrupts each side
+  int blocks, blocks_complete;
+  double worst_peak;                   // largest relative difference of a peak rate from the nominal one,
+                                       // on blocks planned to cruise
+  double worst_final;                  // largest relative shortfall of the last rate from the final one
+};
+
+#define STEPTRACE_WINDOW 8
+
+// Goes through a trace. Writes the block table to blocks_out and the step rate of each axis at
+// every interrupt to rates_out, either may be NULL. The rate of an axis is taken over up to
+// STEPTRACE_WINDOW interrupts each side within the block, an axis that steps on some of the step
+// events only gets the rate it moves at, not the one of its pulses. The block table has a line for each block
+// with a plan and its first interrupt in the trace: planned against run step events, initial,
+// nominal/peak and final rates, and the step events where the acceleration ends and the
+// deceleration starts.
+static void steptrace_analyze(const steptrace_dump &dump, steptrace_report &rep, FILE *blocks_out, FILE *rates_out)
+{
+  memset(&rep, 0, sizeof(rep));
+  rep.interrupts = dump.len;
+  double jitter_sum = 0, latency_sum = 0;
+  unsigned long jitter_count = 0;
+  double last_step_interval = 0, before_step_interval = 0;
+  double clock = 0;
+  // Time of the first step of each interrupt and the first interrupt of the run it is in, runs
+  // end at the start of a block, a gap or a late interrupt
+  double *step_time = (double *)malloc((dump.len + 1) * sizeof(double));
+  unsigned long *run_start = (unsigned long *)malloc((dump.len + 1) * sizeof(unsigned long));
+  for (unsigned long i = 0; i < dump.len; i++) {
+    const steptrace_record &r = dump.records[i];
+    if (i > 0) clock += r.ticks;
+    step_time[i] = clock + r.latency;
+    run_start[i] = i > 0 && steptrace_interval(dump, i - 1) && !(r.flags & 1) ? run_start[i - 1] : i;
+  }
+  clock = 0;
+  for (unsigned long i = 0; i < dump.len; i++) {
+    const steptrace_record &r = dump.records[i];
+    if (i > 0) clock += r.ticks;
+    if (r.flags & 2) rep.late++;
+    if (i > 0 && r.ticks >= 65535) rep.gaps++;
+    latency_sum += r.latency;
+    rep.latency_max = max(rep.latency_max, (double)r.latency);
+    for (int a = 0; a < NUM_AXIS; a++) rep.steps[a] += r.steps[a];
+
+    double interval = steptrace_interval(dump, i);
+    int events = steptrace_events(r);
+    // The window runs from the first step of interrupt from to the first one after interrupt to
+    unsigned long from = max(run_start[i], i >= STEPTRACE_WINDOW ? i - STEPTRACE_WINDOW : 0), to = i;
+    while (to + 1 < dump.len && to < i + STEPTRACE_WINDOW && run_start[to + 1] == run_start[i]) to++;
+    double window = steptrace_interval(dump, to) ? step_time[to + 1] - step_time[from] : 0;
+    double rate[NUM_AXIS];
+    for (int a = 0; a < NUM_AXIS; a++) {
+      long steps = 0;
+      for (unsigned long j = from; j <= to; j++) steps += dump.records[j].steps[a];
+      rate[a] = window ? steps * dump.timer_rate / window : 0;
+      rep.peak[a] = max(rep.peak[a], fabs(rate[a]));
+    }
+    if (rates_out) {
+      fprintf(rates_out, "%.6f", clock / dump.timer_rate);
+      for (int a = 0; a < NUM_AXIS; a++) fprintf(rates_out, " %.1f", rate[a]);
+      fprintf(rates_out, "\n");
+    }
+    // The step interval against the average of the ones before and after, within a block
+    double step_interval = interval && events ? interval / events : 0;
+    if (r.flags & 1) last_step_interval = before_step_interval = 0;
+    if (before_step_interval && last_step_interval && step_interval) {
+      double jitter = fabs(2 * last_step_interval - before_step_interval - step_interval) / (2 * last_step_interval);
+      rep.jitter_max = max(rep.jitter_max, jitter);
+      jitter_sum += jitter * jitter;
+      jitter_count++;
+    }
+    before_step_interval = last_step_interval;
+    last_step_interval = step_interval;
+  }
+  free(step_time);
+  free(run_start);
+  rep.span = clock / dump.timer_rate;
+  rep.latency_avg = dump.len ? latency_sum / dump.len * 1e6 / dump.timer_rate : 0;
+  rep.latency_max *= 1e6 / dump.timer_rate;
+  rep.jitter_rms = jitter_count ? sqrt(jitter_sum / jitter_count) : 0;
+
+  if (blocks_out)
+    fprintf(blocks_out, "block   events planned/run    initial planned/run    nominal/peak     final planned/run"
+                        "    accel until planned/run  decel after planned/run\n");
+  for (unsigned long i = 0; i < dump.len; i++) {
+    if (!(dump.records[i].flags & 1)) continue;
+    const steptrace_block *plan = NULL;
+    for (int b = 0; b < dump.block_len; b++)
+      if (dump.blocks[b].block == dump.records[i].block) plan = &dump.blocks[b];
+    if (!plan) continue;
+    steptrace_run run;
+    memset(&run, 0, sizeof(run));
+    unsigned long end = i;
+    for (; end < dump.len && dump.records[end].block == plan->block && (end == i || !(dump.records[end].flags & 1)); end++) {
+      double interval = steptrace_interval(dump, end);
+      double rate = interval ? steptrace_events(dump.records[end]) * dump.timer_rate / interval : 0;
+      if (end == i) run.initial_rate = rate;
+      if (rate) run.final_rate = rate;
+      run.peak_rate = max(run.peak_rate, rate);
+      run.events += steptrace_events(dump.records[end]);
+    }
+    run.complete = run.events == plan->step_event_count;
+    unsigned long events = 0;
+    run.accelerate_until = -1;
+    for (unsigned long j = i; j < end; j++) {
+      double interval = steptrace_interval(dump, j);
+      double rate = interval ? steptrace_events(dump.records[j]) * dump.timer_rate / interval : 0;
+      if (rate >= 0.99 * run.peak_rate) {
+        if (run.accelerate_until < 0) run.accelerate_until = events;
+        run.decelerate_after = events;
+      }
+      events += steptrace_events(dump.records[j]);
+    }
+    rep.blocks++;
+    if (run.complete) {
+      rep.blocks_complete++;
+      if (plan->decelerate_after > plan->accelerate_until)
+        rep.worst_peak = max(rep.worst_peak, fabs(run.peak_rate - plan->nominal_rate) / plan->nominal_rate);
+      if (run.final_rate < plan->final_rate)
+        rep.worst_final = max(rep.worst_final, (plan->final_rate - run.final_rate) / plan->final_rate);
+    }
+    if (blocks_out)
+      fprintf(blocks_out, "%5d  %7lu %7lu%s    %7lu %7.0f    %7lu %7.0f    %7lu %7.0f    %7ld %7ld        %7ld %7ld\n",
+              plan->block, plan->step_event_count, run.events, run.complete ? " " : "*",
+              plan->initial_rate, run.initial_rate, plan->nominal_rate, run.peak_rate,
+              plan->final_rate, run.final_rate, plan->accelerate_until, run.accelerate_until,
+              plan->decelerate_after, run.decelerate_after);
+  }
+}
+
+static void steptrace_print(const steptrace_dump &dump, const steptrace_report &rep)
+{
+  printf("  interrupts        %lu over %.3f s, %lu lost before the first\n", rep.interrupts, rep.span, dump.lost);
+  printf("  latency           avg %.1f us, max %.1f us from the compare match to the first step\n",
+         rep.latency_avg, rep.latency_max);
+  printf("  missed deadlines  %lu interrupts ran into the next compare match, %lu gaps over 65535 ticks\n",
+         rep.late, rep.gaps);
+  printf("  jitter            step interval off the average of its neighbours by %.2f%% rms, %.2f%% max\n",
+         rep.jitter_rms * 100, rep.jitter_max * 100);
+  for (int a = 0; a < NUM_AXIS; a++)
+    printf("  axis %c            %ld steps, peak %.0f steps/s\n", "XYZE"[a], rep.steps[a], rep.peak[a]);
+  printf("  blocks            %d with a plan, %d complete, peak off nominal by up to %.2f%%,"
+         " last rate under the final one by up to %.2f%%\n",
+         rep.blocks, rep.blocks_complete, rep.worst_peak * 100, rep.worst_final * 100);
+}
+
+#ifdef STEP_TRACE
+// Traces joint moves with M123: out and back at 80% of MAX_STEP_FREQUENCY, then short extruding
+// blocks with corners between them, and holds the trace against what the simulator saw.
+static int steptrace_sim(steptrace_dump &dump, steptrace_report &rep)
+{
+  int failed = 0;
+  memset(&dump, 0, sizeof(dump));
+  host_queue(check_home);
+  sim_reset();
+  if (!sim_run_until_idle()) return 1;
+  float base[NUM_AXIS];
+  long start_pulses[NUM_AXIS];
+  for (int i = 0; i < NUM_AXIS; i++) {
+    base[i] = (float)st_get_position(i) / axis_steps_per_unit[i];
+    start_pulses[i] = axes[i].pulses;
+  }
+
+  host_capture = tmpfile();
+  isr_log_size = STEP_TRACE_SIZE + 1;
+  isr_log = (sim_isr_entry *)malloc(isr_log_size * sizeof(sim_isr_entry));
+  isr_log_len = 0;
+  host_queue("M123 S1\n");
+  if (!sim_run_until_idle()) return 1;
+  multistep_move(60, 0.8 * MAX_STEP_FREQUENCY / axis_steps_per_unit[X_AXIS], base);
+  for (int i = 1; i <= 10; i++)
+    plan_buffer_line(base[X_AXIS] + i * 3, base[Y_AXIS] + (i & 1) * 2, base[Z_AXIS], base[E_AXIS] + i * 0.2, 20 + i * 4, 0);
+  base[E_AXIS] += 2;
+  plan_buffer_line(base[X_AXIS], base[Y_AXIS], base[Z_AXIS], base[E_AXIS], 40, 0);
+  st_synchronize();
+  host_queue("M123\n");
+  if (!sim_run_until_idle()) return 1;
+
+  rewind(host_capture);
+  bool found = steptrace_read(host_capture, dump);
+  fclose(host_capture);
+  host_capture = NULL;
+  if (!found) {
+    printf("FAIL: M123 sent no trace\n");
+    return 1;
+  }
+  steptrace_analyze(dump, rep, NULL, NULL);
+
+  if (dump.lost || dump.len != isr_log_len) {
+    printf("FAIL: %lu interrupts traced and %lu lost, the simulator saw %lu\n", dump.len, dump.lost, isr_log_len);
+    failed++;
+  }
+  const uint64_t cycles_per_tick = F_CPU / STEPPER_TIMER_RATE;
+  unsigned long wrong_time = 0, wrong_steps = 0;
+  for (unsigned long i = 0; i < min(dump.len, isr_log_len); i++) {
+    const steptrace_record &r = dump.records[i];
+    if (i > 0 && r.ticks < 65535 && isr_log[i].clock - isr_log[i - 1].clock != r.ticks * cycles_per_tick) wrong_time++;
+    int steps = 0;
+    for (int a = 0; a < NUM_AXIS; a++) steps += abs(r.steps[a]);
+    if (steps != isr_log[i].steps) wrong_steps++;
+  }
+  if (wrong_time || wrong_steps) {
+    printf("FAIL: %lu interrupts traced at the wrong time, %lu with the wrong steps\n", wrong_time, wrong_steps);
+    failed++;
+  }
+  for (int a = 0; a < NUM_AXIS; a++) {
+    if (rep.steps[a] != axes[a].pulses - start_pulses[a]) {
+      printf("FAIL: axis %c traced %ld steps, the pins stepped %ld\n", "XYZE"[a], rep.steps[a], axes[a].pulses - start_pulses[a]);
+      failed++;
+    }
+  }
+  // The simulated interrupts take no time, so none can run late, and no endstop stops a block
+  if (rep.late || rep.blocks == 0 || rep.blocks_complete != rep.blocks) {
+    printf("FAIL: %lu late interrupts, %d of %d blocks complete\n", rep.late, rep.blocks_complete, rep.blocks);
+    failed++;
+  }
+  if (rep.worst_peak > 0.02 || rep.worst_final > 0.02) {
+    printf("FAIL: peak rate off the nominal one by %.2f%%, last rate under the final one by %.2f%%\n",
+           rep.worst_peak * 100, rep.worst_final * 100);
+    failed++;
+  }
+  free(isr_log);
+  isr_log = NULL;
+  isr_log_size = 0;
+  return failed;
+}
+#endif // STEP_TRACE
+
+// Without a log, traces moves in the simulator (STEP_TRACE builds) and checks the trace step for
+// step against the pins. With one, analyzes the last M123 trace in it. -b prints the blocks, -r
+// writes "<s> <X> <Y> <Z> <E>" step rates for each interrupt to a file.
+static int cmd_trace(int argc, char **argv)
+{
+  const char *log = NULL;
+  FILE *rates_out = NULL;
+  bool blocks = false;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "-b") == 0) blocks = true;
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      rates_out = fopen(argv[++i], "w");
+      if (!rates_out) { perror(argv[i]); return 2; }
+    }
+    else log = argv[i];
+  }
+
+  int failed = 0;
+  steptrace_dump dump;
+  steptrace_report rep;
+  if (log) {
+    FILE *f = strcmp(log, "-") == 0 ? stdin : fopen(log, "r");
+    if (!f) { perror(log); return 2; }
+    bool found = steptrace_read(f, dump);
+    if (f != stdin) fclose(f);
+    if (!found) {
+      fprintf(stderr, "marlin_sim: no M123 step trace in %s\n", log);
+      return 2;
+    }
+  }
+  else {
+#ifdef STEP_TRACE
+    failed = steptrace_sim(dump, rep);
+#else
+    fprintf(stderr, "marlin_sim: built without STEP_TRACE, give a serial log with an M123 trace\n");
+    return 2;
+#endif
+  }
+  steptrace_analyze(dump, rep, blocks ? stdout : NULL, rates_out);
+  if (rates_out) fclose(rates_out);
+  printf("trace: %s\n", log ? log : "simulated moves");
+  steptrace_print(dump, rep);
+  steptrace_free(dump);
+  if (!log) printf(failed ? "trace: %d FAILED\n" : "trace: all passed\n", failed);
+  return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  const char *cmd = argc > 1 ? argv[1] : "run";
+  if (strcmp(cmd, "run") == 0) return cmd_run(argc - 2 > 0 ? argc - 2 : 0, argv + 2);
+  if (strcmp(cmd, "bench") == 0) return cmd_bench(argc - 2, argv + 2);
+  if (strcmp(cmd, "check") == 0) return cmd_check(argc - 2, argv + 2);
+  if (strcmp(cmd, "trapezoid") == 0) return cmd_trapezoid(argc - 2, argv + 2);
+  if (strcmp(cmd, "timers") == 0) return cmd_timers(argc - 2, argv + 2);
+  if (strcmp(cmd, "multistep") == 0) return cmd_multistep(argc - 2, argv + 2);
+  if (strcmp(cmd, "stop") == 0) return cmd_stop(argc - 2, argv + 2);
+  if (strcmp(cmd, "trace") == 0) return cmd_trace(argc - 2, argv + 2);
+#ifdef SPEED_OVERRIDE_REPLAN
+  if (strcmp(cmd, "override") == 0) return cmd_override(argc - 2, argv + 2);
+#endif
+#ifdef LIN_ADVANCE
+  if (strcmp(cmd, "advance") == 0) return cmd_advance(argc - 2, argv + 2);
+#endif
+#ifdef BABYSTEPPING
+  if (strcmp(cmd, "babystep") == 0) return cmd_babystep(argc - 2, argv + 2);
+#endif
+  if (strcmp(cmd, "ik") == 0) return cmd_ik(argc - 2, argv + 2);
+  if (strcmp(cmd, "chord") == 0) return cmd_chord(argc - 2, argv + 2);
+  if (strcmp(cmd, "arc") == 0) return cmd_arc(argc - 2, argv + 2);
+#ifdef KINEMATICS_STAGING
+  if (strcmp(cmd, "staging") == 0) return cmd_staging(argc - 2, argv + 2);
+#endif
+#ifdef ENDSTOP_INTERRUPTS
+  if (strcmp(cmd, "endstops") == 0) return cmd_endstops(argc - 2, argv + 2);
+#endif
+  fprintf(stderr, "usage: marlin_sim run [-v] [-t trace.txt] [-d ms] [file.gcode]\n"
+                  "       marlin_sim bench [blocks | file.gcode]\n"
+                  "       marlin_sim check\n"
+                  "       marlin_sim trapezoid [reference.txt | -]\n"
+                  "       marlin_sim timers\n"
+                  "       marlin_sim multistep\n"
+                  "       marlin_sim stop\n"
+                  "       marlin_sim trace [-b] [-r rates.txt] [serial.log | -]\n"
+#ifdef SPEED_OVERRIDE_REPLAN
+                  "       marlin_sim override\n"
+#endif
+#ifdef LIN_ADVANCE
+                  "       marlin_sim advance\n"
+#endif
+#ifdef BABYSTEPPING
+                  "       marlin_sim babystep\n"
+#endif
+                  "       marlin_sim ik\n"
+                  "       marlin_sim chord\n"
+                  "       marlin_sim arc\n"
+#ifdef KINEMATICS_STAGING
+                  "       marlin_sim staging\n"
+#endif
+#ifdef ENDSTOP_INTERRUPTS
+                  "       marlin_sim endstops\n"
+#endif
+                  );
+  return 2;
+}
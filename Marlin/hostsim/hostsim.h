@@ -0,0 +1,24 @@
+/*
+  hostsim.h - interface of the host simulator core (hostsim.cpp)
+*/
+
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+#include "sim_avr.h"
+
+// Virtual CPU cycles since reset, at F_CPU
+extern uint64_t sim_clock;
+
+// Lets the virtual clock run for the given number of CPU cycles, firing the
+// Timer1 compare and serial receive interrupts that fall in that window.
+void sim_advance(uint64_t cycles);
+
+// Called whenever the firmware idles (manage_heater()). Advances the clock
+// by one main loop pass.
+void sim_idle();
+
+// Host wall clock in nanoseconds, for the benchmarks
+uint64_t sim_host_ns();
+
+#endif // HOSTSIM_H
@@ -0,0 +1,303 @@
+/*
+  sim_avr.h - just enough of avr-libc and the Arduino core to build the
+  motion code of Marlin on a desktop machine (see hostsim.cpp).
+
+  The I/O ports are small objects so the simulator can watch the step and
+  direction pins being written, every other register is a plain variable.
+  ISR() bodies become ordinary functions that the simulator calls from its
+  virtual clock.
+*/
+
+#ifndef HOSTSIM_AVR_H
+#define HOSTSIM_AVR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+// SdBaseFile.h declares its own fpos_t, which avr-libc does not have. This
+// header is force-included (-include) so the host one can be renamed here.
+#define fpos_t host_fpos_t
+#include <stdio.h>
+#undef fpos_t
+
+//===========================================================================
+//============================= I/O registers ===============================
+//===========================================================================
+
+// Called on every write to a PORTx register that has a nonzero id.
+void sim_port_write(uint8_t id, uint8_t old_value, uint8_t new_value);
+
+struct sim_reg8
+{
+  volatile uint8_t value;
+  uint8_t id;
+
+  inline operator uint8_t() const { return value; }
+  inline volatile uint8_t *operator&() { return &value; }
+  inline sim_reg8 &operator=(uint8_t v)
+  {
+    uint8_t old = value;
+    value = v;
+    if (id) sim_port_write(id, old, v);
+    return *this;
+  }
+  // int like the register operands on the AVR, so &= ~_BV(n) doesn't narrow a negative mask
+  inline sim_reg8 &operator|=(int v) { return *this = (uint8_t)(value | v); }
+  inline sim_reg8 &operator&=(int v) { return *this = (uint8_t)(value & v); }
+  inline sim_reg8 &operator^=(int v) { return *this = (uint8_t)(value ^ v); }
+};
+
+#define SIM_PORT_REGS(P) extern sim_reg8 PORT##P, PIN##P, DDR##P;
+SIM_PORT_REGS(A) SIM_PORT_REGS(B) SIM_PORT_REGS(C) SIM_PORT_REGS(D)
+SIM_PORT_REGS(E) SIM_PORT_REGS(F) SIM_PORT_REGS(G) SIM_PORT_REGS(H)
+SIM_PORT_REGS(J) SIM_PORT_REGS(K) SIM_PORT_REGS(L)
+
+// The UART data register: reads pop the simulated host's bytes, writes go
+// to the simulated host.
+struct sim_udr
+{
+  operator uint8_t() const;
+  sim_udr &operator=(uint8_t c);
+};
+extern sim_udr UDR0;
+// UCSR0A: the transmitter is always ready, RXC follows the host's queue.
+struct sim_ucsra
+{
+  volatile uint8_t value;
+  operator uint8_t() const;
+  inline sim_ucsra &operator=(uint8_t v) { value = v; return *this; }
+};
+extern sim_ucsra UCSR0A;
+
+// Marlin tests for some registers with #if defined(...)
+#define UBRR0H UBRR0H
+#define UDR0 UDR0
+#define TCCR0A TCCR0A
+
+extern volatile uint8_t SREG, MCUSR;
+extern volatile uint8_t UCSR0B, UBRR0H, UBRR0L;
+extern volatile uint8_t TCCR0A, TCCR0B, TCCR1A, TCCR1B, TCCR2A, TCCR2B;
+extern volatile uint8_t TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+extern volatile uint8_t TIMSK0, TIMSK1, OCR0A, OCR0B;
+extern volatile uint16_t OCR1A, TCNT1;
+extern volatile uint8_t EICRA, EICRB, EIMSK, PCICR, PCMSK0, PCMSK1, PCMSK2;
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_BYTE(sfr) (sfr)
+
+#define OCIE0A 1
+#define OCIE0B 2
+#define OCIE1A 1
+#define WGM00 0
+#define WGM01 1
+#define WGM10 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define COM1B0 4
+#define COM1A0 6
+#define CS00 0
+#define CS10 0
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define CS40 0
+#define CS41 1
+#define CS42 2
+#define CS50 0
+#define CS51 1
+#define CS52 2
+#define U2X0 1
+#define UDRE0 5
+#define RXC0 7
+#define TXEN0 3
+#define RXEN0 4
+#define RXCIE0 7
+
+// Pin bit numbers used by fastio.h (PINA0 .. PINL7)
+#define PINA0 0
+#define PINA1 1
+#define PINA2 2
+#define PINA3 3
+#define PINA4 4
+#define PINA5 5
+#define PINA6 6
+#define PINA7 7
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+#define PINB4 4
+#define PINB5 5
+#define PINB6 6
+#define PINB7 7
+#define PINC0 0
+#define PINC1 1
+#define PINC2 2
+#define PINC3 3
+#define PINC4 4
+#define PINC5 5
+#define PINC6 6
+#define PINC7 7
+#define PIND0 0
+#define PIND1 1
+#define PIND2 2
+#define PIND3 3
+#define PIND4 4
+#define PIND5 5
+#define PIND6 6
+#define PIND7 7
+#define PINE0 0
+#define PINE1 1
+#define PINE2 2
+#define PINE3 3
+#define PINE4 4
+#define PINE5 5
+#define PINE6 6
+#define PINE7 7
+#define PINF0 0
+#define PINF1 1
+#define PINF2 2
+#define PINF3 3
+#define PINF4 4
+#define PINF5 5
+#define PINF6 6
+#define PINF7 7
+#define PING0 0
+#define PING1 1
+#define PING2 2
+#define PING3 3
+#define PING4 4
+#define PING5 5
+#define PING6 6
+#define PING7 7
+#define PINH0 0
+#define PINH1 1
+#define PINH2 2
+#define PINH3 3
+#define PINH4 4
+#define PINH5 5
+#define PINH6 6
+#define PINH7 7
+#define PINJ0 0
+#define PINJ1 1
+#define PINJ2 2
+#define PINJ3 3
+#define PINJ4 4
+#define PINJ5 5
+#define PINJ6 6
+#define PINJ7 7
+#define PINK0 0
+#define PINK1 1
+#define PINK2 2
+#define PINK3 3
+#define PINK4 4
+#define PINK5 5
+#define PINK6 6
+#define PINK7 7
+#define PINL0 0
+#define PINL1 1
+#define PINL2 2
+#define PINL3 3
+#define PINL4 4
+#define PINL5 5
+#define PINL6 6
+#define PINL7 7
+
+//===========================================================================
+//============================= interrupts ==================================
+//===========================================================================
+
+#define ISR(vector) extern "C" void vector(void); extern "C" void vector(void)
+#define SIGNAL(vector) ISR(vector)
+#define cli() (SREG &= (uint8_t)~0x80)
+#define sei() (SREG |= 0x80)
+
+//===========================================================================
+//============================= program memory / eeprom =====================
+//===========================================================================
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char *
+typedef char prog_char;
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_float(p) (*(const float *)(p))
+#define pgm_read_byte_near(p) pgm_read_byte(p)
+#define pgm_read_word_near(p) pgm_read_word(p)
+#define pgm_read_dword_near(p) pgm_read_dword(p)
+#define pgm_read_float_near(p) pgm_read_float(p)
+#define strstr_P strstr
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define sprintf_P sprintf
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+
+//===========================================================================
+//============================= Arduino core ================================
+//===========================================================================
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define A0 54
+
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+#define sq(x) ((x)*(x))
+inline double square(double x) { return x * x; }  // avr-libc extension
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void _delay_ms(double ms);
+void _delay_us(double us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+class String
+{
+  public:
+    String(const char *s = "") { strncpy(buf, s, sizeof(buf) - 1); buf[sizeof(buf) - 1] = 0; }
+    unsigned int length() const { return strlen(buf); }
+    char operator[](unsigned int i) const { return buf[i]; }
+  private:
+    char buf[64];
+};
+
+class SPIClass
+{
+  public:
+    void begin() {}
+    uint8_t transfer(uint8_t data) { return data; }
+};
+extern SPIClass SPI;
+
+#endif // HOSTSIM_AVR_H
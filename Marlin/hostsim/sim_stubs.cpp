@@ -0,0 +1,101 @@
+/*
+  sim_stubs.cpp - stand-ins for the parts of Marlin the host simulator does
+  not build: temperature control, the LCD panel and the SD card.
+
+  The hotend reads as hot so extrusion is allowed and M109/M190 return at
+  once. manage_heater() is where the firmware idles, so it drives the
+  virtual clock.
+*/
+
+#include "Marlin.h"
+#include "temperature.h"
+#include "ultralcd.h"
+#include "cardreader.h"
+#include "hostsim.h"
+
+//===========================================================================
+//============================= temperature =================================
+//===========================================================================
+
+int target_temperature[EXTRUDERS] = { 0 };
+float current_temperature[EXTRUDERS] = { 210 };
+int target_temperature_bed = 0;
+float current_temperature_bed = 60;
+#ifdef PIDTEMP
+  float Kp = DEFAULT_Kp, Ki = DEFAULT_Ki, Kd = DEFAULT_Kd, Kc = 1;
+#endif
+#ifdef PIDTEMPBED
+  float bedKp = DEFAULT_bedKp, bedKi = DEFAULT_bedKi, bedKd = DEFAULT_bedKd;
+#endif
+
+void tp_init() {}
+void manage_heater() { sim_idle(); }
+int getHeaterPower(int heater) { return 0; }
+void disable_heater() {}
+void setWatch() {}
+void updatePID() {}
+void PID_autotune(float temp, int extruder, int ncycles) {}
+
+//===========================================================================
+//============================= LCD =========================================
+//===========================================================================
+
+#ifdef ULTRA_LCD
+  int plaPreheatHotendTemp = PLA_PREHEAT_HOTEND_TEMP;
+  int plaPreheatHPBTemp = PLA_PREHEAT_HPB_TEMP;
+  int plaPreheatFanSpeed = PLA_PREHEAT_FAN_SPEED;
+  int absPreheatHotendTemp = ABS_PREHEAT_HOTEND_TEMP;
+  int absPreheatHPBTemp = ABS_PREHEAT_HPB_TEMP;
+  int absPreheatFanSpeed = ABS_PREHEAT_FAN_SPEED;
+  #ifdef ULTIPANEL
+    volatile uint8_t buttons = 0;
+    void lcd_buttons_update() {}
+  #endif
+
+  void lcd_update() {}
+  void lcd_init() {}
+  void lcd_setstatus(const char* message) {}
+  void lcd_setstatuspgm(const char* message) {}
+  void lcd_setalertstatuspgm(const char* message) {}
+  void lcd_reset_alert_level() {}
+#endif
+
+//===========================================================================
+//============================= SD card =====================================
+//===========================================================================
+
+#ifdef SDSUPPORT
+  CardReader::CardReader()
+  {
+    saving = false;
+    sdprinting = false;
+    cardOK = false;
+    autostart_stilltocheck = false;
+    filesize = 0;
+    sdpos = 0;
+  }
+  void CardReader::initsd() {}
+  void CardReader::write_command(char *buf) {}
+  void CardReader::checkautostart(bool x) {}
+  void CardReader::openFile(char* name, bool read) {}
+  void CardReader::removeFile(char* name) {}
+  void CardReader::closefile() {}
+  void CardReader::release() {}
+  void CardReader::startFileprint() {}
+  void CardReader::pauseSDPrint() {}
+  void CardReader::getStatus() {}
+  void CardReader::printingHasFinished() {}
+  void CardReader::ls() {}
+
+  bool SdBaseFile::close() { return true; }
+  int16_t SdBaseFile::read() { return -1; }
+  bool SdBaseFile::seekSet(uint32_t pos) { return false; }
+  void SdFile::write(uint8_t b) {}
+#endif
+
+//===========================================================================
+//============================= memory ======================================
+//===========================================================================
+
+// The freeMemory() in Marlin_main.cpp looks at the avr-libc heap symbols, the host has none
+extern "C" int freeMemory() { return 0; }
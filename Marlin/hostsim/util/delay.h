@@ -0,0 +1,2 @@
+// Host simulator stand-in, see sim_avr.h
+#include "../sim_avr.h"
@@ -24,12 +24,18 @@
 #include "planner.h"
 
 // The arc is approximated by generating a huge number of tiny, linear segments. The length of each 
-// segment is configured in settings.mm_per_arc_segment.  
+// segment is MM_PER_ARC_SEGMENT, or with ARC_MAX_DEVIATION what keeps the chords that close to the
+// circle. The points go through prepare_move() like G1 moves, which cuts them up for the arms.
 void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8_t axis_1, 
-  uint8_t axis_linear, float feed_rate, float radius, uint8_t isclockwise, uint8_t extruder)
+  uint8_t axis_linear, float radius, uint8_t isclockwise)
 {      
   //   int acceleration_manager_was_enabled = plan_is_acceleration_manager_enabled();
   //   plan_set_acceleration_manager_enabled(false); // disable acceleration management for the duration of the arc
+  // target is the destination prepare_move() goes to, which the points of the arc take over
+  float arc_end[NUM_AXIS];
+  for (int8_t i = 0; i < NUM_AXIS; i++) {
+    arc_end[i] = target[i];
+  }
   float center_axis0 = position[axis_0] + offset[axis_0];
   float center_axis1 = position[axis_1] + offset[axis_1];
   float linear_travel = target[axis_linear] - position[axis_linear];
@@ -46,7 +52,14 @@ void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8
   
   float millimeters_of_travel = hypot(angular_travel*radius, fabs(linear_travel));
   if (millimeters_of_travel < 0.001) { return; }
+#ifdef ARC_MAX_DEVIATION
+  // The longest chord with its middle ARC_MAX_DEVIATION off the circle
+  float mm_per_arc_segment = 2 * sqrt(max(2 * radius * ARC_MAX_DEVIATION - ARC_MAX_DEVIATION * ARC_MAX_DEVIATION, 0.0));
+  mm_per_arc_segment = constrain(mm_per_arc_segment, MIN_MM_PER_ARC_SEGMENT, MM_PER_ARC_SEGMENT);
+  uint16_t segments = ceil(millimeters_of_travel/mm_per_arc_segment);
+#else
   uint16_t segments = floor(millimeters_of_travel/MM_PER_ARC_SEGMENT);
+#endif
   if(segments == 0) segments = 1;
   
   /*  
@@ -72,23 +85,14 @@ void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8
      round off issues for CNC applications.) Single precision error can accumulate to be greater than
      tool precision in some cases. Therefore, arc path correction is implemented. 
 
-     Small angle approximation may be used to reduce computation overhead further. This approximation
-     holds for everything, but very small circles and large mm_per_arc_segment values. In other words,
-     theta_per_segment would need to be greater than 0.1 rad and N_ARC_CORRECTION would need to be large
-     to cause an appreciable drift error. N_ARC_CORRECTION~=25 is more than small enough to correct for 
-     numerical drift error. N_ARC_CORRECTION may be on the order a hundred(s) before error becomes an
-     issue for CNC machines with the single precision Arduino calculations.
-     
-     This approximation also allows mc_arc to immediately insert a line segment into the planner 
-     without the initial overhead of computing cos() or sin(). By the time the arc needs to be applied
-     a correction, the planner should have caught up to the lag caused by the initial mc_arc overhead. 
-     This is important when there are successive arc motions. 
+     N_ARC_CORRECTION~=25 is more than small enough to correct for numerical drift error.
   */
-  // Vector rotation matrix values
-  float cos_T = 1-0.5*theta_per_segment*theta_per_segment; // Small angle approximation
-  float sin_T = theta_per_segment;
+  // Vector rotation matrix values. Not the small angle approximation, G2/G3 on SCARA go through
+  // prepare_move() and the kinematics and an arc of a few mm radius can take 0.5 rad per segment.
+  float cos_T = cos(theta_per_segment);
+  float sin_T = sin(theta_per_segment);
   
-  float arc_target[4];
+  float arc_target[NUM_AXIS];
   float sin_Ti;
   float cos_Ti;
   float r_axisi;
@@ -125,12 +129,14 @@ void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8
     arc_target[axis_linear] += linear_per_segment;
     arc_target[E_AXIS] += extruder_per_segment;
 
-    clamp_to_software_endstops(arc_target);
-    plan_buffer_line(arc_target[X_AXIS], arc_target[Y_AXIS], arc_target[Z_AXIS], arc_target[E_AXIS], feed_rate, extruder);
+    prepare_move_to(arc_target);
+    if (moves_stopped) {
+      return;
+    }
     
   }
   // Ensure last segment arrives at target location.
-  plan_buffer_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], target[E_AXIS], feed_rate, extruder);
+  prepare_move_to(arc_end);
 
   //   plan_set_acceleration_manager_enabled(acceleration_manager_was_enabled);
 }
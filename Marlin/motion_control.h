@@ -25,9 +25,9 @@
 // Execute an arc in offset mode format. position == current xyz, target == target xyz, 
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used
-// for vector transformation direction.
+// for vector transformation direction. The feed rate and the extruder are the ones of G1 moves.
 void mc_arc(float *position, float *target, float *offset, unsigned char axis_0, unsigned char axis_1,
-  unsigned char axis_linear, float feed_rate, float radius, unsigned char isclockwise, uint8_t extruder);
+  unsigned char axis_linear, float radius, unsigned char isclockwise);
   
 #endif
 
@@ -72,13 +72,22 @@ float retract_acceleration; //  mm/s^2   filament pull-pack and push-forward  wh
 float max_xy_jerk; //speed than can be stopped at once, if i understand correctly.
 float max_z_jerk;
 float max_e_jerk;
+float junction_deviation; // M205 J, 0 selects the jerk planner
+#ifdef LIN_ADVANCE
+float extruder_advance_k; // M900 K
+#endif
 float mintravelfeedrate;
 unsigned long axis_steps_per_sqr_second[NUM_AXIS];
+#ifdef MOTION_STATS
+motion_stats_t motion_stats;
+#endif
 
 // The current position of the tool in absolute steps
 long position[4];   //rescaled from extern when axis_steps_per_unit are changed by gcode
 static float previous_speed[4]; // Speed of previous path line segment
 static float previous_nominal_speed; // Nominal speed of previous path line segment
+static float previous_unit_vec[3]; // Unit vector of previous path line segment, zero for extruder only moves
+static float dropped_cartesian_mm; // Tool distance of dropped kinematics segments, joined with the next one
 
 #ifdef AUTOTEMP
 float autotemp_max=250;
@@ -93,6 +102,11 @@ bool autotemp_enabled=false;
 block_t block_buffer[BLOCK_BUFFER_SIZE];            // A ring buffer for motion instfructions
 volatile unsigned char block_buffer_head;           // Index of the next block to be pushed
 volatile unsigned char block_buffer_tail;           // Index of the block to process now
+static unsigned char block_buffer_planned;          // Index of the last block whose entry speed is final
+static unsigned char block_buffer_planned_tail;     // block_buffer_tail when block_buffer_planned was checked
+#ifdef STEP_SEGMENT_BUFFER
+unsigned char block_buffer_prepared;                // Index of the next block to cut into step segments
+#endif
 
 //===========================================================================
 //=============================private variables ============================
@@ -107,6 +121,10 @@ static unsigned char old_direction_bits = 0;               // Old direction bits
 static long x_segment_time[3]={MAX_FREQ_TIME + 1,0,0};     // Segment times (in us). Used for speed calculations
 static long y_segment_time[3]={MAX_FREQ_TIME + 1,0,0};
 #endif
+#ifdef SLOWDOWN
+static unsigned long block_buffer_time;       // Planned time of the blocks in the buffer in us
+static unsigned char block_buffer_time_tail;  // Tail block_buffer_time has been brought up to
+#endif
 
 // Returns the index of the next block in the ring buffer
 // NOTE: Removed modulo (%) operator, which uses an expensive divide and multiplication.
@@ -128,6 +146,31 @@ static int8_t prev_block_index(int8_t block_index) {
   return(block_index);
 }
 
+#ifdef SLOWDOWN
+// Returns the planned time of the blocks in the buffer in us, after taking off the blocks the
+// stepper has finished since the last call. Has to be called for every new block.
+static unsigned long planner_queued_time() {
+  unsigned char tail = block_buffer_tail;
+  while (block_buffer_time_tail != tail) {
+    block_buffer_time -= block_buffer[block_buffer_time_tail].planned_time;
+    block_buffer_time_tail = next_block_index(block_buffer_time_tail);
+  }
+  return block_buffer_time;
+}
+
+// The kinematics segments of a move all go into the buffer at once, so slowing single blocks
+// down does not help when the host can not keep up. Instead the caller slows the whole move down
+// by this factor, which drops below 1 when the move arrives with less than SLOWDOWN_HORIZON of
+// planned time left in the buffer. That gives the host more time for the next one.
+float plan_slowdown_factor() {
+  unsigned long queued_time = planner_queued_time();
+  if (!blocks_queued() || queued_time >= SLOWDOWN_HORIZON) {
+    return 1.0; // Standing still or enough in the buffer
+  }
+  return max((float)queued_time / SLOWDOWN_HORIZON, SLOWDOWN_MIN_FACTOR);
+}
+#endif
+
 //===========================================================================
 //=============================functions         ============================
 //===========================================================================
@@ -161,11 +204,87 @@ FORCE_INLINE float intersection_distance(float initial_rate, float final_rate, f
   }
 }
 
-// Calculates trapezoid parameters so that the entry- and exit-speed is compensated by the provided factors.
+#ifdef PLANNER_FIXED_POINT
+// Stores 1/(2*acceleration_st) in the block as a 16 bit mantissa and a right shift, so that
+// acceleration_steps() can do without a division.
+void calculate_acceleration_inverse(block_t *block)
+{
+  block->acceleration_inverse = 0;
+  block->acceleration_inverse_shift = 0;
+  if (block->acceleration_st == 0) {
+    return;  // acceleration was 0, all distances are 0
+  }
+  int exponent;
+  unsigned long mantissa = lround(frexp(0.5 / block->acceleration_st, &exponent) * 65536.0);
+  if (mantissa > 0xffff) { // rounded up to 1.0
+    mantissa >>= 1;
+    exponent++;
+  }
+  block->acceleration_inverse = mantissa;
+  block->acceleration_inverse_shift = 16 - exponent;
+}
 
-void calculate_trapezoid_for_block(block_t *block, float entry_factor, float exit_factor) {
-  unsigned long initial_rate = ceil(block->nominal_rate*entry_factor); // (step/min)
-  unsigned long final_rate = ceil(block->nominal_rate*exit_factor); // (step/min)
+// Integer version of estimate_acceleration_distance() with the block's acceleration,
+// rounded up or down. The result is within a step or so of the float one.
+static long acceleration_steps(block_t *block, unsigned long initial_rate, unsigned long target_rate, bool round_up)
+{
+  if (target_rate < initial_rate) {
+    return -acceleration_steps(block, target_rate, initial_rate, !round_up);
+  }
+  int shift = block->acceleration_inverse_shift;
+  // target_rate^2 - initial_rate^2 as (target_rate + initial_rate) * (target_rate - initial_rate),
+  // each factor cut to its top 16 bits, and the product cut to 16 bits for the last multiplication
+  unsigned long sum = target_rate + initial_rate;
+  unsigned long difference = target_rate - initial_rate;
+  while (sum > 0xffff) {
+    sum >>= 1;
+    shift--;
+  }
+  while (difference > 0xffff) {
+    difference >>= 1;
+    shift--;
+  }
+  unsigned long delta = (unsigned long)(unsigned int)sum * (unsigned int)difference;
+  if (delta > 0xffffff) {
+    delta >>= 8;
+    shift -= 8;
+  }
+  while (delta > 0xffff) {
+    delta >>= 1;
+    shift--;
+  }
+  unsigned long product = (unsigned long)(unsigned int)delta * block->acceleration_inverse;
+  if (shift <= 0) {
+    if (-shift < 16 && product <= (0x3fffffffUL >> -shift)) {
+      return product << -shift;
+    }
+    return 0x3fffffffL;  // more than any block can have
+  }
+  if (shift >= 32) {
+    return (round_up && product) ? 1 : 0;
+  }
+  unsigned long steps = product >> shift;
+  if (round_up && (product & ((1UL << shift) - 1))) {
+    steps++;
+  }
+  return steps;
+}
+#endif // PLANNER_FIXED_POINT
+
+#ifdef S_CURVE_ACCELERATION
+// 2^31/jerk ticks of a ramp, for the stepper to scale the acceleration with while it changes
+static unsigned long s_curve_jerk_inverse(unsigned long ramp_ticks)
+{
+  unsigned long jerk_ticks = S_CURVE_JERK_TICKS(ramp_ticks);
+  return jerk_ticks ? 0x80000000UL / jerk_ticks : 0;
+}
+#endif // S_CURVE_ACCELERATION
+
+// Calculates trapezoid parameters so that the entry- and exit-speed is compensated by the provided factors.
+// The block gets nominal_rate along with them. Returns false and leaves it alone if it is busy.
+static bool calculate_trapezoid_for_rate(block_t *block, unsigned long nominal_rate, float entry_factor, float exit_factor) {
+  unsigned long initial_rate = ceil(nominal_rate*entry_factor); // (step/min)
+  unsigned long final_rate = ceil(nominal_rate*exit_factor); // (step/min)
 
   // Limit minimal step rate (Otherwise the timer will overflow.)
   if(initial_rate <120) {
@@ -175,11 +294,16 @@ void calculate_trapezoid_for_block(block_t *block, float entry_factor, float exi
     final_rate=120;  
   }
 
+#ifdef PLANNER_FIXED_POINT
+  int32_t accelerate_steps = acceleration_steps(block, initial_rate, nominal_rate, true);
+  int32_t decelerate_steps = acceleration_steps(block, final_rate, nominal_rate, false);
+#else
   long acceleration = block->acceleration_st;
   int32_t accelerate_steps =
-    ceil(estimate_acceleration_distance(block->initial_rate, block->nominal_rate, acceleration));
+    ceil(estimate_acceleration_distance(initial_rate, nominal_rate, acceleration));
   int32_t decelerate_steps =
-    floor(estimate_acceleration_distance(block->nominal_rate, block->final_rate, -acceleration));
+    floor(estimate_acceleration_distance(nominal_rate, final_rate, -acceleration));
+#endif
 
   // Calculate the size of Plateau of Nominal Rate.
   int32_t plateau_steps = block->step_event_count-accelerate_steps-decelerate_steps;
@@ -188,12 +312,34 @@ void calculate_trapezoid_for_block(block_t *block, float entry_factor, float exi
   // have to use intersection_distance() to calculate when to abort acceleration and start braking
   // in order to reach the final_rate exactly at the end of this block.
   if (plateau_steps < 0) {
-    accelerate_steps = ceil(intersection_distance(block->initial_rate, block->final_rate, acceleration, block->step_event_count));
+#ifdef PLANNER_FIXED_POINT
+    // intersection_distance() is half way plus half the distance to get from initial_rate to final_rate
+    int32_t twice_steps = block->step_event_count + acceleration_steps(block, initial_rate, final_rate, true);
+    accelerate_steps = (twice_steps + 1) / 2;
+#else
+    accelerate_steps = ceil(intersection_distance(initial_rate, final_rate, acceleration, block->step_event_count));
+#endif
     accelerate_steps = max(accelerate_steps,0); // Check limits due to numerical round-off
     accelerate_steps = min((uint32_t)accelerate_steps,block->step_event_count);//(We can cast here to unsigned, because the above line ensures that we are above zero)
     plateau_steps = 0;
   }
 
+#ifdef S_CURVE_ACCELERATION
+  // Ramp lengths in timer ticks, from the rate reached at the end of the acceleration
+  unsigned long acceleration_ticks = 0, deceleration_ticks = 0;
+  if (block->acceleration_st != 0) {
+    float peak_rate = nominal_rate;
+    if (plateau_steps == 0) {
+      peak_rate = min(peak_rate, sqrt(sq((float)initial_rate) + 2.0 * block->acceleration_st * accelerate_steps));
+    }
+    float ticks_per_rate = (float)STEPPER_TIMER_RATE / block->acceleration_st;
+    acceleration_ticks = min(max(peak_rate - initial_rate, 0) * ticks_per_rate, 0xffffff);
+    deceleration_ticks = min(max(peak_rate - final_rate, 0) * ticks_per_rate, 0xffffff);
+  }
+  unsigned long acceleration_jerk_inverse = s_curve_jerk_inverse(acceleration_ticks);
+  unsigned long deceleration_jerk_inverse = s_curve_jerk_inverse(deceleration_ticks);
+#endif // S_CURVE_ACCELERATION
+
 #ifdef ADVANCE
   volatile long initial_advance = block->advance*entry_factor*entry_factor; 
   volatile long final_advance = block->advance*exit_factor*exit_factor;
@@ -202,25 +348,66 @@ void calculate_trapezoid_for_block(block_t *block, float entry_factor, float exi
   // block->accelerate_until = accelerate_steps;
   // block->decelerate_after = accelerate_steps+plateau_steps;
   CRITICAL_SECTION_START;  // Fill variables used by the stepper in a critical section
-  if(block->busy == false) { // Don't update variables if block is busy.
+  bool busy = block->busy;
+  if(busy == false) { // Don't update variables if block is busy.
+    block->nominal_rate = nominal_rate;
     block->accelerate_until = accelerate_steps;
     block->decelerate_after = accelerate_steps+plateau_steps;
     block->initial_rate = initial_rate;
     block->final_rate = final_rate;
+#ifdef S_CURVE_ACCELERATION
+    block->acceleration_ticks = acceleration_ticks;
+    block->deceleration_ticks = deceleration_ticks;
+    block->acceleration_jerk_inverse = acceleration_jerk_inverse;
+    block->deceleration_jerk_inverse = deceleration_jerk_inverse;
+#endif
 #ifdef ADVANCE
     block->initial_advance = initial_advance;
     block->final_advance = final_advance;
 #endif //ADVANCE
   }
   CRITICAL_SECTION_END;
-}                    
+  return !busy;
+}
+
+void calculate_trapezoid_for_block(block_t *block, float entry_factor, float exit_factor) {
+  calculate_trapezoid_for_rate(block, block->nominal_rate, entry_factor, exit_factor);
+}
+
+// Works out how the block the stepper interrupt is on slows down from step_rate to a stop, for
+// st_stop() to give it with plan_stop_block(). Returns false when the block has no acceleration.
+// The floats are done here, with the interrupt on.
+bool calculate_stop_for_block(block_t *block, unsigned long step_rate, block_stop_t &stop) {
+  if (block->acceleration_st == 0) {
+    return false;
+  }
+  // The lowest rate, like in calculate_trapezoid_for_block()
+  if (step_rate < 120) {
+    step_rate = 120;
+  }
+  stop.step_rate = step_rate;
+  stop.step_events = ceil((sq((float)step_rate) - sq(120.0)) / (2.0 * block->acceleration_st));
+#ifdef S_CURVE_ACCELERATION
+  stop.deceleration_ticks = min((float)(step_rate - 120) * STEPPER_TIMER_RATE / block->acceleration_st, 0xffffff);
+  stop.deceleration_jerk_inverse = s_curve_jerk_inverse(stop.deceleration_ticks);
+#endif
+  return true;
+}
 
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the 
-// acceleration within the allotted distance.
-FORCE_INLINE float max_allowable_speed(float acceleration, float target_velocity, float distance) {
-  return  sqrt(target_velocity*target_velocity-2*acceleration*distance);
+// acceleration within the allotted distance. delta_speed_sqr is 2*acceleration*distance.
+FORCE_INLINE float max_allowable_speed(float delta_speed_sqr, float target_velocity) {
+  return  sqrt(target_velocity*target_velocity+delta_speed_sqr);
 }
 
+#ifdef PLANNER_FIXED_POINT
+// Square of max_allowable_speed(). The passes compare squares and only take the root when the
+// allowable speed is the limit.
+FORCE_INLINE float max_allowable_speed_sqr(float delta_speed_sqr, float target_velocity) {
+  return target_velocity*target_velocity+delta_speed_sqr;
+}
+#endif
+
 // "Junction jerk" in this context is the immediate change in speed at the junction of two blocks.
 // This method will calculate the junction jerk as the euclidean distance between the nominal 
 // velocities of the respective blocks.
@@ -245,8 +432,18 @@ void planner_reverse_pass_kernel(block_t *previous, block_t *current, block_t *n
       // If nominal length true, max junction speed is guaranteed to be reached. Only compute
       // for max allowable speed if block is decelerating and nominal length is false.
       if ((!current->nominal_length_flag) && (current->max_entry_speed > next->entry_speed)) {
+#ifdef PLANNER_FIXED_POINT
+        float v_allowable_sqr = max_allowable_speed_sqr(current->delta_speed_sqr,next->entry_speed);
+        if (v_allowable_sqr < sq(current->max_entry_speed)) {
+          current->entry_speed = sqrt(v_allowable_sqr);
+        }
+        else {
+          current->entry_speed = current->max_entry_speed;
+        }
+#else
         current->entry_speed = min( current->max_entry_speed,
-        max_allowable_speed(-current->acceleration,next->entry_speed,current->millimeters));
+        max_allowable_speed(current->delta_speed_sqr,next->entry_speed));
+#endif
       } 
       else {
         current->entry_speed = current->max_entry_speed;
@@ -258,20 +455,15 @@ void planner_reverse_pass_kernel(block_t *previous, block_t *current, block_t *n
 }
 
 // planner_recalculate() needs to go over the current plan twice. Once in reverse and once forward. This 
-// implements the reverse pass.
-void planner_reverse_pass() {
+// implements the reverse pass. It stops at the planned block, the blocks up to there cannot change.
+void planner_reverse_pass(unsigned char planned) {
   uint8_t block_index = block_buffer_head;
   
-  //Make a local copy of block_buffer_tail, because the interrupt can alter it
-  CRITICAL_SECTION_START;
-  unsigned char tail = block_buffer_tail;
-  CRITICAL_SECTION_END
-  
-  if(((block_buffer_head-tail + BLOCK_BUFFER_SIZE) & (BLOCK_BUFFER_SIZE - 1)) > 3) {
+  if(((block_buffer_head-planned + BLOCK_BUFFER_SIZE) & (BLOCK_BUFFER_SIZE - 1)) > 3) {
     block_index = (block_buffer_head - 3) & (BLOCK_BUFFER_SIZE - 1);
     block_t *block[3] = { 
       NULL, NULL, NULL         };
-    while(block_index != tail) { 
+    while(block_index != planned) { 
       block_index = prev_block_index(block_index); 
       block[2]= block[1];
       block[1]= block[0];
@@ -282,9 +474,11 @@ void planner_reverse_pass() {
 }
 
 // The kernel called by planner_recalculate() when scanning the plan from first to last entry.
-void planner_forward_pass_kernel(block_t *previous, block_t *current, block_t *next) {
+// Returns true when the entry speed of current is at its maximum or limited by the acceleration
+// from previous. Either way it is final once all the blocks before it are.
+bool planner_forward_pass_kernel(block_t *previous, block_t *current, block_t *next) {
   if(!previous) { 
-    return; 
+    return false; 
   }
 
   // If the previous block is an acceleration block, but it is not long enough to complete the
@@ -293,30 +487,54 @@ void planner_forward_pass_kernel(block_t *previous, block_t *current, block_t *n
   // If nominal length is true, max junction speed is guaranteed to be reached. No need to recheck.
   if (!previous->nominal_length_flag) {
     if (previous->entry_speed < current->entry_speed) {
-      double entry_speed = min( current->entry_speed,
-      max_allowable_speed(-previous->acceleration,previous->entry_speed,previous->millimeters) );
+#ifdef PLANNER_FIXED_POINT
+      float v_allowable_sqr = max_allowable_speed_sqr(previous->delta_speed_sqr,previous->entry_speed);
+      if (v_allowable_sqr <= sq(current->entry_speed)) {
+        float entry_speed = sqrt(v_allowable_sqr);
+        if (entry_speed < current->entry_speed) {
+          current->entry_speed = entry_speed;
+          current->recalculate_flag = true;
+        }
+        return true;
+      }
+#else
+      double v_allowable = max_allowable_speed(previous->delta_speed_sqr,previous->entry_speed);
+      double entry_speed = min( current->entry_speed, v_allowable );
 
       // Check for junction speed change
       if (current->entry_speed != entry_speed) {
         current->entry_speed = entry_speed;
         current->recalculate_flag = true;
       }
+      if (entry_speed == v_allowable) {
+        return true;
+      }
+#endif
     }
   }
+  return (current->entry_speed == current->max_entry_speed);
 }
 
 // planner_recalculate() needs to go over the current plan twice. Once in reverse and once forward. This 
-// implements the forward pass.
-void planner_forward_pass() {
-  uint8_t block_index = block_buffer_tail;
+// implements the forward pass, which also moves block_buffer_planned up to the last final block.
+void planner_forward_pass(unsigned char planned) {
+  uint8_t block_index = planned;
   block_t *block[3] = { 
     NULL, NULL, NULL   };
+  // The newest blocks are left out of the reverse pass and may still change when blocks are added
+  uint8_t reverse_end = (block_buffer_head - 4) & (BLOCK_BUFFER_SIZE - 1);
+  bool reverse_planned = ((block_buffer_head-planned + BLOCK_BUFFER_SIZE) & (BLOCK_BUFFER_SIZE - 1)) > 4;
 
   while(block_index != block_buffer_head) {
     block[0] = block[1];
     block[1] = block[2];
     block[2] = &block_buffer[block_index];
-    planner_forward_pass_kernel(block[0],block[1],block[2]);
+    if (planner_forward_pass_kernel(block[0],block[1],block[2]) && reverse_planned) {
+      block_buffer_planned = prev_block_index(block_index);
+    }
+    if (block_index == reverse_end) {
+      reverse_planned = false;
+    }
     block_index = next_block_index(block_index);
   }
   planner_forward_pass_kernel(block[1], block[2], NULL);
@@ -324,9 +542,9 @@ void planner_forward_pass() {
 
 // Recalculates the trapezoid speed profiles for all blocks in the plan according to the 
 // entry_factor for each junction. Must be called by planner_recalculate() after 
-// updating the blocks.
-void planner_recalculate_trapezoids() {
-  int8_t block_index = block_buffer_tail;
+// updating the blocks. Blocks before the planned block do not change, so it starts there.
+void planner_recalculate_trapezoids(unsigned char planned) {
+  int8_t block_index = planned;
   block_t *current;
   block_t *next = NULL;
 
@@ -368,22 +586,282 @@ void planner_recalculate_trapezoids() {
 // the set limit. Finally it will:
 //
 //   3. Recalculate trapezoids for all blocks.
+//
+// Entry speeds only go up as blocks are added, until a block runs at its maximum entry speed or
+// at the speed it can accelerate to from the block before it. From then on it cannot change,
+// and neither can the blocks before it. block_buffer_planned marks the last such block and all
+// three steps start there instead of at the tail, so a full buffer costs a few blocks per call.
 
 void planner_recalculate() {   
-  planner_reverse_pass();
-  planner_forward_pass();
-  planner_recalculate_trapezoids();
+#ifdef STEP_SEGMENT_BUFFER
+  // The block being cut into step segments is the one that can no longer change
+  unsigned char tail = block_buffer_prepared;
+#else
+  //Make a local copy of block_buffer_tail, because the interrupt can alter it
+  CRITICAL_SECTION_START;
+  unsigned char tail = block_buffer_tail;
+  CRITICAL_SECTION_END
+#endif
+
+  // Once the stepper interrupt has taken the planned block off the buffer, the block it is
+  // working on (the tail) is the last one that cannot change.
+  if (((block_buffer_planned - block_buffer_planned_tail) & (BLOCK_BUFFER_SIZE - 1)) <
+      ((tail - block_buffer_planned_tail) & (BLOCK_BUFFER_SIZE - 1))) {
+    block_buffer_planned = tail;
+  }
+  block_buffer_planned_tail = tail;
+
+  unsigned char planned = block_buffer_planned;
+  planner_reverse_pass(planned);
+  planner_forward_pass(planned);
+  planner_recalculate_trapezoids(planned);
+}
+
+// Cuts the plan short for st_stop(). The blocks before first can no longer change and run out at
+// speed. Of the blocks from first on it keeps the ones it takes to slow down from speed and replans
+// them to end at a stop, the rest are discarded. With the stepper interrupt on: when it takes a
+// block before its trapezoid is written it runs the old one, and the blocks after it are planned
+// again from the speed that one ends at, the same as plan_apply_feed_multiply() does.
+void plan_stop(unsigned char first, float speed) {
+  unsigned char head = block_buffer_head;
+  unsigned char cut = head;
+  for (;;) {
+    float speed_sqr = sq(speed) - sq(MINIMUM_PLANNER_SPEED);
+    unsigned char stop_index = first;
+    while (stop_index != head && speed_sqr > 0) {
+      speed_sqr -= block_buffer[stop_index].delta_speed_sqr;
+      stop_index = next_block_index(stop_index);
+    }
+
+    // The interrupt takes the blocks in order, as long as it has not taken first it has none of
+    // the ones discarded
+    CRITICAL_SECTION_START;
+    bool busy = first != head && block_buffer[first].busy;
+    if (!busy) {
+      block_buffer_head = stop_index;
+    }
+    CRITICAL_SECTION_END;
+    if (busy) {
+      block_t *block = &block_buffer[first];
+      speed = block->nominal_speed * block->final_rate / block->nominal_rate;
+      first = next_block_index(first);
+      if (first != head) {
+        block_buffer[first].entry_speed = speed;
+      }
+      continue;
+    }
+#ifdef SLOWDOWN
+    // The discarded blocks never get to the tail, the ones kept again after a replan do
+    if (((stop_index - first) & (BLOCK_BUFFER_SIZE - 1)) < ((cut - first) & (BLOCK_BUFFER_SIZE - 1))) {
+      for (unsigned char i = stop_index; i != cut; i = next_block_index(i)) {
+        block_buffer_time -= block_buffer[i].planned_time;
+      }
+    }
+    else {
+      for (unsigned char i = cut; i != stop_index; i = next_block_index(i)) {
+        block_buffer_time += block_buffer[i].planned_time;
+      }
+    }
+#endif
+    cut = stop_index;
+
+    // Reverse pass from the stop. The entry speed of first was set by the blocks before it, the
+    // blocks kept can slow down from it.
+    float exit_speed = MINIMUM_PLANNER_SPEED;
+    unsigned char block_index = stop_index;
+    while (block_index != first) {
+      block_index = prev_block_index(block_index);
+      block_t *block = &block_buffer[block_index];
+      if (block_index != first) {
+        block->entry_speed = min(block->entry_speed, max_allowable_speed(block->delta_speed_sqr, exit_speed));
+      }
+      exit_speed = block->entry_speed;
+    }
+
+    // Trapezoids, in the order the interrupt takes the blocks
+    while (block_index != stop_index && !busy) {
+      block_t *block = &block_buffer[block_index];
+      block_index = next_block_index(block_index);
+      exit_speed = block_index != stop_index ? block_buffer[block_index].entry_speed : MINIMUM_PLANNER_SPEED;
+      busy = !calculate_trapezoid_for_rate(block, block->nominal_rate,
+        block->entry_speed/block->nominal_speed, exit_speed/block->nominal_speed);
+      block->recalculate_flag = false;
+      if (busy) {
+        speed = block->nominal_speed * block->final_rate / block->nominal_rate;
+      }
+    }
+    if (!busy) {
+      break;
+    }
+    first = block_index;
+    if (first != head) {
+      block_buffer[first].entry_speed = speed;
+    }
+  }
+  block_buffer_planned = first;
 }
 
+#ifdef SPEED_OVERRIDE_REPLAN
+// Length of the block in the units plan_buffer_line() planned it in, from delta_speed_sqr and
+// acceleration_st, which both have it.
+static float block_millimeters(block_t *block) {
+  return sqrt(block->delta_speed_sqr * block->step_event_count / (2.0 * block->acceleration_st));
+}
+
+// Gives the blocks in the buffer the speed feedmultiply asks for. The block the stepper is on keeps
+// its trapezoid, the one after it its entry speed. From there the nominal speeds are the ones
+// plan_buffer_line() would have set and the blocks are replanned to them, the same as the passes
+// of planner_recalculate() do, except that a block also has to enter at least as fast as the one
+// before it can slow down to. The change starts with the next block and takes as many more as the
+// acceleration needs.
+void plan_apply_feed_multiply() {
+  if (feedmultiply <= 0) {
+    return;
+  }
+#ifdef STEP_SEGMENT_BUFFER
+  unsigned char first = block_buffer_prepared;
+#else
+  CRITICAL_SECTION_START;
+  unsigned char first = block_buffer_tail;
+  CRITICAL_SECTION_END
+#endif
+  if (first != block_buffer_head && block_buffer[first].busy) {
+    first = next_block_index(first);
+  }
+  if (first == block_buffer_head) {
+    return;
+  }
+
+  // New nominal speeds, within the axis limits
+  for (unsigned char block_index = first; block_index != block_buffer_head; block_index = next_block_index(block_index)) {
+    block_t *block = &block_buffer[block_index];
+    if (block->acceleration_st == 0) {
+      continue;
+    }
+    float millimeters = block_millimeters(block);
+    float nominal_speed = block->feed_speed * feedmultiply / 100;
+    long steps[4] = { block->steps_x, block->steps_y, block->steps_z, block->steps_e };
+    for (unsigned char i = 0; i < 4; i++) {
+      if (steps[i] != 0) {
+        nominal_speed = min(nominal_speed, max_feedrate[i] * axis_steps_per_unit[i] * millimeters / steps[i]);
+      }
+    }
+#ifdef S_CURVE_ACCELERATION
+    nominal_speed = min(nominal_speed, (float)MAX_STEP_FREQUENCY * millimeters / block->step_event_count);
+#endif
+#ifdef ADVANCE
+    block->advance *= sq(nominal_speed / block->nominal_speed);
+#endif
+#ifdef SLOWDOWN
+    unsigned long planned_time = lround(1000000.0 * millimeters / nominal_speed);
+    block_buffer_time += planned_time - block->planned_time;
+    block->planned_time = planned_time;
+#endif
+    block->nominal_speed = nominal_speed;
+  }
+
+  // The next block joins the last one at its new speed
+  block_t *last = &block_buffer[prev_block_index(block_buffer_head)];
+  if (previous_nominal_speed > 0.0) {
+    float factor = last->nominal_speed / previous_nominal_speed;
+    for (unsigned char i = 0; i < 4; i++) {
+      previous_speed[i] *= factor;
+    }
+    previous_nominal_speed = last->nominal_speed;
+  }
+
+  // Junction limits from the new nominal speeds
+  for (unsigned char block_index = next_block_index(first); block_index != block_buffer_head; block_index = next_block_index(block_index)) {
+    block_t *block = &block_buffer[block_index];
+    block->max_entry_speed = min(block->max_junction_speed,
+      min(block_buffer[prev_block_index(block_index)].nominal_speed, block->nominal_speed));
+    block->nominal_length_flag = block->nominal_speed <= max_allowable_speed(block->delta_speed_sqr, MINIMUM_PLANNER_SPEED);
+  }
+
+  for (;;) {
+    // Reverse pass, to a stop at the end of the buffer
+    float exit_speed = MINIMUM_PLANNER_SPEED;
+    unsigned char block_index = block_buffer_head;
+    while (block_index != first) {
+      block_index = prev_block_index(block_index);
+      block_t *block = &block_buffer[block_index];
+      if (block_index != first) {
+        block->entry_speed = min(block->max_entry_speed, max_allowable_speed(block->delta_speed_sqr, exit_speed));
+      }
+      exit_speed = block->entry_speed;
+    }
+
+    // Forward pass. A block that enters at the lowest speed the one before it can slow down to
+    // is final, so are the ones before it.
+    unsigned char planned = first;
+    block_t *previous = NULL;
+    for (block_index = first; block_index != block_buffer_head; block_index = next_block_index(block_index)) {
+      block_t *block = &block_buffer[block_index];
+      if (previous) {
+        float entry_speed = min(block->entry_speed, max_allowable_speed(previous->delta_speed_sqr, previous->entry_speed));
+        float lowest_speed_sqr = sq(previous->entry_speed) - previous->delta_speed_sqr;
+        if (sq(entry_speed) < lowest_speed_sqr) {
+          entry_speed = sqrt(lowest_speed_sqr);
+          planned = block_index;
+        }
+        block->entry_speed = entry_speed;
+      }
+      // Still slowing down to a lower speed, the block cruises at the speed it enters with
+      block->nominal_speed = max(block->nominal_speed, block->entry_speed);
+      previous = block;
+    }
+    block_buffer_planned = planned;
+
+    // Trapezoids. When the stepper interrupt takes a block before its trapezoid is written it runs
+    // the old one, the blocks after it are planned again from the speed that one ends at.
+    bool busy = false;
+    block_index = first;
+    while (block_index != block_buffer_head && !busy) {
+      block_t *block = &block_buffer[block_index];
+      block_index = next_block_index(block_index);
+      exit_speed = block_index != block_buffer_head ? block_buffer[block_index].entry_speed : MINIMUM_PLANNER_SPEED;
+      if (block->acceleration_st == 0) {
+        calculate_trapezoid_for_block(block, block->entry_speed/block->nominal_speed, exit_speed/block->nominal_speed);
+        busy = block->busy;
+      }
+      else {
+        float millimeters = block_millimeters(block);
+        unsigned long nominal_rate = ceil(block->nominal_speed * block->step_event_count / millimeters);
+        busy = !calculate_trapezoid_for_rate(block, nominal_rate,
+          block->entry_speed/block->nominal_speed, exit_speed/block->nominal_speed);
+        if (busy && block_index != block_buffer_head) {
+          block_buffer[block_index].entry_speed = block->final_rate * millimeters / block->step_event_count;
+        }
+      }
+      block->recalculate_flag = false;
+    }
+    if (!busy || block_index == block_buffer_head) {
+      break;
+    }
+    first = block_index;
+  }
+}
+#endif // SPEED_OVERRIDE_REPLAN
+
 void plan_init() {
   block_buffer_head = 0;
   block_buffer_tail = 0;
+  block_buffer_planned = 0;
+  block_buffer_planned_tail = 0;
+#ifdef STEP_SEGMENT_BUFFER
+  block_buffer_prepared = 0;
+#endif
   memset(position, 0, sizeof(position)); // clear position
   previous_speed[0] = 0.0;
   previous_speed[1] = 0.0;
   previous_speed[2] = 0.0;
   previous_speed[3] = 0.0;
   previous_nominal_speed = 0.0;
+  memset(previous_unit_vec, 0, sizeof(previous_unit_vec));
+#ifdef SLOWDOWN
+  block_buffer_time = 0;
+  block_buffer_time_tail = 0;
+#endif
 }
 
 
@@ -491,24 +969,24 @@ void check_axes_activity()
 }
 
 
-float junction_deviation = 0.1;
 // Add a new linear movement to the buffer. steps_x, _y and _z is the absolute position in 
 // mm. Microseconds specify how many microseconds the move should take to perform. To aid acceleration
 // calculation the caller must also provide the physical length of the line in millimeters.
-void plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder)
+void plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder, const float &cartesian_mm)
 {
-  // Calculate the buffer head after we push this byte
-  int next_buffer_head = next_block_index(block_buffer_head);
-
   // If the buffer is full: good! That means we are well ahead of the robot. 
   // Rest here until there is room in the buffer.
-  while(block_buffer_tail == next_buffer_head)
+  while(plan_buffer_full())
   {
     manage_heater(); 
     manage_inactivity(); 
     lcd_update();
   }
 
+  // Calculate the buffer head after we push this byte. Only after the wait, the LCD can stop the
+  // moves meanwhile and st_stop() takes the head back.
+  int next_buffer_head = next_block_index(block_buffer_head);
+
   // The target position of the tool in absolute steps
   // Calculate target position in absolute steps
   //this should be done after the wait, because otherwise a M92 code within the gcode disrupts this calculation somehow
@@ -557,6 +1035,8 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
   // Bail if this is a zero-length block
   if (block->step_event_count <= dropsegments)
   { 
+    // The next block starts from the same position, so it also covers this segment's tool distance
+    dropped_cartesian_mm += cartesian_mm;
     return; 
   }
 
@@ -612,20 +1092,32 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
   delta_mm[Y_AXIS] = (target[Y_AXIS]-position[Y_AXIS])/axis_steps_per_unit[Y_AXIS];
   delta_mm[Z_AXIS] = (target[Z_AXIS]-position[Z_AXIS])/axis_steps_per_unit[Z_AXIS];
   delta_mm[E_AXIS] = ((target[E_AXIS]-position[E_AXIS])/axis_steps_per_unit[E_AXIS])*extrudemultiply/100.0;
+  float millimeters;
+  float inverse_joint_millimeters = 0.0;
   if ( block->steps_x <=dropsegments && block->steps_y <=dropsegments && block->steps_z <=dropsegments )
   {
-    block->millimeters = fabs(delta_mm[E_AXIS]);
+    millimeters = fabs(delta_mm[E_AXIS]);
   } 
   else
   {
-    block->millimeters = sqrt(square(delta_mm[X_AXIS]) + square(delta_mm[Y_AXIS]) + square(delta_mm[Z_AXIS]));
+    millimeters = sqrt(square(delta_mm[X_AXIS]) + square(delta_mm[Y_AXIS]) + square(delta_mm[Z_AXIS]));
+    inverse_joint_millimeters = 1.0/millimeters;
+    // The joints of a kinematics segment move in proportion, so joint distance over tool distance is
+    // the Jacobian along the segment. Planning with the tool distance applies feed rate, acceleration
+    // and the junction speeds to the tool, while the per axis limits below stay in joint units.
+    if (cartesian_mm > 0.0)
+      millimeters = cartesian_mm + dropped_cartesian_mm;
   }
-  float inverse_millimeters = 1.0/block->millimeters;  // Inverse millimeters to remove multiple divides 
+  dropped_cartesian_mm = 0.0;
+  float inverse_millimeters = 1.0/millimeters;  // Inverse millimeters to remove multiple divides 
 
     // Calculate speed in mm/second for each axis. No divide by zero due to previous checks.
   float inverse_second = feed_rate * inverse_millimeters;
 
   int moves_queued=(block_buffer_head-block_buffer_tail + BLOCK_BUFFER_SIZE) & (BLOCK_BUFFER_SIZE - 1);
+#ifdef MOTION_STATS
+  motion_stats.occupancy[moves_queued * MOTION_STATS_BUCKETS / BLOCK_BUFFER_SIZE]++;
+#endif
 
   // slow down when de buffer starts to empty, rather than wait at the corner for a buffer refill
 #ifdef OLD_SLOWDOWN
@@ -634,24 +1126,20 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
 #endif
 
 #ifdef SLOWDOWN
+  planner_queued_time(); // Keep the finished blocks accounted for, see plan_slowdown_factor()
+#endif
+#ifdef XY_FREQUENCY_LIMIT
   //  segment time im micro seconds
   unsigned long segment_time = lround(1000000.0/inverse_second);
-  if ((moves_queued > 1) && (moves_queued < (BLOCK_BUFFER_SIZE * 0.5)))
-  {
-    if (segment_time < minsegmenttime)
-    { // buffer is draining, add extra time.  The amount of time added increases if the buffer is still emptied more.
-      inverse_second=1000000.0/(segment_time+lround(2*(minsegmenttime-segment_time)/moves_queued));
-      #ifdef XY_FREQUENCY_LIMIT
-         segment_time = lround(1000000.0/inverse_second);
-      #endif
-    }
-  }
 #endif
   //  END OF SLOW DOWN SECTION    
 
 
-  block->nominal_speed = block->millimeters * inverse_second; // (mm/sec) Always > 0
+  block->nominal_speed = millimeters * inverse_second; // (mm/sec) Always > 0
   block->nominal_rate = ceil(block->step_event_count * inverse_second); // (step/sec) Always > 0
+#ifdef SPEED_OVERRIDE_REPLAN
+  block->feed_speed = block->nominal_speed * 100 / max(feedmultiply, 1);
+#endif
 
   // Calculate and limit speed in mm/sec for each axis
   float current_speed[4];
@@ -662,6 +1150,11 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
     if(fabs(current_speed[i]) > max_feedrate[i])
       speed_factor = min(speed_factor, max_feedrate[i] / fabs(current_speed[i]));
   }
+#ifdef S_CURVE_ACCELERATION
+  // The S-curve ramps only come out right at step rates the stepper can actually run
+  if(block->nominal_rate > MAX_STEP_FREQUENCY)
+    speed_factor = min(speed_factor, (float)MAX_STEP_FREQUENCY / block->nominal_rate);
+#endif
 
   // Max segement time in us.
 #ifdef XY_FREQUENCY_LIMIT
@@ -708,9 +1201,13 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
     block->nominal_speed *= speed_factor;
     block->nominal_rate *= speed_factor;
   }
+#ifdef SLOWDOWN
+  block->planned_time = lround(1000000.0 / (inverse_second * speed_factor));
+  block_buffer_time += block->planned_time;
+#endif
 
   // Compute and limit the acceleration rate for the trapezoid generator.  
-  float steps_per_mm = block->step_event_count/block->millimeters;
+  float steps_per_mm = block->step_event_count/millimeters;
   if(block->steps_x == 0 && block->steps_y == 0 && block->steps_z == 0)
   {
     block->acceleration_st = ceil(retract_acceleration * steps_per_mm); // convert to: acceleration steps/sec^2
@@ -728,49 +1225,28 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
     if(((float)block->acceleration_st * (float)block->steps_z / (float)block->step_event_count ) > axis_steps_per_sqr_second[Z_AXIS])
       block->acceleration_st = axis_steps_per_sqr_second[Z_AXIS];
   }
-  block->acceleration = block->acceleration_st / steps_per_mm;
-  block->acceleration_rate = (long)((float)block->acceleration_st * 8.388608);
-
-#if 0  // Use old jerk for now
-  // Compute path unit vector
-  double unit_vec[3];
-
-  unit_vec[X_AXIS] = delta_mm[X_AXIS]*inverse_millimeters;
-  unit_vec[Y_AXIS] = delta_mm[Y_AXIS]*inverse_millimeters;
-  unit_vec[Z_AXIS] = delta_mm[Z_AXIS]*inverse_millimeters;
-
-  // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
-  // Let a circle be tangent to both previous and current path line segments, where the junction
-  // deviation is defined as the distance from the junction to the closest edge of the circle,
-  // colinear with the circle center. The circular segment joining the two paths represents the
-  // path of centripetal acceleration. Solve for max velocity based on max acceleration about the
-  // radius of the circle, defined indirectly by junction deviation. This may be also viewed as
-  // path width or max_jerk in the previous grbl version. This approach does not actually deviate
-  // from path, but used as a robust way to compute cornering speeds, as it takes into account the
-  // nonlinearities of both the junction angle and junction velocity.
-  double vmax_junction = MINIMUM_PLANNER_SPEED; // Set default max junction speed
-
-  // Skip first block or when previous_nominal_speed is used as a flag for homing and offset cycles.
-  if ((block_buffer_head != block_buffer_tail) && (previous_nominal_speed > 0.0)) {
-    // Compute cosine of angle between previous and current path. (prev_unit_vec is negative)
-    // NOTE: Max junction velocity is computed without sin() or acos() by trig half angle identity.
-    double cos_theta = - previous_unit_vec[X_AXIS] * unit_vec[X_AXIS]
-      - previous_unit_vec[Y_AXIS] * unit_vec[Y_AXIS]
-      - previous_unit_vec[Z_AXIS] * unit_vec[Z_AXIS] ;
-
-    // Skip and use default max junction speed for 0 degree acute junction.
-    if (cos_theta < 0.95) {
-      vmax_junction = min(previous_nominal_speed,block->nominal_speed);
-      // Skip and avoid divide by zero for straight junctions at 180 degrees. Limit to min() of nominal speeds.
-      if (cos_theta > -0.95) {
-        // Compute maximum junction velocity based on maximum acceleration and junction deviation
-        double sin_theta_d2 = sqrt(0.5*(1.0-cos_theta)); // Trig half angle identity. Always positive.
-        vmax_junction = min(vmax_junction,
-        sqrt(block->acceleration * junction_deviation * sin_theta_d2/(1.0-sin_theta_d2)) );
-      }
-    }
-  }
+  float block_acceleration = block->acceleration_st / steps_per_mm;
+  block->delta_speed_sqr = 2*block_acceleration*millimeters;
+#ifdef S_CURVE_ACCELERATION
+  // The stepper ramps keep the planned time and distance, so they peak above the planned acceleration.
+  // Half the peak is stored to keep it within the 24 bits the stepper multiplies with.
+  block->acceleration_rate = (long)((float)block->acceleration_st * (8388608.0 / STEPPER_TIMER_RATE * 256 / (256 - S_CURVE_JERK_SHARE)));
+#else
+  block->acceleration_rate = (long)((float)block->acceleration_st * (16777216.0 / STEPPER_TIMER_RATE));
 #endif
+#ifdef PLANNER_FIXED_POINT
+  calculate_acceleration_inverse(block);
+#endif
+
+  // Compute path unit vector. Extruder only moves have none and always use the jerk limits.
+  float unit_vec[3] = { 0.0, 0.0, 0.0 };
+  if (block->steps_x > dropsegments || block->steps_y > dropsegments || block->steps_z > dropsegments)
+  {
+    unit_vec[X_AXIS] = delta_mm[X_AXIS]*inverse_joint_millimeters;
+    unit_vec[Y_AXIS] = delta_mm[Y_AXIS]*inverse_joint_millimeters;
+    unit_vec[Z_AXIS] = delta_mm[Z_AXIS]*inverse_joint_millimeters;
+  }
+
   // Start with a safe speed
   float vmax_junction = max_xy_jerk/2; 
   float vmax_junction_factor = 1.0; 
@@ -778,29 +1254,86 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
     vmax_junction = min(vmax_junction, max_z_jerk/2);
   if(fabs(current_speed[E_AXIS]) > max_e_jerk/2) 
     vmax_junction = min(vmax_junction, max_e_jerk/2);
+#ifdef SPEED_OVERRIDE_REPLAN
+  // The same limits without the ones the nominal speeds set, for plan_apply_feed_multiply()
+  float junction_speed = vmax_junction;
+#endif
   vmax_junction = min(vmax_junction, block->nominal_speed);
   float safe_speed = vmax_junction;
 
   if ((moves_queued > 1) && (previous_nominal_speed > 0.0001)) {
-    float jerk = sqrt(pow((current_speed[X_AXIS]-previous_speed[X_AXIS]), 2)+pow((current_speed[Y_AXIS]-previous_speed[Y_AXIS]), 2));
-    //    if((fabs(previous_speed[X_AXIS]) > 0.0001) || (fabs(previous_speed[Y_AXIS]) > 0.0001)) {
-    vmax_junction = block->nominal_speed;
-    //    }
-    if (jerk > max_xy_jerk) {
-      vmax_junction_factor = (max_xy_jerk/jerk);
-    } 
-    if(fabs(current_speed[Z_AXIS] - previous_speed[Z_AXIS]) > max_z_jerk) {
-      vmax_junction_factor= min(vmax_junction_factor, (max_z_jerk/fabs(current_speed[Z_AXIS] - previous_speed[Z_AXIS])));
-    } 
+    if (junction_deviation > 0.0 && (unit_vec[X_AXIS] != 0.0 || unit_vec[Y_AXIS] != 0.0 || unit_vec[Z_AXIS] != 0.0)
+      && (previous_unit_vec[X_AXIS] != 0.0 || previous_unit_vec[Y_AXIS] != 0.0 || previous_unit_vec[Z_AXIS] != 0.0)) {
+      // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
+      // Let a circle be tangent to both previous and current path line segments, where the junction
+      // deviation is defined as the distance from the junction to the closest edge of the circle,
+      // colinear with the circle center. The circular segment joining the two paths represents the
+      // path of centripetal acceleration. Solve for max velocity based on max acceleration about the
+      // radius of the circle, defined indirectly by junction deviation. This approach does not actually
+      // deviate from path, but used as a robust way to compute cornering speeds, as it takes into account
+      // the nonlinearities of both the junction angle and junction velocity.
+
+      // Compute cosine of angle between previous and current path. (prev_unit_vec is negative)
+      // NOTE: Max junction velocity is computed without sin() or acos() by trig half angle identity.
+      float cos_theta = - previous_unit_vec[X_AXIS] * unit_vec[X_AXIS]
+        - previous_unit_vec[Y_AXIS] * unit_vec[Y_AXIS]
+        - previous_unit_vec[Z_AXIS] * unit_vec[Z_AXIS] ;
+
+      // Keep the safe speed for a 0 degree acute junction (a reversal).
+      if (cos_theta < 0.95) {
+        vmax_junction = block->nominal_speed;
+#ifdef SPEED_OVERRIDE_REPLAN
+        junction_speed = INFINITY;
+#endif
+        // Skip and avoid divide by zero for straight junctions at 180 degrees.
+        if (cos_theta > -0.95) {
+          // Compute maximum junction velocity based on maximum acceleration and junction deviation
+          float sin_theta_d2 = sqrt(0.5*(1.0-cos_theta)); // Trig half angle identity. Always positive.
+          float deviation_speed = sqrt(block_acceleration * junction_deviation * sin_theta_d2/(1.0-sin_theta_d2));
+          vmax_junction = min(vmax_junction, deviation_speed);
+#ifdef SPEED_OVERRIDE_REPLAN
+          junction_speed = deviation_speed;
+#endif
+        }
+      }
+    }
+    else {
+      float jerk = sqrt(pow((current_speed[X_AXIS]-previous_speed[X_AXIS]), 2)+pow((current_speed[Y_AXIS]-previous_speed[Y_AXIS]), 2));
+      //    if((fabs(previous_speed[X_AXIS]) > 0.0001) || (fabs(previous_speed[Y_AXIS]) > 0.0001)) {
+      vmax_junction = block->nominal_speed;
+      //    }
+      if (jerk > max_xy_jerk) {
+        vmax_junction_factor = (max_xy_jerk/jerk);
+      } 
+      if(fabs(current_speed[Z_AXIS] - previous_speed[Z_AXIS]) > max_z_jerk) {
+        vmax_junction_factor= min(vmax_junction_factor, (max_z_jerk/fabs(current_speed[Z_AXIS] - previous_speed[Z_AXIS])));
+      } 
+#ifdef SPEED_OVERRIDE_REPLAN
+      // The jerk goes with the speed, so the speed it allows does not
+      junction_speed = INFINITY;
+      if (jerk > 0.0)
+        junction_speed = block->nominal_speed * max_xy_jerk / jerk;
+      if (current_speed[Z_AXIS] != previous_speed[Z_AXIS])
+        junction_speed = min(junction_speed, block->nominal_speed * max_z_jerk / fabs(current_speed[Z_AXIS] - previous_speed[Z_AXIS]));
+#endif
+    }
+    // The extruder is not part of the path, its speed change is always limited by the jerk setting
     if(fabs(current_speed[E_AXIS] - previous_speed[E_AXIS]) > max_e_jerk) {
       vmax_junction_factor = min(vmax_junction_factor, (max_e_jerk/fabs(current_speed[E_AXIS] - previous_speed[E_AXIS])));
     } 
+#ifdef SPEED_OVERRIDE_REPLAN
+    if (current_speed[E_AXIS] != previous_speed[E_AXIS])
+      junction_speed = min(junction_speed, block->nominal_speed * max_e_jerk / fabs(current_speed[E_AXIS] - previous_speed[E_AXIS]));
+#endif
     vmax_junction = min(previous_nominal_speed, vmax_junction * vmax_junction_factor); // Limit speed to max previous speed
   }
   block->max_entry_speed = vmax_junction;
+#ifdef SPEED_OVERRIDE_REPLAN
+  block->max_junction_speed = junction_speed;
+#endif
 
   // Initialize block entry speed. Compute based on deceleration to user-defined MINIMUM_PLANNER_SPEED.
-  double v_allowable = max_allowable_speed(-block->acceleration,MINIMUM_PLANNER_SPEED,block->millimeters);
+  double v_allowable = max_allowable_speed(block->delta_speed_sqr,MINIMUM_PLANNER_SPEED);
   block->entry_speed = min(vmax_junction, v_allowable);
 
   // Initialize planner efficiency flags
@@ -822,6 +1355,7 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
   // Update previous path unit_vector and nominal speed
   memcpy(previous_speed, current_speed, sizeof(previous_speed)); // previous_speed[] = current_speed[]
   previous_nominal_speed = block->nominal_speed;
+  memcpy(previous_unit_vec, unit_vec, sizeof(previous_unit_vec)); // previous_unit_vec[] = unit_vec[]
 
 
 #ifdef ADVANCE
@@ -851,6 +1385,16 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
    */
 #endif // ADVANCE
 
+#ifdef LIN_ADVANCE
+  // The extruder runs extruder_advance_k seconds of E ahead of the block, on moves that extrude
+  // while the head moves. The stepper works the lead out for every rate it steps at.
+  block->advance_factor = 0;
+  if(extruder_advance_k > 0.0 && block->steps_e != 0 && (block->steps_x != 0 || block->steps_y != 0) &&
+     (block->direction_bits & (1<<E_AXIS)) == 0) {
+    block->advance_factor = min(extruder_advance_k * block->steps_e / block->step_event_count * 16777216.0, 16777215.0);
+  }
+#endif // LIN_ADVANCE
+
   calculate_trapezoid_for_block(block, block->entry_speed/block->nominal_speed,
   safe_speed/block->nominal_speed);
 
@@ -860,7 +1404,18 @@ void plan_buffer_line(const float &x, const float &y, const float &z, const floa
   // Update position
   memcpy(position, target, sizeof(target)); // position[] = target[]
 
+#ifdef MOTION_STATS
+  unsigned long recalculate_time = micros();
   planner_recalculate();
+  recalculate_time = micros() - recalculate_time;
+  motion_stats.recalculate_count++;
+  motion_stats.recalculate_time += recalculate_time;
+  if (recalculate_time > motion_stats.recalculate_max) {
+    motion_stats.recalculate_max = recalculate_time;
+  }
+#else
+  planner_recalculate();
+#endif
 
   st_wake_up();
 }
@@ -873,6 +1428,7 @@ void plan_set_position(const float &x, const float &y, const float &z, const flo
   position[E_AXIS] = lround(e*axis_steps_per_unit[E_AXIS]);  
   st_set_position(position[X_AXIS], position[Y_AXIS], position[Z_AXIS], position[E_AXIS]);
   previous_nominal_speed = 0.0; // Resets planner junction speeds. Assumes start from rest.
+  dropped_cartesian_mm = 0.0;
   previous_speed[0] = 0.0;
   previous_speed[1] = 0.0;
   previous_speed[2] = 0.0;
@@ -897,4 +1453,47 @@ void allow_cold_extrudes(bool allow)
 #endif
 }
 
+#ifdef MOTION_STATS
+void motion_stats_reset()
+{
+  CRITICAL_SECTION_START;
+  memset(&motion_stats, 0, sizeof(motion_stats));
+  CRITICAL_SECTION_END;
+}
+
+void motion_stats_report()
+{
+  CRITICAL_SECTION_START;
+  unsigned long buffer_empty = motion_stats.buffer_empty;
+  unsigned int isr_max = motion_stats.isr_max;
+  CRITICAL_SECTION_END;
+
+  SERIAL_ECHO_START;
+  SERIAL_ECHOPGM("Buffer ran empty:");
+  SERIAL_ECHOLN(buffer_empty);
+  SERIAL_ECHO_START;
+  SERIAL_ECHOPGM("Blocks queued when adding, by ");
+  SERIAL_ECHO(BLOCK_BUFFER_SIZE / MOTION_STATS_BUCKETS);
+  SERIAL_ECHOPGM(":");
+  for (uint8_t i = 0; i < MOTION_STATS_BUCKETS; i++) {
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO(motion_stats.occupancy[i]);
+  }
+  SERIAL_ECHOLN("");
+  SERIAL_ECHO_START;
+  SERIAL_ECHOPGM("Recalculate us: avg ");
+  SERIAL_ECHO(motion_stats.recalculate_count ? motion_stats.recalculate_time / motion_stats.recalculate_count : 0);
+  SERIAL_ECHOPGM(" max ");
+  SERIAL_ECHOLN(motion_stats.recalculate_max);
+  SERIAL_ECHO_START;
+  SERIAL_ECHOPGM("Stepper ISR us: max ");
+  SERIAL_ECHOLN(isr_max * 1000UL / (STEPPER_TIMER_RATE / 1000));
+  #ifdef KINEMATICS_STAGING
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPGM("Segments staged ahead:");
+    SERIAL_ECHOLN(motion_stats.kinematics_ahead);
+  #endif
+}
+#endif
+
 
@@ -43,32 +43,57 @@ typedef struct {
     volatile long final_advance;
     float advance;
   #endif
+  #ifdef LIN_ADVANCE
+    unsigned long advance_factor;           // E steps of lead per step/s of rate, in 1/2^24, see extruder_advance_k
+  #endif
 
   // Fields used by the motion planner to manage acceleration
 //  float speed_x, speed_y, speed_z, speed_e;        // Nominal mm/sec for each axis
   float nominal_speed;                               // The nominal speed for this block in mm/sec 
   float entry_speed;                                 // Entry speed at previous-current junction in mm/sec
   float max_entry_speed;                             // Maximum allowable junction entry speed in mm/sec
-  float millimeters;                                 // The total travel of this block in mm
-  float acceleration;                                // acceleration mm/sec^2
-  unsigned char recalculate_flag;                    // Planner flag to recalculate trapezoids on entry junction
-  unsigned char nominal_length_flag;                 // Planner flag for nominal speed always reached
+  float delta_speed_sqr;                             // 2*acceleration*millimeters, the most the block can change speed^2 by
+  #ifdef SPEED_OVERRIDE_REPLAN
+    float feed_speed;                                // Nominal speed at a feedmultiply of 100, before the axis limits
+    float max_junction_speed;                        // Limit of the entry speed from the junction alone
+  #endif
+  unsigned char recalculate_flag : 1;                // Planner flag to recalculate trapezoids on entry junction
+  unsigned char nominal_length_flag : 1;             // Planner flag for nominal speed always reached
 
   // Settings for the trapezoid generator
   unsigned long nominal_rate;                        // The nominal step rate for this block in step_events/sec 
   unsigned long initial_rate;                        // The jerk-adjusted step rate at start of block  
   unsigned long final_rate;                          // The minimal rate at exit
   unsigned long acceleration_st;                     // acceleration steps/sec^2
-  unsigned long fan_speed;
+  #ifdef SLOWDOWN
+    unsigned long planned_time;                      // Nominal duration of the block in us
+  #endif
+  #ifdef S_CURVE_ACCELERATION
+    unsigned long acceleration_ticks;                // Length of the acceleration in timer ticks
+    unsigned long deceleration_ticks;                // Length of the deceleration in timer ticks
+    unsigned long acceleration_jerk_inverse;         // 2^31/S_CURVE_JERK_TICKS(acceleration_ticks)
+    unsigned long deceleration_jerk_inverse;         // 2^31/S_CURVE_JERK_TICKS(deceleration_ticks)
+  #endif
+  #ifdef PLANNER_FIXED_POINT
+    unsigned int acceleration_inverse;               // 1/(2*acceleration_st) as a 16 bit mantissa
+    unsigned char acceleration_inverse_shift;        // and the right shift that goes with it
+  #endif
+  unsigned char fan_speed;
   volatile char busy;
 } block_t;
 
+#ifdef S_CURVE_ACCELERATION
+  // Timer ticks at each end of a ramp over which the acceleration changes
+  #define S_CURVE_JERK_TICKS(ramp_ticks) (((ramp_ticks) * S_CURVE_JERK_SHARE) >> 8)
+#endif
+
 // Initialize the motion plan subsystem      
 void plan_init();
 
 // Add a new linear movement to the buffer. x, y and z is the signed, absolute target position in 
-// millimaters. Feed rate specifies the speed of the motion.
-void plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder);
+// millimaters. Feed rate specifies the speed of the motion. For a segment of a kinematics move
+// cartesian_mm is the length of the segment at the tool, and feed rate is tool speed.
+void plan_buffer_line(const float &x, const float &y, const float &z, const float &e, float feed_rate, const uint8_t &extruder, const float &cartesian_mm = 0.0);
 
 // Set position. Used for G92 instructions.
 void plan_set_position(const float &x, const float &y, const float &z, const float &e);
@@ -76,9 +101,73 @@ void plan_set_e_position(const float &e);
 
 
 
+#ifdef PLANNER_FIXED_POINT
+// Sets up the block's acceleration_inverse from acceleration_st
+void calculate_acceleration_inverse(block_t *block);
+#endif
+void calculate_trapezoid_for_block(block_t *block, float entry_factor, float exit_factor);
+
+// The ramp of a block slowing down to a stop, see calculate_stop_for_block()
+typedef struct {
+  unsigned long step_rate;                           // The rate it slows down from
+  unsigned long step_events;                         // Step events it takes to get to the lowest rate
+  #ifdef S_CURVE_ACCELERATION
+    unsigned long deceleration_ticks;
+    unsigned long deceleration_jerk_inverse;
+  #endif
+} block_stop_t;
+
+// Trapezoid of the running block and the plan for a stop, see st_stop()
+bool calculate_stop_for_block(block_t *block, unsigned long step_rate, block_stop_t &stop);
+void plan_stop(unsigned char first, float speed);
+
+// Gives the block the stepper interrupt is on the trapezoid of the stop, with the interrupt off
+FORCE_INLINE void plan_stop_block(block_t *block, const block_stop_t &stop)
+{
+  block->accelerate_until = 0;
+  block->decelerate_after = 0;
+  block->initial_rate = stop.step_rate;
+  block->final_rate = 120;
+  #ifdef S_CURVE_ACCELERATION
+    block->deceleration_ticks = stop.deceleration_ticks;
+    block->deceleration_jerk_inverse = stop.deceleration_jerk_inverse;
+  #endif
+}
+
+#ifdef SPEED_OVERRIDE_REPLAN
+// Replans the blocks in the buffer for a new feedmultiply, see M220
+void plan_apply_feed_multiply();
+#endif
+
+#ifdef SLOWDOWN
+// Factor for the speed of the next move, below 1 when the buffer is running low
+float plan_slowdown_factor();
+#endif
+
 void check_axes_activity();
 uint8_t movesplanned(); //return the nr of buffered moves
 
+#ifdef MOTION_STATS
+#define MOTION_STATS_BUCKETS 8
+typedef struct {
+  volatile unsigned long buffer_empty;            // Times the stepper finished a block with none left
+  unsigned long occupancy[MOTION_STATS_BUCKETS];  // movesplanned() when blocks were added, bucketed
+  unsigned long recalculate_count;                // planner_recalculate() calls
+  unsigned long recalculate_time;                 // and their total and longest time in us
+  unsigned long recalculate_max;
+  volatile unsigned int isr_max;                  // Longest stepper interrupt in timer 1 ticks
+  #ifdef KINEMATICS_STAGING
+    unsigned long kinematics_ahead;               // Segments worked out while the buffer was full
+  #endif
+} motion_stats_t;
+
+extern motion_stats_t motion_stats;
+
+// M122 reports the statistics, M122 R resets them
+void motion_stats_reset();
+void motion_stats_report();
+#endif
+
 extern unsigned long minsegmenttime;
 extern float max_feedrate[4]; // set the max speeds
 extern float axis_steps_per_unit[4];
@@ -89,6 +178,10 @@ extern float retract_acceleration; //  mm/s^2   filament pull-pack and push-forw
 extern float max_xy_jerk; //speed than can be stopped at once, if i understand correctly.
 extern float max_z_jerk;
 extern float max_e_jerk;
+extern float junction_deviation; // 0 = jerk cornering, otherwise junction deviation cornering
+#ifdef LIN_ADVANCE
+extern float extruder_advance_k;   // s of E rate the extruder runs ahead by, M900 K
+#endif
 extern float mintravelfeedrate;
 extern unsigned long axis_steps_per_sqr_second[NUM_AXIS];
 
@@ -125,6 +218,34 @@ FORCE_INLINE block_t *plan_get_current_block()
   return(block);
 }
 
+#ifdef STEP_SEGMENT_BUFFER
+extern unsigned char block_buffer_prepared;        // Index of the next block to cut into step segments
+
+// Gets the block to cut into step segments. Returns NULL if all blocks have been cut. The block
+// is marked busy, so the planner leaves its trapezoid alone from now on.
+FORCE_INLINE block_t *plan_get_prepare_block()
+{
+  if (block_buffer_prepared == block_buffer_head) {
+    return(NULL);
+  }
+  block_t *block = &block_buffer[block_buffer_prepared];
+  block->busy = true;
+  return(block);
+}
+
+// Called when the step segments of the block have all been cut
+FORCE_INLINE void plan_discard_prepare_block()
+{
+  block_buffer_prepared = (block_buffer_prepared + 1) & (BLOCK_BUFFER_SIZE - 1);
+}
+#endif
+
+// True while plan_buffer_line() would have to wait for room
+FORCE_INLINE bool plan_buffer_full()
+{
+  return block_buffer_tail == ((block_buffer_head + 1) & (BLOCK_BUFFER_SIZE - 1));
+}
+
 // Gets the current block. Returns NULL if buffer empty
 FORCE_INLINE bool blocks_queued() 
 {
@@ -51,17 +51,89 @@ static long counter_x,       // Counter variables for the bresenham line tracer
             counter_z,       
             counter_e;
 volatile static unsigned long step_events_completed; // The number of step events executed in the current block
+static unsigned long step_events_end;                // and the count it ends at, lower than step_event_count once st_stop() cut it short
 #ifdef ADVANCE
   static long advance_rate, advance, final_advance = 0;
   static long old_advance = 0;
   static long e_steps[3];
 #endif
+#ifdef LIN_ADVANCE
+  #ifdef ADVANCE
+    #error "ADVANCE and LIN_ADVANCE can not be used together"
+  #endif
+  static unsigned short advance_lead;         // E steps the extruder is to run ahead of the block
+  static unsigned short advance_lead_nominal; // the same at the nominal rate of the current block
+  static int advance_steps;                   // E steps still to take to get there, signed like E
+#endif
 static long acceleration_time, deceleration_time;
+#ifdef S_CURVE_ACCELERATION
+  static unsigned long acceleration_jerk_ticks, deceleration_jerk_ticks;
+#endif
 //static unsigned long accelerate_until, decelerate_after, acceleration_rate, initial_rate, final_rate, nominal_rate;
 static unsigned short acc_step_rate; // needed for deccelaration start point
 static char step_loops;
+static char step_loops_nominal;
 static unsigned short OCR1A_nominal;
 
+#ifdef STEP_SEGMENT_BUFFER
+  #ifdef ADVANCE
+    #error "STEP_SEGMENT_BUFFER does not support ADVANCE"
+  #endif
+
+  // A run of step events of one block at one rate, cut by st_prepare_segments()
+  typedef struct {
+    block_t *block;            // The block the step events belong to
+    unsigned short timer;      // OCR1A between the interrupts
+    unsigned char step_loops;  // Step events per interrupt
+    unsigned char step_events; // Step events in the segment
+    #ifdef LIN_ADVANCE
+      unsigned short advance_lead; // E steps of lead at the rate of the segment
+    #endif
+  } segment_t;
+
+  static segment_t segment_buffer[STEP_SEGMENT_BUFFER_SIZE];
+  static volatile unsigned char segment_buffer_head;  // Index of the next segment to be cut
+  static volatile unsigned char segment_buffer_tail;  // Index of the next segment to step
+  static unsigned char segment_step_events;           // Step events left of the segment being stepped
+  static unsigned short segment_timer;
+
+  // The segment preparation runs in the foreground. It keeps the trapezoid generator state in
+  // acceleration_time, deceleration_time and acc_step_rate, the interrupt does not use them.
+  static block_t *prepare_block;                      // The block being cut, NULL between blocks
+  static unsigned long prepare_step_events;           // Step events of it cut so far
+  static unsigned long prepare_step_events_end;       // and the count it ends at, see step_events_end
+  static char prepare_step_loops;                     // Step events per interrupt of the last segment cut
+#endif
+
+#ifdef STEP_TRACE
+  #define STEP_TRACE_BLOCK_START 0x10 // The first stepping interrupt of a block
+  #define STEP_TRACE_LATE 0x20        // The interrupt ended after the next compare match
+
+  // One stepping interrupt
+  typedef struct {
+    unsigned short ticks;     // Timer ticks since the last one recorded, 65535 for longer
+    unsigned short steps;     // Steps taken, 4 bits per axis with X in the low bits
+    unsigned char latency;    // Timer ticks from the compare match to the first step, 255 for longer
+    unsigned char flags;      // The direction bits (1<<X_AXIS and so on set for -) and the above
+    unsigned char block;      // The block it stepped, numbered as in step_trace_block_t
+  } step_trace_t;
+
+  // The plan of a block the interrupt took on while tracing
+  typedef struct {
+    unsigned char block;
+    unsigned long step_event_count, initial_rate, nominal_rate, final_rate;
+    long accelerate_until, decelerate_after;
+  } step_trace_block_t;
+
+  static step_trace_t step_trace[STEP_TRACE_SIZE];
+  static step_trace_block_t step_trace_blocks[STEP_TRACE_BLOCKS];
+  static volatile bool step_trace_on;
+  static unsigned long step_trace_count;     // Interrupts recorded since st_trace_start(), the last STEP_TRACE_SIZE are kept
+  static unsigned char step_trace_block_count;
+  static unsigned long step_trace_ticks;     // Timer ticks since the last interrupt recorded
+  static bool step_trace_block_start;
+#endif
+
 volatile long endstops_trigsteps[3]={0,0,0};
 volatile long endstops_stepsTotal,endstops_stepsDone;
 static volatile bool endstop_x_hit=false;
@@ -78,8 +150,20 @@ static bool old_z_max_endstop=false;
 static bool check_endstops = true;
 static bool ignore_check_Z_endstops = true;
 
+// Endstops the current block moves towards, bits of endstop_checks
+#define X_MIN_ENDSTOP 0
+#define X_MAX_ENDSTOP 1
+#define Y_MIN_ENDSTOP 2
+#define Y_MAX_ENDSTOP 3
+#define Z_MIN_ENDSTOP 4
+#define Z_MAX_ENDSTOP 5
+static unsigned char endstop_checks;
+
 volatile long count_position[NUM_AXIS] = { 0, 0, 0, 0};
 volatile signed char count_direction[NUM_AXIS] = { 1, 1, 1, 1};
+#ifdef BABYSTEPPING
+  static volatile int babysteps_z = 0; // Z steps still to take on top of the moves, signed
+#endif
 
 //===========================================================================
 //=============================functions         ============================
@@ -87,6 +171,23 @@ volatile signed char count_direction[NUM_AXIS] = { 1, 1, 1, 1};
 
 #define CHECK_ENDSTOPS  if(check_endstops)
 
+#if defined(ENDSTOP_INTERRUPTS) && !defined(DIO_EXT_INTERRUPT)
+  #undef ENDSTOP_INTERRUPTS // fastio.h doesn't know the interrupt pins of this processor, poll them all
+#endif
+#ifdef ENDSTOP_INTERRUPTS
+  // Endstop pins with an external or pin change interrupt are read when they change, the others
+  // every stepper interrupt
+  #define ENDSTOP_INTERRUPT(IO) ((IO) > -1 && (DIO_EXT_INTERRUPT(IO) >= 0 || DIO_PCINT_BANK(IO) >= 0))
+  // Endstops a pin change found pressed, bits of endstop_checks, and the axis positions then. The
+  // next stepper interrupt reads them again before it stops the block, so a spike on the line
+  // doesn't end the move, like the two reads a polled endstop takes.
+  static unsigned char endstop_pressed;
+  static long endstop_pressed_steps[3];
+#else
+  #define ENDSTOP_INTERRUPT(IO) 0
+#endif
+
+#ifdef __AVR__
 // intRes = intIn1 * intIn2 >> 16
 // uses:
 // r26 to store 0
@@ -157,6 +258,47 @@ asm volatile ( \
 "r26" , "r27" \
 )
 
+#else // Portable versions of the above, bit exact including the rounding, for host builds (see hostsim/)
+
+FORCE_INLINE unsigned short MultiU16X8toH16_c(unsigned char charIn1, unsigned short intIn2)
+{
+  unsigned short hi = (unsigned short)charIn1 * (intIn2 >> 8);
+  unsigned short lo = (unsigned short)charIn1 * (intIn2 & 0xff);
+  return hi + (lo >> 8) + (lo & 1);
+}
+#define MultiU16X8toH16(intRes, charIn1, intIn2) intRes = MultiU16X8toH16_c(charIn1, intIn2)
+
+// Adds the 16 bit partial product p into the 24 bit accumulator (res:r27), the
+// low byte of p lands on r27 like the "add r27, r0; adc %A0, r1" pairs above.
+#define MULTI_ADD_LOW(res, r27, p) { unsigned short t = r27 + ((p) & 0xff); r27 = t; res += ((p) >> 8) + (t >> 8); }
+
+FORCE_INLINE unsigned short MultiU24X24toH16_c(unsigned long longIn1, unsigned long longIn2)
+{
+  unsigned char a1 = longIn1, b1 = longIn1 >> 8, c1 = longIn1 >> 16;
+  unsigned char a2 = longIn2, b2 = longIn2 >> 8, c2 = longIn2 >> 16;
+  unsigned char r27 = ((unsigned short)a1 * b2) >> 8;
+  unsigned short res = (unsigned short)b1 * c2;
+  res += (unsigned short)(((unsigned short)c1 * c2) & 0xff) << 8;
+  res += (unsigned short)c1 * b2;
+  MULTI_ADD_LOW(res, r27, (unsigned short)a1 * c2);
+  MULTI_ADD_LOW(res, r27, (unsigned short)b1 * b2);
+  MULTI_ADD_LOW(res, r27, (unsigned short)c1 * a2);
+  unsigned short t = r27 + (((unsigned short)b1 * a2) >> 8);
+  r27 = t;
+  res += t >> 8;
+  return res + (r27 & 1);
+}
+#define MultiU24X24toH16(intRes, longIn1, longIn2) intRes = MultiU24X24toH16_c(longIn1, longIn2)
+#endif // __AVR__
+
+// Waits DIRECTION_SETUP_NS after a direction pin was written, before the step pin goes. The host
+// simulator's interrupts take no time, it has nothing to wait for.
+#ifdef __AVR__
+  #define DIRECTION_SETUP_DELAY() __builtin_avr_delay_cycles((DIRECTION_SETUP_NS * (F_CPU / 1000000L) + 999) / 1000)
+#else
+  #define DIRECTION_SETUP_DELAY()
+#endif
+
 // Some useful constants
 
 #define ENABLE_STEPPER_DRIVER_INTERRUPT()  TIMSK1 |= (1<<OCIE1A)
@@ -196,6 +338,167 @@ void enable_endstops(bool check)
   check_endstops = check;
 }
 
+#ifdef ENDSTOP_INTERRUPTS
+// Notes the endstops with an interrupt that are pressed and the current block moves towards, with
+// the step they were pressed at. The pin is read when it changes, and when a block starts, for an
+// endstop that is pressed already. confirm_interrupt_endstops() stops the block.
+static void check_interrupt_endstops()
+{
+  if (current_block == NULL) return;
+
+  #if defined ALWAYS_USE_XY_ENDSTOPS
+  #else
+    CHECK_ENDSTOPS
+  #endif
+  {
+    #if ENDSTOP_INTERRUPT(X_MIN_PIN)
+      if ((endstop_checks & ~endstop_pressed & (1<<X_MIN_ENDSTOP)) && READ(X_MIN_PIN) != X_ENDSTOPS_INVERTING) {
+        endstop_pressed |= 1<<X_MIN_ENDSTOP;
+        endstop_pressed_steps[X_AXIS] = count_position[X_AXIS];
+      }
+    #endif
+    #if ENDSTOP_INTERRUPT(X_MAX_PIN)
+      if ((endstop_checks & ~endstop_pressed & (1<<X_MAX_ENDSTOP)) && READ(X_MAX_PIN) != X_ENDSTOPS_INVERTING) {
+        endstop_pressed |= 1<<X_MAX_ENDSTOP;
+        endstop_pressed_steps[X_AXIS] = count_position[X_AXIS];
+      }
+    #endif
+    #if ENDSTOP_INTERRUPT(Y_MIN_PIN)
+      if ((endstop_checks & ~endstop_pressed & (1<<Y_MIN_ENDSTOP)) && READ(Y_MIN_PIN) != Y_ENDSTOPS_INVERTING) {
+        endstop_pressed |= 1<<Y_MIN_ENDSTOP;
+        endstop_pressed_steps[Y_AXIS] = count_position[Y_AXIS];
+      }
+    #endif
+    #if ENDSTOP_INTERRUPT(Y_MAX_PIN)
+      if ((endstop_checks & ~endstop_pressed & (1<<Y_MAX_ENDSTOP)) && READ(Y_MAX_PIN) != Y_ENDSTOPS_INVERTING) {
+        endstop_pressed |= 1<<Y_MAX_ENDSTOP;
+        endstop_pressed_steps[Y_AXIS] = count_position[Y_AXIS];
+      }
+    #endif
+  }
+  CHECK_ENDSTOPS
+  {
+    #if ENDSTOP_INTERRUPT(Z_MIN_PIN)
+      if ((endstop_checks & ~endstop_pressed & (1<<Z_MIN_ENDSTOP)) && READ(Z_MIN_PIN) != Z_ENDSTOPS_INVERTING) {
+        endstop_pressed |= 1<<Z_MIN_ENDSTOP;
+        endstop_pressed_steps[Z_AXIS] = count_position[Z_AXIS];
+      }
+    #endif
+    #if ENDSTOP_INTERRUPT(Z_MAX_PIN)
+      if ((endstop_checks & ~endstop_pressed & (1<<Z_MAX_ENDSTOP)) && READ(Z_MAX_PIN) != Z_ENDSTOPS_INVERTING) {
+        endstop_pressed |= 1<<Z_MAX_ENDSTOP;
+        endstop_pressed_steps[Z_AXIS] = count_position[Z_AXIS];
+      }
+    #endif
+  }
+}
+
+// Stops the current block at the endstops check_interrupt_endstops() found pressed, if they still
+// are. Runs at the start of the stepper interrupt, one interrupt after the pin was read.
+FORCE_INLINE void confirm_interrupt_endstops()
+{
+  unsigned char pressed = endstop_pressed;
+  endstop_pressed = 0;
+  if (current_block == NULL) return;
+  #if ENDSTOP_INTERRUPT(X_MIN_PIN)
+    if ((pressed & (1<<X_MIN_ENDSTOP)) && READ(X_MIN_PIN) != X_ENDSTOPS_INVERTING) {
+      endstops_trigsteps[X_AXIS] = endstop_pressed_steps[X_AXIS];
+      endstop_x_hit=true;
+      step_events_completed = current_block->step_event_count;
+    }
+  #endif
+  #if ENDSTOP_INTERRUPT(X_MAX_PIN)
+    if ((pressed & (1<<X_MAX_ENDSTOP)) && READ(X_MAX_PIN) != X_ENDSTOPS_INVERTING) {
+      endstops_trigsteps[X_AXIS] = endstop_pressed_steps[X_AXIS];
+      endstop_x_hit=true;
+      step_events_completed = current_block->step_event_count;
+    }
+  #endif
+  #if ENDSTOP_INTERRUPT(Y_MIN_PIN)
+    if ((pressed & (1<<Y_MIN_ENDSTOP)) && READ(Y_MIN_PIN) != Y_ENDSTOPS_INVERTING) {
+      endstops_trigsteps[Y_AXIS] = endstop_pressed_steps[Y_AXIS];
+      endstop_y_hit=true;
+      step_events_completed = current_block->step_event_count;
+    }
+  #endif
+  #if ENDSTOP_INTERRUPT(Y_MAX_PIN)
+    if ((pressed & (1<<Y_MAX_ENDSTOP)) && READ(Y_MAX_PIN) != Y_ENDSTOPS_INVERTING) {
+      endstops_trigsteps[Y_AXIS] = endstop_pressed_steps[Y_AXIS];
+      endstop_y_hit=true;
+      step_events_completed = current_block->step_event_count;
+    }
+  #endif
+  #if ENDSTOP_INTERRUPT(Z_MIN_PIN)
+    if ((pressed & (1<<Z_MIN_ENDSTOP)) && READ(Z_MIN_PIN) != Z_ENDSTOPS_INVERTING) {
+      endstops_trigsteps[Z_AXIS] = endstop_pressed_steps[Z_AXIS];
+      endstop_z_hit=true;
+      step_events_completed = current_block->step_event_count;
+    }
+  #endif
+  #if ENDSTOP_INTERRUPT(Z_MAX_PIN)
+    if ((pressed & (1<<Z_MAX_ENDSTOP)) && READ(Z_MAX_PIN) != Z_ENDSTOPS_INVERTING) {
+      endstops_trigsteps[Z_AXIS] = endstop_pressed_steps[Z_AXIS];
+      endstop_z_hit=true;
+      step_events_completed = current_block->step_event_count;
+    }
+  #endif
+}
+
+// The vectors of the endstop pins
+#define ENDSTOP_EXT_INTERRUPT(n) (DIO_EXT_INTERRUPT(X_MIN_PIN) == (n) || DIO_EXT_INTERRUPT(X_MAX_PIN) == (n) || \
+  DIO_EXT_INTERRUPT(Y_MIN_PIN) == (n) || DIO_EXT_INTERRUPT(Y_MAX_PIN) == (n) || \
+  DIO_EXT_INTERRUPT(Z_MIN_PIN) == (n) || DIO_EXT_INTERRUPT(Z_MAX_PIN) == (n))
+#define ENDSTOP_PCINT_BANK(n) (DIO_PCINT_BANK(X_MIN_PIN) == (n) || DIO_PCINT_BANK(X_MAX_PIN) == (n) || \
+  DIO_PCINT_BANK(Y_MIN_PIN) == (n) || DIO_PCINT_BANK(Y_MAX_PIN) == (n) || \
+  DIO_PCINT_BANK(Z_MIN_PIN) == (n) || DIO_PCINT_BANK(Z_MAX_PIN) == (n))
+
+#if ENDSTOP_EXT_INTERRUPT(0)
+  ISR(INT0_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_EXT_INTERRUPT(1)
+  ISR(INT1_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_EXT_INTERRUPT(2)
+  ISR(INT2_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_EXT_INTERRUPT(3)
+  ISR(INT3_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_EXT_INTERRUPT(4)
+  ISR(INT4_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_EXT_INTERRUPT(5)
+  ISR(INT5_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_PCINT_BANK(0)
+  ISR(PCINT0_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_PCINT_BANK(1)
+  ISR(PCINT1_vect) { check_interrupt_endstops(); }
+#endif
+#if ENDSTOP_PCINT_BANK(2)
+  ISR(PCINT2_vect) { check_interrupt_endstops(); }
+#endif
+
+// Interrupt on any change of the pin, through INTn or else PCINTn
+static void enable_endstop_interrupt(char ext, char bank, unsigned char bit)
+{
+  if (ext >= 0) {
+    if (ext < 4)
+      EICRA = (EICRA & ~(3 << (ext * 2))) | (1 << (ext * 2));
+    else
+      EICRB = (EICRB & ~(3 << ((ext - 4) * 2))) | (1 << ((ext - 4) * 2));
+    EIMSK |= 1 << ext;
+  }
+  else {
+    if (bank == 0) PCMSK0 |= 1 << bit;
+    else if (bank == 1) PCMSK1 |= 1 << bit;
+    else PCMSK2 |= 1 << bit;
+    PCICR |= 1 << bank;
+  }
+}
+#endif // ENDSTOP_INTERRUPTS
+
 //         __________________________
 //        /|                        |\     _________________         ^
 //       / |                        | \   /|               |\        |
@@ -214,6 +517,9 @@ void enable_endstops(bool check)
 
 void st_wake_up() {
   //  TCNT1 = 0;
+  #ifdef STEP_SEGMENT_BUFFER
+    st_prepare_segments();
+  #endif
   ENABLE_STEPPER_DRIVER_INTERRUPT();  
 }
 
@@ -223,41 +529,129 @@ void step_wait(){
 }
   
 
-FORCE_INLINE unsigned short calc_timer(unsigned short step_rate) {
+// Timer value for step_rate, and in step_loops the step events per interrupt: the fewest that keep the
+// interrupt at or under MAX_STEP_ISR_FREQUENCY. A count below the one step_loops holds is only taken
+// once the rate is 1/16 under the ceiling, so rates hovering around it don't switch back and forth.
+FORCE_INLINE unsigned short calc_timer(unsigned short step_rate, char &step_loops) {
   unsigned short timer;
   if(step_rate > MAX_STEP_FREQUENCY) step_rate = MAX_STEP_FREQUENCY;
   
-  if(step_rate > 20000) { // If steprate > 20kHz >> step 4 times
-    step_rate = (step_rate >> 2)&0x3fff;
-    step_loops = 4;
-  }
-  else if(step_rate > 10000) { // If steprate > 10kHz >> step 2 times
-    step_rate = (step_rate >> 1)&0x7fff;
-    step_loops = 2;
+  char loops = 1;
+  while(loops < 8 && step_rate > (loops < step_loops ? MAX_STEP_ISR_FREQUENCY - MAX_STEP_ISR_FREQUENCY / 16 : MAX_STEP_ISR_FREQUENCY)) {
+    step_rate >>= 1;
+    loops <<= 1;
   }
-  else {
-    step_loops = 1;
-  } 
+  step_loops = loops;
   
-  if(step_rate < (F_CPU/500000)) step_rate = (F_CPU/500000);
-  step_rate -= (F_CPU/500000); // Correct for minimal speed
+  if(step_rate < SPEED_LOOKUPTABLE_OFFSET) step_rate = SPEED_LOOKUPTABLE_OFFSET;
+  step_rate -= SPEED_LOOKUPTABLE_OFFSET; // Correct for minimal speed
   if(step_rate >= (8*256)){ // higher step rate 
-    unsigned short table_address = (unsigned short)&speed_lookuptable_fast[(unsigned char)(step_rate>>8)][0];
-    unsigned char tmp_step_rate = (step_rate & 0x00ff);
-    unsigned short gain = (unsigned short)pgm_read_word_near(table_address+2);
+    const unsigned short *table_address = &speed_lookuptable_fast[(unsigned char)(step_rate>>SPEED_LOOKUPTABLE_FAST_SHIFT)][0];
+    // Position within the entry in 1/256
+    unsigned char tmp_step_rate = (step_rate & ((1 << SPEED_LOOKUPTABLE_FAST_SHIFT) - 1)) << (8 - SPEED_LOOKUPTABLE_FAST_SHIFT);
+    unsigned short gain = (unsigned short)pgm_read_word_near(table_address+1);
     MultiU16X8toH16(timer, tmp_step_rate, gain);
     timer = (unsigned short)pgm_read_word_near(table_address) - timer;
   }
   else { // lower step rates
-    unsigned short table_address = (unsigned short)&speed_lookuptable_slow[0][0];
-    table_address += ((step_rate)>>1) & 0xfffc;
+    const unsigned short *table_address = &speed_lookuptable_slow[(step_rate)>>3][0];
     timer = (unsigned short)pgm_read_word_near(table_address);
-    timer -= (((unsigned short)pgm_read_word_near(table_address+2) * (unsigned char)(step_rate & 0x0007))>>3);
+    timer -= (((unsigned short)pgm_read_word_near(table_address+1) * (unsigned char)(step_rate & 0x0007))>>3);
   }
-  if(timer < 100) { timer = 100; MYSERIAL.print(MSG_STEPPER_TO_HIGH); MYSERIAL.println(step_rate); }//(20kHz this should never happen)
+  if(timer < STEPPER_TIMER_RATE / 20000) { timer = STEPPER_TIMER_RATE / 20000; MYSERIAL.print(MSG_STEPPER_TO_HIGH); MYSERIAL.println(step_rate); }//(20kHz this should never happen)
   return timer;
 }
 
+FORCE_INLINE unsigned short calc_timer(unsigned short step_rate) {
+  return calc_timer(step_rate, step_loops);
+}
+
+#ifndef STEP_SEGMENT_BUFFER
+// A timer value for step_loops step events, scaled to the loops the interrupt just took. The interval
+// after an interrupt has to suit its own step events, a new step_loops starts with the next one.
+FORCE_INLINE unsigned short timer_for_loops(unsigned short timer, char loops) {
+  for (char new_loops = step_loops; new_loops > loops; new_loops >>= 1) timer >>= 1;
+  for (char new_loops = step_loops; new_loops < loops; new_loops <<= 1) timer <<= 1;
+  return timer;
+}
+#endif
+
+#ifdef LIN_ADVANCE
+// E steps of lead at step_rate: extruder_advance_k seconds of the block's E steps at that rate
+FORCE_INLINE unsigned short advance_lead_at(block_t *block, unsigned long step_rate) {
+  if (block->advance_factor == 0) return 0;
+  unsigned short lead;
+  MultiU24X24toH16(lead, step_rate, block->advance_factor);
+  return lead;
+}
+
+// Moves the lead to lead, the step events take the E steps for it as they go
+FORCE_INLINE void set_advance_lead(unsigned short lead) {
+  advance_steps += (int)lead - (int)advance_lead;
+  advance_lead = lead;
+}
+#endif
+
+#ifdef S_CURVE_ACCELERATION
+// With S-curve ramps acceleration_rate is half the peak acceleration, see plan_buffer_line(),
+// so these work out half the step rate gained and the caller doubles it.
+
+// Half the step rate gained after t ticks of the acceleration rising linearly to its peak over
+// jerk_ticks (jerk_inverse is 2^31/jerk_ticks): peak * t^2 / (4 * jerk_ticks)
+FORCE_INLINE unsigned short s_curve_jerk_rate(block_t *block, unsigned long t, unsigned long jerk_inverse) {
+  unsigned short rate;
+  unsigned short fraction = (t * jerk_inverse) >> 15; // t/jerk_ticks in 1/65536
+  unsigned long acceleration = ((unsigned long)(unsigned short)(block->acceleration_rate >> 8) * fraction) >> 9;
+  MultiU24X24toH16(rate, t, acceleration);
+  return rate;
+}
+
+// Step rate gained after t ticks of a ramp that lasts ramp_ticks. The acceleration rises over the
+// first jerk_ticks, holds at its peak and falls to 0 again over the last jerk_ticks.
+FORCE_INLINE unsigned short s_curve_rate(block_t *block, unsigned long t, unsigned long ramp_ticks, unsigned long jerk_ticks, unsigned long jerk_inverse) {
+  unsigned short rate;
+  unsigned long rest;
+  if (t > ramp_ticks) t = ramp_ticks;
+  rest = ramp_ticks - t;
+  if (t < jerk_ticks) {
+    rate = s_curve_jerk_rate(block, t, jerk_inverse);
+  }
+  else if (rest >= jerk_ticks) {
+    MultiU24X24toH16(rate, t - (jerk_ticks >> 1), block->acceleration_rate);
+  }
+  else {
+    MultiU24X24toH16(rate, ramp_ticks - jerk_ticks, block->acceleration_rate);
+    rate -= s_curve_jerk_rate(block, rest, jerk_inverse);
+  }
+  return rate > 0x7fff ? 0xffff : rate << 1;
+}
+#endif // S_CURVE_ACCELERATION
+
+#ifndef STEP_SEGMENT_BUFFER
+// Step rate deceleration_time ticks into the deceleration of the current block
+FORCE_INLINE unsigned short deceleration_rate() {
+  unsigned short step_rate;
+  #ifdef S_CURVE_ACCELERATION
+    step_rate = s_curve_rate(current_block, deceleration_time, current_block->deceleration_ticks,
+      deceleration_jerk_ticks, current_block->deceleration_jerk_inverse);
+  #else
+    MultiU24X24toH16(step_rate, deceleration_time, current_block->acceleration_rate);
+  #endif
+  
+  if(step_rate > acc_step_rate) { // Check step_rate stays positive
+    step_rate = current_block->final_rate;
+  }
+  else {
+    step_rate = acc_step_rate - step_rate; // Decelerate from aceleration end point.
+  }
+
+  // lower limit
+  if(step_rate < current_block->final_rate)
+    step_rate = current_block->final_rate;
+  return step_rate;
+}
+#endif
+
 // Initializes the trapezoid generator from the current block. Called whenever a new 
 // block begins.
 FORCE_INLINE void trapezoid_generator_reset() {
@@ -269,11 +663,20 @@ FORCE_INLINE void trapezoid_generator_reset() {
     old_advance = advance >>8;  
   #endif
   deceleration_time = 0;
+  #ifdef S_CURVE_ACCELERATION
+    acceleration_jerk_ticks = S_CURVE_JERK_TICKS(current_block->acceleration_ticks);
+    deceleration_jerk_ticks = S_CURVE_JERK_TICKS(current_block->deceleration_ticks);
+  #endif
   // step_rate to timer interval
-  OCR1A_nominal = calc_timer(current_block->nominal_rate);
+  step_loops_nominal = step_loops;
+  OCR1A_nominal = calc_timer(current_block->nominal_rate, step_loops_nominal);
   acc_step_rate = current_block->initial_rate;
   acceleration_time = calc_timer(acc_step_rate);
   OCR1A = acceleration_time;
+  #ifdef LIN_ADVANCE
+    advance_lead_nominal = advance_lead_at(current_block, current_block->nominal_rate);
+    set_advance_lead(advance_lead_at(current_block, acc_step_rate));
+  #endif
   
 //    SERIAL_ECHO_START;
 //    SERIAL_ECHOPGM("advance :");
@@ -287,27 +690,269 @@ FORCE_INLINE void trapezoid_generator_reset() {
     
 }
 
+#ifdef STEP_SEGMENT_BUFFER
+// Step rate of the block being cut, ramp_time ticks into its acceleration or deceleration. The same
+// rates the interrupt works out for every step without the segments, except that the sums are not
+// done in 16 bits, so rates above 65535 are cut to it instead of wrapping around. calc_timer() cuts
+// them to MAX_STEP_FREQUENCY, the ramps work out from the planned rates like in the interrupt.
+static unsigned short prepare_ramp_rate(bool accelerating, unsigned long ramp_time)
+{
+  unsigned short ramp_rate;
+  unsigned long step_rate;
+  if (accelerating) {
+    #ifdef S_CURVE_ACCELERATION
+      ramp_rate = s_curve_rate(prepare_block, ramp_time, prepare_block->acceleration_ticks,
+        acceleration_jerk_ticks, prepare_block->acceleration_jerk_inverse);
+    #else
+      MultiU24X24toH16(ramp_rate, ramp_time, prepare_block->acceleration_rate);
+    #endif
+    step_rate = prepare_block->initial_rate + ramp_rate;
+    if(step_rate > prepare_block->nominal_rate)
+      step_rate = prepare_block->nominal_rate;
+  }
+  else {
+    #ifdef S_CURVE_ACCELERATION
+      ramp_rate = s_curve_rate(prepare_block, ramp_time, prepare_block->deceleration_ticks,
+        deceleration_jerk_ticks, prepare_block->deceleration_jerk_inverse);
+    #else
+      MultiU24X24toH16(ramp_rate, ramp_time, prepare_block->acceleration_rate);
+    #endif
+    step_rate = ramp_rate < acc_step_rate ? acc_step_rate - ramp_rate : 0; // From where the acceleration ended
+    if(step_rate < prepare_block->final_rate)
+      step_rate = prepare_block->final_rate;
+  }
+  return min(step_rate, 65535);
+}
+
+void st_prepare_segments()
+{
+  // A block the interrupt stopped at an endstop is gone from the buffer, start over at the tail
+  unsigned char tail = block_buffer_tail;
+  if (prepare_block != NULL && ((block_buffer_prepared - tail) & (BLOCK_BUFFER_SIZE - 1)) >=
+      ((block_buffer_head - tail) & (BLOCK_BUFFER_SIZE - 1))) {
+    prepare_block = NULL;
+    block_buffer_prepared = tail;
+  }
+
+  while (((segment_buffer_head + 1) & (STEP_SEGMENT_BUFFER_SIZE - 1)) != segment_buffer_tail) {
+    if (prepare_block == NULL) {
+      prepare_block = plan_get_prepare_block();
+      if (prepare_block == NULL) {
+        return;
+      }
+      prepare_step_events = 0;
+      prepare_step_events_end = prepare_block->step_event_count;
+      deceleration_time = 0;
+      #ifdef S_CURVE_ACCELERATION
+        acceleration_jerk_ticks = S_CURVE_JERK_TICKS(prepare_block->acceleration_ticks);
+        deceleration_jerk_ticks = S_CURVE_JERK_TICKS(prepare_block->deceleration_ticks);
+      #endif
+      acc_step_rate = min(prepare_block->initial_rate, 65535);
+      acceleration_time = calc_timer(acc_step_rate, prepare_step_loops);
+    }
+
+    unsigned long phase_end;  // Step events until the rate is worked out differently
+    bool accelerating = prepare_step_events <= (unsigned long)prepare_block->accelerate_until;
+    bool decelerating = prepare_step_events > (unsigned long)prepare_block->decelerate_after;
+    unsigned short step_rate = min(prepare_block->nominal_rate, 65535);
+    unsigned long ramp_time = 0;
+    if (accelerating) {
+      ramp_time = acceleration_time;
+      phase_end = prepare_block->accelerate_until + 1;
+    }
+    else if (decelerating) {
+      ramp_time = deceleration_time;
+      phase_end = prepare_step_events_end;
+    }
+    else {
+      phase_end = prepare_block->decelerate_after + 1;
+    }
+    phase_end = min(phase_end, prepare_step_events_end);
+
+    unsigned short timer;
+    unsigned long interrupts, step_events;
+    for (char pass = (accelerating || decelerating) ? 2 : 1; pass > 0; pass--) {
+      if (accelerating || decelerating) {
+        step_rate = prepare_ramp_rate(accelerating, ramp_time);
+      }
+      timer = calc_timer(step_rate, prepare_step_loops);
+      interrupts = max(STEP_SEGMENT_TIME * (STEPPER_TIMER_RATE / 1000) / 1000 / timer, 1);
+      // Only the last interrupt of the block takes fewer step events than the others, a phase of
+      // the trapezoid ends with the interrupt it ends in
+      step_events = min(interrupts * prepare_step_loops, 255 / prepare_step_loops * prepare_step_loops);
+      step_events = min(step_events, (phase_end - prepare_step_events + prepare_step_loops - 1) / prepare_step_loops * prepare_step_loops);
+      step_events = min(step_events, prepare_step_events_end - prepare_step_events);
+      interrupts = (step_events + prepare_step_loops - 1) / prepare_step_loops;
+      // On a ramp the second pass takes the rate half way through the segment, so the ramp
+      // takes the time the planner planned.
+      ramp_time += (timer * interrupts) >> 1;
+    }
+    if (accelerating) {
+      acceleration_time += timer * interrupts;
+      // The deceleration starts from the rate at the end of the acceleration, not the one of its
+      // last segment, or it gets to final_rate early and crawls the rest of the block.
+      acc_step_rate = prepare_ramp_rate(true, acceleration_time);
+    }
+    else if (decelerating) {
+      deceleration_time += timer * interrupts;
+    }
+
+    segment_t *segment = &segment_buffer[segment_buffer_head];
+    segment->block = prepare_block;
+    segment->timer = timer;
+    segment->step_loops = prepare_step_loops;
+    segment->step_events = step_events;
+    #ifdef LIN_ADVANCE
+      segment->advance_lead = advance_lead_at(prepare_block, step_rate);
+    #endif
+    segment_buffer_head = (segment_buffer_head + 1) & (STEP_SEGMENT_BUFFER_SIZE - 1);
+
+    prepare_step_events += step_events;
+    if (prepare_step_events >= prepare_step_events_end) {
+      prepare_block = NULL;
+      plan_discard_prepare_block();
+    }
+  }
+}
+#endif // STEP_SEGMENT_BUFFER
+
+// Sets the direction pins for the current block, and the endstops to check while it runs. The
+// directions only change between blocks.
+FORCE_INLINE void set_directions() {
+  out_bits = current_block->direction_bits;
+  endstop_checks = 0;
+
+  if ((out_bits & (1<<X_AXIS)) != 0) {   // stepping along -X axis
+    #if !defined COREXY  //NOT COREXY
+      WRITE(X_DIR_PIN, INVERT_X_DIR);
+    #endif
+    count_direction[X_AXIS]=-1;
+    if (current_block->steps_x > 0) endstop_checks |= 1<<X_MIN_ENDSTOP;
+  }
+  else { // +direction
+    #if !defined COREXY  //NOT COREXY
+      WRITE(X_DIR_PIN,!INVERT_X_DIR);
+    #endif
+    count_direction[X_AXIS]=1;
+    if (current_block->steps_x > 0) endstop_checks |= 1<<X_MAX_ENDSTOP;
+  }
+
+  if ((out_bits & (1<<Y_AXIS)) != 0) {   // -direction
+    #if !defined COREXY  //NOT COREXY
+      WRITE(Y_DIR_PIN,INVERT_Y_DIR);
+    #endif
+    count_direction[Y_AXIS]=-1;
+    if (current_block->steps_y > 0) endstop_checks |= 1<<Y_MIN_ENDSTOP;
+  }
+  else { // +direction
+    #if !defined COREXY  //NOT COREXY
+      WRITE(Y_DIR_PIN,!INVERT_Y_DIR);
+    #endif
+    count_direction[Y_AXIS]=1;
+    if (current_block->steps_y > 0) endstop_checks |= 1<<Y_MAX_ENDSTOP;
+  }
+
+  #ifdef COREXY  //coreXY kinematics defined
+    if((current_block->steps_x >= current_block->steps_y)&&((out_bits & (1<<X_AXIS)) == 0)){  //+X is major axis
+      WRITE(X_DIR_PIN, !INVERT_X_DIR);
+      WRITE(Y_DIR_PIN, !INVERT_Y_DIR);
+    }
+    if((current_block->steps_x >= current_block->steps_y)&&((out_bits & (1<<X_AXIS)) != 0)){  //-X is major axis
+      WRITE(X_DIR_PIN, INVERT_X_DIR);
+      WRITE(Y_DIR_PIN, INVERT_Y_DIR);
+    }
+    if((current_block->steps_y > current_block->steps_x)&&((out_bits & (1<<Y_AXIS)) == 0)){  //+Y is major axis
+      WRITE(X_DIR_PIN, !INVERT_X_DIR);
+      WRITE(Y_DIR_PIN, INVERT_Y_DIR);
+    }
+    if((current_block->steps_y > current_block->steps_x)&&((out_bits & (1<<Y_AXIS)) != 0)){  //-Y is major axis
+      WRITE(X_DIR_PIN, INVERT_X_DIR);
+      WRITE(Y_DIR_PIN, !INVERT_Y_DIR);
+    }
+  #endif //coreXY
+
+  if ((out_bits & (1<<Z_AXIS)) != 0) {   // -direction
+    WRITE(Z_DIR_PIN,INVERT_Z_DIR);
+    #ifdef Z_DUAL_STEPPER_DRIVERS
+      WRITE(Z2_DIR_PIN,INVERT_Z_DIR);
+    #endif
+    count_direction[Z_AXIS]=-1;
+    if (current_block->steps_z > 0) endstop_checks |= 1<<Z_MIN_ENDSTOP;
+  }
+  else { // +direction
+    WRITE(Z_DIR_PIN,!INVERT_Z_DIR);
+    #ifdef Z_DUAL_STEPPER_DRIVERS
+      WRITE(Z2_DIR_PIN,!INVERT_Z_DIR);
+    #endif
+    count_direction[Z_AXIS]=1;
+    if (current_block->steps_z > 0) endstop_checks |= 1<<Z_MAX_ENDSTOP;
+  }
+
+  #ifndef ADVANCE
+    if ((out_bits & (1<<E_AXIS)) != 0) {  // -direction
+      REV_E_DIR();
+      count_direction[E_AXIS]=-1;
+    }
+    else { // +direction
+      NORM_E_DIR();
+      count_direction[E_AXIS]=1;
+    }
+  #endif //!ADVANCE
+}
+
 // "The Stepper Driver Interrupt" - This timer interrupt is the workhorse.  
 // It pops blocks from the block_buffer and executes them by pulsing the stepper pins appropriately. 
 ISR(TIMER1_COMPA_vect)
 {    
+  #ifdef STEP_TRACE
+    // OCR1A still holds the interval that just ran out
+    if (step_trace_on) step_trace_ticks += OCR1A + 1;
+    step_trace_t *trace = NULL;
+  #endif
+  #ifdef ENDSTOP_INTERRUPTS
+    if (endstop_pressed) confirm_interrupt_endstops();
+  #endif
   // If there is no current block, attempt to pop one from the buffer
   if (current_block == NULL) {
     // Anything in the buffer?
     current_block = plan_get_current_block();
     if (current_block != NULL) {
       current_block->busy = true;
-      trapezoid_generator_reset();
+      #ifndef STEP_SEGMENT_BUFFER
+        trapezoid_generator_reset();
+      #endif
       counter_x = -(current_block->step_event_count >> 1);
       counter_y = counter_x;
       counter_z = counter_x;
       counter_e = counter_x;
       step_events_completed = 0; 
+      step_events_end = current_block->step_event_count;
+      #ifdef STEP_SEGMENT_BUFFER
+        segment_step_events = 0;
+      #endif
+      set_directions();
+      #ifdef ENDSTOP_INTERRUPTS
+        endstop_pressed = 0;
+        check_interrupt_endstops();
+      #endif
+      #ifdef STEP_TRACE
+        if (step_trace_on) {
+          step_trace_block_t *planned = &step_trace_blocks[++step_trace_block_count & (STEP_TRACE_BLOCKS - 1)];
+          planned->block = step_trace_block_count;
+          planned->step_event_count = current_block->step_event_count;
+          planned->initial_rate = current_block->initial_rate;
+          planned->nominal_rate = current_block->nominal_rate;
+          planned->final_rate = current_block->final_rate;
+          planned->accelerate_until = current_block->accelerate_until;
+          planned->decelerate_after = current_block->decelerate_after;
+          step_trace_block_start = true;
+        }
+      #endif
       
       #ifdef Z_LATE_ENABLE 
         if(current_block->steps_z > 0) {
           enable_z();
-          OCR1A = 2000; //1ms wait
+          OCR1A = STEPPER_TIMER_RATE / 1000; //1ms wait
           return;
         }
       #endif
@@ -317,186 +962,117 @@ ISR(TIMER1_COMPA_vect)
 //      #endif
     } 
     else {
-        OCR1A=2000; // 1kHz.
+        OCR1A = STEPPER_TIMER_RATE / 1000; // 1kHz.
     }    
   } 
 
   if (current_block != NULL) {
-    // Set directions TO DO This should be done once during init of trapezoid. Endstops -> interrupt
-    out_bits = current_block->direction_bits;
+    #ifdef STEP_SEGMENT_BUFFER
+      if (segment_step_events == 0) {
+        // Skip what is left of a block stopped at an endstop
+        while (segment_buffer_tail != segment_buffer_head && segment_buffer[segment_buffer_tail].block != current_block) {
+          segment_buffer_tail = (segment_buffer_tail + 1) & (STEP_SEGMENT_BUFFER_SIZE - 1);
+        }
+        if (segment_buffer_tail == segment_buffer_head) {
+          OCR1A = STEPPER_TIMER_RATE / 1000; // The segment preparation fell behind, try again in 1ms
+          return;
+        }
+        segment_t *segment = &segment_buffer[segment_buffer_tail];
+        segment_timer = segment->timer;
+        step_loops = segment->step_loops;
+        segment_step_events = segment->step_events;
+        #ifdef LIN_ADVANCE
+          set_advance_lead(segment->advance_lead);
+        #endif
+        segment_buffer_tail = (segment_buffer_tail + 1) & (STEP_SEGMENT_BUFFER_SIZE - 1);
+      }
+    #endif
 
-    // Set direction en check limit switches
-    if ((out_bits & (1<<X_AXIS)) != 0) {   // stepping along -X axis
-      #if !defined COREXY  //NOT COREXY
-        WRITE(X_DIR_PIN, INVERT_X_DIR);
-      #endif
-      count_direction[X_AXIS]=-1;
-      
-      #if defined ALWAYS_USE_XY_ENDSTOPS
-      #else
-        CHECK_ENDSTOPS
-      #endif      
-      {
-        #if X_MIN_PIN > -1
+    // Check the limit switches the block moves towards
+    #if defined ALWAYS_USE_XY_ENDSTOPS
+    #else
+      CHECK_ENDSTOPS
+    #endif
+    {
+      #if X_MIN_PIN > -1 && !ENDSTOP_INTERRUPT(X_MIN_PIN)
+        if (endstop_checks & (1<<X_MIN_ENDSTOP)) {
           bool x_min_endstop=(READ(X_MIN_PIN) != X_ENDSTOPS_INVERTING);
-          if(x_min_endstop && old_x_min_endstop && (current_block->steps_x > 0)) {
+          if(x_min_endstop && old_x_min_endstop) {
             endstops_trigsteps[X_AXIS] = count_position[X_AXIS];
             endstop_x_hit=true;
             step_events_completed = current_block->step_event_count;
           }
           old_x_min_endstop = x_min_endstop;
-        #endif
-      }
-    }
-    else { // +direction
-      #if !defined COREXY  //NOT COREXY
-        WRITE(X_DIR_PIN,!INVERT_X_DIR);
+        }
       #endif
-      
-      count_direction[X_AXIS]=1;
-      #if defined ALWAYS_USE_XY_ENDSTOPS
-      #else
-        CHECK_ENDSTOPS
-      #endif      
-      {
-        #if X_MAX_PIN > -1
+      #if X_MAX_PIN > -1 && !ENDSTOP_INTERRUPT(X_MAX_PIN)
+        if (endstop_checks & (1<<X_MAX_ENDSTOP)) {
           bool x_max_endstop=(READ(X_MAX_PIN) != X_ENDSTOPS_INVERTING);
-          if(x_max_endstop && old_x_max_endstop && (current_block->steps_x > 0)){
+          if(x_max_endstop && old_x_max_endstop) {
             endstops_trigsteps[X_AXIS] = count_position[X_AXIS];
             endstop_x_hit=true;
             step_events_completed = current_block->step_event_count;
           }
           old_x_max_endstop = x_max_endstop;
-        #endif
-      }
-    }
-
-    if ((out_bits & (1<<Y_AXIS)) != 0) {   // -direction
-      #if !defined COREXY  //NOT COREXY
-        WRITE(Y_DIR_PIN,INVERT_Y_DIR);
+        }
       #endif
-      count_direction[Y_AXIS]=-1;
-      #if defined ALWAYS_USE_XY_ENDSTOPS
-      #else
-        CHECK_ENDSTOPS
-      #endif      
-      {
-        #if Y_MIN_PIN > -1
+      #if Y_MIN_PIN > -1 && !ENDSTOP_INTERRUPT(Y_MIN_PIN)
+        if (endstop_checks & (1<<Y_MIN_ENDSTOP)) {
           bool y_min_endstop=(READ(Y_MIN_PIN) != Y_ENDSTOPS_INVERTING);
-          if(y_min_endstop && old_y_min_endstop && (current_block->steps_y > 0)) {
+          if(y_min_endstop && old_y_min_endstop) {
             endstops_trigsteps[Y_AXIS] = count_position[Y_AXIS];
             endstop_y_hit=true;
             step_events_completed = current_block->step_event_count;
           }
           old_y_min_endstop = y_min_endstop;
-        #endif
-      }
-    }
-    else { // +direction
-      #if !defined COREXY  //NOT COREXY
-        WRITE(Y_DIR_PIN,!INVERT_Y_DIR);
+        }
       #endif
-      count_direction[Y_AXIS]=1;
-
-      #if defined ALWAYS_USE_XY_ENDSTOPS
-      #else
-        CHECK_ENDSTOPS
-      #endif      
-      {
-        #if Y_MAX_PIN > -1
+      #if Y_MAX_PIN > -1 && !ENDSTOP_INTERRUPT(Y_MAX_PIN)
+        if (endstop_checks & (1<<Y_MAX_ENDSTOP)) {
           bool y_max_endstop=(READ(Y_MAX_PIN) != Y_ENDSTOPS_INVERTING);
-          if(y_max_endstop && old_y_max_endstop && (current_block->steps_y > 0)){
+          if(y_max_endstop && old_y_max_endstop) {
             endstops_trigsteps[Y_AXIS] = count_position[Y_AXIS];
             endstop_y_hit=true;
             step_events_completed = current_block->step_event_count;
           }
           old_y_max_endstop = y_max_endstop;
-        #endif
-      }
-    }
-    
-    
-    #ifdef COREXY  //coreXY kinematics defined
-      if((current_block->steps_x >= current_block->steps_y)&&((out_bits & (1<<X_AXIS)) == 0)){  //+X is major axis
-        WRITE(X_DIR_PIN, !INVERT_X_DIR);
-        WRITE(Y_DIR_PIN, !INVERT_Y_DIR);
-      }
-      if((current_block->steps_x >= current_block->steps_y)&&((out_bits & (1<<X_AXIS)) != 0)){  //-X is major axis
-        WRITE(X_DIR_PIN, INVERT_X_DIR);
-        WRITE(Y_DIR_PIN, INVERT_Y_DIR);
-      }      
-      if((current_block->steps_y > current_block->steps_x)&&((out_bits & (1<<Y_AXIS)) == 0)){  //+Y is major axis
-        WRITE(X_DIR_PIN, !INVERT_X_DIR);
-        WRITE(Y_DIR_PIN, INVERT_Y_DIR);
-      }        
-      if((current_block->steps_y > current_block->steps_x)&&((out_bits & (1<<Y_AXIS)) != 0)){  //-Y is major axis
-        WRITE(X_DIR_PIN, INVERT_X_DIR);
-        WRITE(Y_DIR_PIN, !INVERT_Y_DIR);
-      }  
-    #endif //coreXY
-    
-    
-    if ((out_bits & (1<<Z_AXIS)) != 0) {   // -direction
-      WRITE(Z_DIR_PIN,INVERT_Z_DIR);
-      
-	  #ifdef Z_DUAL_STEPPER_DRIVERS
-        WRITE(Z2_DIR_PIN,INVERT_Z_DIR);
+        }
       #endif
-      
-      count_direction[Z_AXIS]=-1;
-      CHECK_ENDSTOPS
-      {
-        #if Z_MIN_PIN > -1
+    }
+    CHECK_ENDSTOPS
+    {
+      #if Z_MIN_PIN > -1 && !ENDSTOP_INTERRUPT(Z_MIN_PIN)
+        if (endstop_checks & (1<<Z_MIN_ENDSTOP)) {
           bool z_min_endstop=(READ(Z_MIN_PIN) != Z_ENDSTOPS_INVERTING);
-          if(z_min_endstop && old_z_min_endstop && (current_block->steps_z > 0)) {
+          if(z_min_endstop && old_z_min_endstop) {
             endstops_trigsteps[Z_AXIS] = count_position[Z_AXIS];
             endstop_z_hit=true;
             step_events_completed = current_block->step_event_count;
           }
           old_z_min_endstop = z_min_endstop;
-        #endif
-      }
-    }
-    else { // +direction
-      WRITE(Z_DIR_PIN,!INVERT_Z_DIR);
-
-	  #ifdef Z_DUAL_STEPPER_DRIVERS
-        WRITE(Z2_DIR_PIN,!INVERT_Z_DIR);
+        }
       #endif
-
-      count_direction[Z_AXIS]=1;
-      CHECK_ENDSTOPS
-      {
-        #if Z_MAX_PIN > -1
+      #if Z_MAX_PIN > -1 && !ENDSTOP_INTERRUPT(Z_MAX_PIN)
+        if (endstop_checks & (1<<Z_MAX_ENDSTOP)) {
           bool z_max_endstop=(READ(Z_MAX_PIN) != Z_ENDSTOPS_INVERTING);
-          if(z_max_endstop && old_z_max_endstop && (current_block->steps_z > 0)) {
+          if(z_max_endstop && old_z_max_endstop) {
             endstops_trigsteps[Z_AXIS] = count_position[Z_AXIS];
             endstop_z_hit=true;
             step_events_completed = current_block->step_event_count;
           }
           old_z_max_endstop = z_max_endstop;
-        #endif
-      }
+        }
+      #endif
     }
-
-    #ifndef ADVANCE
-      if ((out_bits & (1<<E_AXIS)) != 0) {  // -direction
-        REV_E_DIR();
-        count_direction[E_AXIS]=-1;
-      }
-      else { // +direction
-        NORM_E_DIR();
-        count_direction[E_AXIS]=1;
-      }
-    #endif //!ADVANCE
     
 
     
+    #ifdef STEP_TRACE
+      unsigned short trace_latency = TCNT1;
+      long trace_position[NUM_AXIS];
+      if (step_trace_on) memcpy(trace_position, (const void *)count_position, sizeof(trace_position));
+    #endif
     for(int8_t i=0; i < step_loops; i++) { // Take multiple steps per interrupt (For high speed moves) 
-      #ifndef AT90USB
-      MSerial.checkRx(); // Check for serial chars.
-      #endif
-
       #ifdef ADVANCE
       counter_e += current_block->steps_e;
       if (counter_e > 0) {
@@ -595,6 +1171,31 @@ ISR(TIMER1_COMPA_vect)
 
       #ifndef ADVANCE
         counter_e += current_block->steps_e;
+        #ifdef LIN_ADVANCE
+          signed char advance_direction = advance_steps > 0 ? 1 : advance_steps < 0 ? -1 : 0;
+          if (counter_e > 0 && advance_direction == -count_direction[E_AXIS]) {
+            // The lead gives a step back, the E step of this step event cancels out against it
+            counter_e -= current_block->step_event_count;
+            advance_steps += count_direction[E_AXIS];
+          }
+          else if (counter_e <= 0 && advance_direction != 0) {
+            // A step of the lead on its own. Against the block the E direction pin turns for it,
+            // and back before the next E step of the block, which can be in the same interrupt.
+            if (advance_direction != count_direction[E_AXIS]) {
+              if (advance_direction > 0) NORM_E_DIR(); else REV_E_DIR();
+              DIRECTION_SETUP_DELAY();
+            }
+            WRITE_E_STEP(!INVERT_E_STEP_PIN);
+            advance_steps -= advance_direction;
+            count_position[E_AXIS]+=advance_direction;
+            WRITE_E_STEP(INVERT_E_STEP_PIN);
+            if (advance_direction != count_direction[E_AXIS]) {
+              if (advance_direction > 0) REV_E_DIR(); else NORM_E_DIR();
+              DIRECTION_SETUP_DELAY();
+            }
+          }
+          else
+        #endif
         if (counter_e > 0) {
           WRITE_E_STEP(!INVERT_E_STEP_PIN);
           counter_e -= current_block->step_event_count;
@@ -603,14 +1204,46 @@ ISR(TIMER1_COMPA_vect)
         }
       #endif //!ADVANCE
       step_events_completed += 1;  
-      if(step_events_completed >= current_block->step_event_count) break;
+      if(step_events_completed >= step_events_end) break;
+      #ifdef STEP_SEGMENT_BUFFER
+        if(--segment_step_events == 0) break;
+      #endif
     }
+    #ifdef STEP_TRACE
+      if (step_trace_on) {
+        trace = &step_trace[step_trace_count++ & (STEP_TRACE_SIZE - 1)];
+        trace->ticks = step_trace_ticks > 65535 ? 65535 : step_trace_ticks;
+        trace->latency = trace_latency > 255 ? 255 : trace_latency;
+        trace->steps = 0;
+        trace->flags = step_trace_block_start ? STEP_TRACE_BLOCK_START : 0;
+        for (int8_t i = NUM_AXIS - 1; i >= 0; i--) {
+          long steps = count_position[i] - trace_position[i];
+          if (steps < 0) {
+            steps = -steps;
+            trace->flags |= 1<<i;
+          }
+          trace->steps = (trace->steps << 4) | (steps > 15 ? 15 : steps);
+        }
+        trace->block = step_trace_block_count;
+        step_trace_ticks = 0;
+        step_trace_block_start = false;
+      }
+    #endif
+    #ifdef STEP_SEGMENT_BUFFER
+      OCR1A = segment_timer;
+    #else
     // Calculare new timer value
     unsigned short timer;
     unsigned short step_rate;
+    char loops = step_loops; // Step events taken this time
     if (step_events_completed <= (unsigned long int)current_block->accelerate_until) {
       
-      MultiU24X24toH16(acc_step_rate, acceleration_time, current_block->acceleration_rate);
+      #ifdef S_CURVE_ACCELERATION
+        acc_step_rate = s_curve_rate(current_block, acceleration_time, current_block->acceleration_ticks,
+          acceleration_jerk_ticks, current_block->acceleration_jerk_inverse);
+      #else
+        MultiU24X24toH16(acc_step_rate, acceleration_time, current_block->acceleration_rate);
+      #endif
       acc_step_rate += current_block->initial_rate;
       
       // upper limit
@@ -618,9 +1251,12 @@ ISR(TIMER1_COMPA_vect)
         acc_step_rate = current_block->nominal_rate;
 
       // step_rate to timer interval
-      timer = calc_timer(acc_step_rate);
+      timer = timer_for_loops(calc_timer(acc_step_rate), loops);
       OCR1A = timer;
       acceleration_time += timer;
+      #ifdef LIN_ADVANCE
+        set_advance_lead(advance_lead_at(current_block, acc_step_rate));
+      #endif
       #ifdef ADVANCE
         for(int8_t i=0; i < step_loops; i++) {
           advance += advance_rate;
@@ -633,23 +1269,15 @@ ISR(TIMER1_COMPA_vect)
       #endif
     } 
     else if (step_events_completed > (unsigned long int)current_block->decelerate_after) {   
-      MultiU24X24toH16(step_rate, deceleration_time, current_block->acceleration_rate);
-      
-      if(step_rate > acc_step_rate) { // Check step_rate stays positive
-        step_rate = current_block->final_rate;
-      }
-      else {
-        step_rate = acc_step_rate - step_rate; // Decelerate from aceleration end point.
-      }
-
-      // lower limit
-      if(step_rate < current_block->final_rate)
-        step_rate = current_block->final_rate;
+      step_rate = deceleration_rate();
 
       // step_rate to timer interval
-      timer = calc_timer(step_rate);
+      timer = timer_for_loops(calc_timer(step_rate), loops);
       OCR1A = timer;
       deceleration_time += timer;
+      #ifdef LIN_ADVANCE
+        set_advance_lead(advance_lead_at(current_block, step_rate));
+      #endif
       #ifdef ADVANCE
         for(int8_t i=0; i < step_loops; i++) {
           advance -= advance_rate;
@@ -661,15 +1289,68 @@ ISR(TIMER1_COMPA_vect)
       #endif //ADVANCE
     }
     else {
-      OCR1A = OCR1A_nominal;
+      // The acceleration may have ended on a rate with other step loops than the nominal one
+      step_loops = step_loops_nominal;
+      OCR1A = loops == step_loops ? OCR1A_nominal : timer_for_loops(OCR1A_nominal, loops);
+      #ifdef LIN_ADVANCE
+        set_advance_lead(advance_lead_nominal);
+      #endif
     }
+    #endif // STEP_SEGMENT_BUFFER
 
     // If current block is finished, reset pointer 
-    if (step_events_completed >= current_block->step_event_count) {
+    if (step_events_completed >= step_events_end) {
+      #ifdef STEP_SEGMENT_BUFFER
+        // Segments left over from a block stopped at an endstop would hold up the next ones
+        while (segment_buffer_tail != segment_buffer_head && segment_buffer[segment_buffer_tail].block == current_block) {
+          segment_buffer_tail = (segment_buffer_tail + 1) & (STEP_SEGMENT_BUFFER_SIZE - 1);
+        }
+        segment_step_events = 0;
+      #endif
       current_block = NULL;
       plan_discard_current_block();
+      #ifdef MOTION_STATS
+        if (!blocks_queued()) motion_stats.buffer_empty++;
+      #endif
     }   
   } 
+  #ifdef BABYSTEPPING
+    // One baby-step per interrupt, between the step events of the block. The direction pin goes
+    // back to the block's direction afterwards, the block's next Z step is an interrupt away. The
+    // setup wait also keeps the baby-step clear of a Z step the block just took.
+    if (babysteps_z != 0) {
+      bool up = babysteps_z > 0;
+      WRITE(Z_DIR_PIN, up ? !INVERT_Z_DIR : INVERT_Z_DIR);
+      #ifdef Z_DUAL_STEPPER_DRIVERS
+        WRITE(Z2_DIR_PIN, up ? !INVERT_Z_DIR : INVERT_Z_DIR);
+      #endif
+      DIRECTION_SETUP_DELAY();
+      WRITE(Z_STEP_PIN, !INVERT_Z_STEP_PIN);
+      #ifdef Z_DUAL_STEPPER_DRIVERS
+        WRITE(Z2_STEP_PIN, !INVERT_Z_STEP_PIN);
+      #endif
+      babysteps_z += up ? -1 : 1;
+      WRITE(Z_STEP_PIN, INVERT_Z_STEP_PIN);
+      #ifdef Z_DUAL_STEPPER_DRIVERS
+        WRITE(Z2_STEP_PIN, INVERT_Z_STEP_PIN);
+      #endif
+      if (current_block != NULL) {
+        WRITE(Z_DIR_PIN, count_direction[Z_AXIS] > 0 ? !INVERT_Z_DIR : INVERT_Z_DIR);
+        #ifdef Z_DUAL_STEPPER_DRIVERS
+          WRITE(Z2_DIR_PIN, count_direction[Z_AXIS] > 0 ? !INVERT_Z_DIR : INVERT_Z_DIR);
+        #endif
+      }
+    }
+  #endif
+  #ifdef MOTION_STATS
+    // Timer 1 restarted from 0 on the compare match, so it holds the time since then
+    unsigned int isr_ticks = TCNT1;
+    if (isr_ticks > motion_stats.isr_max) motion_stats.isr_max = isr_ticks;
+  #endif
+  #ifdef STEP_TRACE
+    // The counter went past the new OCR1A, the match comes only after it wraps
+    if (trace != NULL && TCNT1 >= OCR1A) trace->flags |= STEP_TRACE_LATE;
+  #endif
 }
 
 #ifdef ADVANCE
@@ -833,6 +1514,27 @@ void st_init()
       WRITE(Z_MAX_PIN,HIGH);
     #endif
   #endif
+
+  #ifdef ENDSTOP_INTERRUPTS
+    #if ENDSTOP_INTERRUPT(X_MIN_PIN)
+      enable_endstop_interrupt(DIO_EXT_INTERRUPT(X_MIN_PIN), DIO_PCINT_BANK(X_MIN_PIN), DIO_PCINT_BIT(X_MIN_PIN));
+    #endif
+    #if ENDSTOP_INTERRUPT(X_MAX_PIN)
+      enable_endstop_interrupt(DIO_EXT_INTERRUPT(X_MAX_PIN), DIO_PCINT_BANK(X_MAX_PIN), DIO_PCINT_BIT(X_MAX_PIN));
+    #endif
+    #if ENDSTOP_INTERRUPT(Y_MIN_PIN)
+      enable_endstop_interrupt(DIO_EXT_INTERRUPT(Y_MIN_PIN), DIO_PCINT_BANK(Y_MIN_PIN), DIO_PCINT_BIT(Y_MIN_PIN));
+    #endif
+    #if ENDSTOP_INTERRUPT(Y_MAX_PIN)
+      enable_endstop_interrupt(DIO_EXT_INTERRUPT(Y_MAX_PIN), DIO_PCINT_BANK(Y_MAX_PIN), DIO_PCINT_BIT(Y_MAX_PIN));
+    #endif
+    #if ENDSTOP_INTERRUPT(Z_MIN_PIN)
+      enable_endstop_interrupt(DIO_EXT_INTERRUPT(Z_MIN_PIN), DIO_PCINT_BANK(Z_MIN_PIN), DIO_PCINT_BIT(Z_MIN_PIN));
+    #endif
+    #if ENDSTOP_INTERRUPT(Z_MAX_PIN)
+      enable_endstop_interrupt(DIO_EXT_INTERRUPT(Z_MAX_PIN), DIO_PCINT_BANK(Z_MAX_PIN), DIO_PCINT_BIT(Z_MAX_PIN));
+    #endif
+  #endif
  
 
   //Initialize Step Pins
@@ -887,10 +1589,16 @@ void st_init()
   
   // Set the timer pre-scaler
   // Generally we use a divider of 8, resulting in a 2MHz timer
-  // frequency on a 16MHz MCU. If you are going to change this, be
-  // sure to regenerate speed_lookuptable.h with
-  // create_speed_lookuptable.py
-  TCCR1B = (TCCR1B & ~(0x07<<CS10)) | (2<<CS10);
+  // frequency on a 16MHz MCU. See STEPPER_TIMER_PRESCALER.
+  #if STEPPER_TIMER_PRESCALER == 1
+    TCCR1B = (TCCR1B & ~(0x07<<CS10)) | (1<<CS10);
+  #elif STEPPER_TIMER_PRESCALER == 8
+    TCCR1B = (TCCR1B & ~(0x07<<CS10)) | (2<<CS10);
+  #elif STEPPER_TIMER_PRESCALER == 64
+    TCCR1B = (TCCR1B & ~(0x07<<CS10)) | (3<<CS10);
+  #else
+    #error STEPPER_TIMER_PRESCALER has to be 1, 8 or 64
+  #endif
 
   OCR1A = 0x4000;
   TCNT1 = 0;
@@ -948,6 +1656,18 @@ long st_get_position(uint8_t axis)
   return count_pos;
 }
 
+#ifdef BABYSTEPPING
+long st_babystep_z(long steps)
+{
+  enable_z();
+  CRITICAL_SECTION_START;
+  steps = constrain(babysteps_z + steps, -32000L, 32000L) - babysteps_z;
+  babysteps_z += steps;
+  CRITICAL_SECTION_END;
+  return steps;
+}
+#endif
+
 void finishAndDisableSteppers()
 {
   st_synchronize(); 
@@ -965,9 +1685,171 @@ void quickStop()
   while(blocks_queued())
     plan_discard_current_block();
   current_block = NULL;
+  #ifdef STEP_SEGMENT_BUFFER
+    segment_buffer_tail = segment_buffer_head;
+    segment_step_events = 0;
+    prepare_block = NULL;
+    block_buffer_prepared = block_buffer_tail;
+  #endif
   ENABLE_STEPPER_DRIVER_INTERRUPT();
 }
 
+// The block the interrupt is stepping and the rate it goes at, for st_stop()
+static block_t *st_running_block(unsigned long &step_rate)
+{
+  CRITICAL_SECTION_START;
+  block_t *block = current_block;
+  if (block != NULL) {
+    #ifdef STEP_SEGMENT_BUFFER
+      // The interrupt finishes the segment it is stepping at its rate
+      step_rate = step_events_completed + segment_step_events == 0 ? block->initial_rate :
+        (unsigned long)STEPPER_TIMER_RATE * step_loops / segment_timer;
+    #else
+      step_rate = block->nominal_rate;
+      if (step_events_completed <= (unsigned long)block->accelerate_until) step_rate = acc_step_rate;
+      else if (step_events_completed > (unsigned long)block->decelerate_after) step_rate = deceleration_rate();
+    #endif
+  }
+  CRITICAL_SECTION_END;
+  return block;
+}
+
+// Brings the steppers to a stop as fast as the acceleration allows, where quickStop() drops the
+// steps on the spot. When the current block is long enough it slows down to a stop in it, otherwise
+// the planner keeps the blocks after it that it takes to get there. The moves after that are
+// discarded. Returns once the steppers stand still, st_get_position() has where they stopped.
+void st_stop()
+{
+  unsigned long step_rate;
+  block_t *block = st_running_block(step_rate);
+  block_stop_t stop;
+  bool stopping = block != NULL && calculate_stop_for_block(block, min(step_rate, MAX_STEP_FREQUENCY), stop);
+
+  // Only the cut of the block runs with the interrupt off. The steps it took since go before the
+  // ramp, which starts from the rate it had a moment ago.
+  CRITICAL_SECTION_START;
+  #ifdef STEP_SEGMENT_BUFFER
+    unsigned long step_events = step_events_completed + segment_step_events;
+  #else
+    unsigned long step_events = step_events_completed;
+  #endif
+  stopping = stopping && block == current_block && step_events + stop.step_events < block->step_event_count;
+  if (stopping) {
+    // The deceleration starts from the rate the block runs at now
+    plan_stop_block(block, stop);
+    step_events_end = step_events + stop.step_events;
+    acc_step_rate = block->initial_rate;
+    deceleration_time = 0;
+    #ifdef S_CURVE_ACCELERATION
+      deceleration_jerk_ticks = S_CURVE_JERK_TICKS(block->deceleration_ticks);
+    #endif
+    #ifdef STEP_SEGMENT_BUFFER
+      // Cut the rest of the block again
+      segment_buffer_head = segment_buffer_tail;
+      prepare_block = block;
+      block_buffer_prepared = block_buffer_tail;
+      prepare_step_events = step_events;
+      prepare_step_events_end = step_events_end;
+      prepare_step_loops = step_loops;
+    #endif
+  }
+  // The blocks from first on can still be replanned
+  #ifdef STEP_SEGMENT_BUFFER
+    unsigned char first = block_buffer_prepared;
+    if (prepare_block != NULL) first = (first + 1) & (BLOCK_BUFFER_SIZE - 1);
+  #else
+    unsigned char first = block_buffer_tail;
+    if (current_block != NULL) first = (first + 1) & (BLOCK_BUFFER_SIZE - 1);
+  #endif
+  CRITICAL_SECTION_END;
+
+  #ifdef STEP_SEGMENT_BUFFER
+    if (stopping) acceleration_time = calc_timer(acc_step_rate, prepare_step_loops);
+  #endif
+  plan_stop(first, stopping || first == block_buffer_head ? 0 : block_buffer[first].entry_speed);
+  #ifdef STEP_SEGMENT_BUFFER
+    st_prepare_segments();
+  #endif
+  // The LCD menu calls this, so no lcd_update() while waiting
+  while (blocks_queued()) {
+    manage_heater();
+    manage_inactivity();
+  }
+}
+
+#ifdef STEP_TRACE
+void st_trace_start()
+{
+  CRITICAL_SECTION_START;
+  step_trace_count = 0;
+  step_trace_block_count = 0;
+  step_trace_ticks = 0;
+  step_trace_block_start = false;
+  step_trace_on = true;
+  CRITICAL_SECTION_END;
+}
+
+void st_trace_stop()
+{
+  step_trace_on = false;
+}
+
+void st_trace_dump()
+{
+  st_trace_stop();
+  unsigned long first = step_trace_count > STEP_TRACE_SIZE ? step_trace_count - STEP_TRACE_SIZE : 0;
+  SERIAL_ECHO_START;
+  SERIAL_ECHOPGM("Step trace: ");
+  SERIAL_ECHO(step_trace_count - first);
+  SERIAL_ECHOPGM(" records, ");
+  SERIAL_ECHO(first);
+  SERIAL_ECHOPGM(" lost, ");
+  SERIAL_ECHO((unsigned long)STEPPER_TIMER_RATE);
+  SERIAL_ECHOLNPGM(" ticks/s");
+
+  // TB block step_event_count initial_rate nominal_rate final_rate accelerate_until decelerate_after
+  unsigned char blocks = step_trace_block_count < STEP_TRACE_BLOCKS ? step_trace_block_count : STEP_TRACE_BLOCKS;
+  for (unsigned char i = blocks; i > 0; i--) {
+    step_trace_block_t *planned = &step_trace_blocks[(unsigned char)(step_trace_block_count - i + 1) & (STEP_TRACE_BLOCKS - 1)];
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPGM("TB ");
+    SERIAL_ECHO((int)planned->block);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO(planned->step_event_count);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO(planned->initial_rate);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO(planned->nominal_rate);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO(planned->final_rate);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO(planned->accelerate_until);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHOLN(planned->decelerate_after);
+  }
+
+  // TS ticks latency x y z e flags block, the steps signed, flags 1 for the start of a block and
+  // 2 for a late interrupt
+  for (unsigned long n = first; n < step_trace_count; n++) {
+    step_trace_t *trace = &step_trace[n & (STEP_TRACE_SIZE - 1)];
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPGM("TS ");
+    SERIAL_ECHO((unsigned int)trace->ticks);
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO((int)trace->latency);
+    for (int8_t i = 0; i < NUM_AXIS; i++) {
+      int steps = (trace->steps >> (4 * i)) & 15;
+      SERIAL_ECHOPGM(" ");
+      SERIAL_ECHO(trace->flags & (1<<i) ? -steps : steps);
+    }
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHO((int)((trace->flags & STEP_TRACE_BLOCK_START ? 1 : 0) | (trace->flags & STEP_TRACE_LATE ? 2 : 0)));
+    SERIAL_ECHOPGM(" ");
+    SERIAL_ECHOLN((int)trace->block);
+  }
+}
+#endif
+
 void digitalPotWrite(int address, int value) // From Arduino DigitalPotControl example
 {
   #if DIGIPOTSS_PIN > -1
@@ -1065,4 +1947,4 @@ void microstep_readings()
       SERIAL_PROTOCOLLN( digitalRead(E1_MS2_PIN));
 }
 
-
+
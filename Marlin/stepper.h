@@ -51,10 +51,30 @@ void st_set_e_position(const long &e);
 // Get current position in steps
 long st_get_position(uint8_t axis);
 
+#ifdef BABYSTEPPING
+// Adds Z steps for the stepper interrupt to take on top of the moves, they are not counted.
+// Returns the steps added, less if too many are still waiting.
+long st_babystep_z(long steps);
+#endif
+
 // The stepper subsystem goes to sleep when it runs out of things to execute. Call this
 // to notify the subsystem that it is time to go to work.
 void st_wake_up();
 
+#ifdef STEP_SEGMENT_BUFFER
+// Cuts the planned blocks into step segments for the interrupt until the segment buffer is full.
+// Called from st_wake_up() and manage_inactivity(), so every waiting loop keeps it going.
+void st_prepare_segments();
+#endif
+
+#ifdef STEP_TRACE
+// Records every stepping interrupt from now on, keeping the last STEP_TRACE_SIZE
+void st_trace_start();
+void st_trace_stop();
+// Stops recording and sends the record over serial, see stepper.cpp for the format
+void st_trace_dump();
+#endif
+
   
 void checkHitEndstops(); //call from somwhere to create an serial error message with the locations the endstops where hit, in case they were triggered
 
@@ -70,6 +90,9 @@ extern block_t *current_block;  // A pointer to the block currently being traced
 
 void quickStop();
 
+// Stops the moves in the buffer as fast as the acceleration allows and waits for the steppers
+void st_stop();
+
 void digitalPotWrite(int address, int value);
 void microstep_ms(uint8_t driver, int8_t ms1, int8_t ms2);
 void microstep_mode(uint8_t driver, uint8_t stepping);
@@ -31,6 +31,9 @@ static void lcd_status_screen();
 #ifdef ULTIPANEL
 static void lcd_main_menu();
 static void lcd_tune_menu();
+#ifdef BABYSTEPPING
+static void lcd_babystep_z();
+#endif
 static void lcd_cal_menu();
 static void lcd_move_y();
 static void lcd_prepare_menu();
@@ -54,6 +57,7 @@ static void menu_action_sdfile(const char* filename, char* longFilename);
 static void menu_action_sddirectory(const char* filename, char* longFilename);
 static void menu_action_setting_edit_bool(const char* pstr, bool* ptr);
 static void menu_action_setting_edit_int3(const char* pstr, int* ptr, int minValue, int maxValue);
+static void menu_action_setting_edit_callback_int3(const char* pstr, int* ptr, int minValue, int maxValue, menuFunc_t callback);
 static void menu_action_setting_edit_float3(const char* pstr, float* ptr, float minValue, float maxValue);
 static void menu_action_setting_edit_float32(const char* pstr, float* ptr, float minValue, float maxValue);
 static void menu_action_setting_edit_float5(const char* pstr, float* ptr, float minValue, float maxValue);
@@ -90,6 +94,7 @@ static void menu_action_setting_edit_long5(const char* pstr, unsigned long* ptr,
 } while(0)
 #define MENU_ITEM_DUMMY() do { _menuItemNr++; } while(0)
 #define MENU_ITEM_EDIT(type, label, args...) MENU_ITEM(setting_edit_ ## type, label, PSTR(label) , ## args )
+#define MENU_ITEM_EDIT_CALLBACK(type, label, args...) MENU_ITEM(setting_edit_callback_ ## type, label, PSTR(label) , ## args )
 #define END_MENU() \
     if (encoderPosition / ENCODER_STEPS_PER_MENU_ITEM >= _menuItemNr) encoderPosition = _menuItemNr * ENCODER_STEPS_PER_MENU_ITEM - 1; \
     if ((uint8_t)(encoderPosition / ENCODER_STEPS_PER_MENU_ITEM) >= currentMenuViewOffset + LCD_HEIGHT) { currentMenuViewOffset = (encoderPosition / ENCODER_STEPS_PER_MENU_ITEM) - LCD_HEIGHT + 1; lcdDrawUpdate = 1; _lineNr = currentMenuViewOffset - 1; _drawLineNr = -1; } \
@@ -120,6 +125,7 @@ uint16_t prevEncoderPosition;
 const char* editLabel;
 void* editValue;
 int32_t minEditValue, maxEditValue;
+menuFunc_t callbackFunc;                    /* called when the edited value is set, or NULL */
 
 /* Main status screen. It's up to the implementation specific part to show what is needed. As this is very display dependend */
 static void lcd_status_screen()
@@ -139,6 +145,7 @@ static void lcd_status_screen()
         currentMenu = lcd_main_menu;
         lcd_quick_feedback();
     }
+    int old_feedmultiply = feedmultiply;
     if (abs(encoderPosition / 2) > 1)
         feedmultiply += encoderPosition / 2;
     encoderPosition = 0;
@@ -146,6 +153,10 @@ static void lcd_status_screen()
         feedmultiply = 10;
     if (feedmultiply > 999)
         feedmultiply = 999;
+#ifdef SPEED_OVERRIDE_REPLAN
+    if (feedmultiply != old_feedmultiply)
+        plan_apply_feed_multiply();
+#endif
 #endif//ULTIPANEL
 }
 
@@ -169,7 +180,7 @@ static void lcd_sdcard_stop()
 {
     card.sdprinting = false;
     card.closefile();
-    quickStop();
+    stop_moves();
     if(SD_FINISHED_STEPPERRELEASE)
     {
         enquecommand_P(PSTR(SD_FINISHED_RELEASECOMMAND));
@@ -248,7 +259,14 @@ static void lcd_tune_menu()
 {
     START_MENU();
     MENU_ITEM(back, MSG_MAIN, lcd_main_menu);
+#ifdef SPEED_OVERRIDE_REPLAN
+    MENU_ITEM_EDIT_CALLBACK(int3, MSG_SPEED, &feedmultiply, 10, 999, plan_apply_feed_multiply);
+#else
     MENU_ITEM_EDIT(int3, MSG_SPEED, &feedmultiply, 10, 999);
+#endif
+#ifdef BABYSTEPPING
+    MENU_ITEM(submenu, "Babystep Z", lcd_babystep_z);
+#endif
     MENU_ITEM_EDIT(int3, MSG_NOZZLE, &target_temperature[0], 0, HEATER_0_MAXTEMP - 15);
 #if TEMP_SENSOR_1 != 0
     MENU_ITEM_EDIT(int3, MSG_NOZZLE1, &target_temperature[1], 0, HEATER_1_MAXTEMP - 15);
@@ -264,6 +282,28 @@ static void lcd_tune_menu()
     END_MENU();
 }
 
+#ifdef BABYSTEPPING
+static void lcd_babystep_z()
+{
+    if (encoderPosition != 0)
+    {
+        babystep_z(float((int)encoderPosition) * BABYSTEP_LCD_MM);
+        encoderPosition = 0;
+        lcdDrawUpdate = 1;
+    }
+    if (lcdDrawUpdate)
+    {
+        lcd_implementation_drawedit(PSTR("Babystep Z"), ftostr32(babystep_z_offset()));
+    }
+    if (LCD_CLICKED)
+    {
+        lcd_quick_feedback();
+        currentMenu = lcd_tune_menu;
+        encoderPosition = 0;
+    }
+}
+#endif
+
 static void lcd_prepare_menu()
 {
     START_MENU();
@@ -627,6 +667,8 @@ void lcd_sdcard_menu()
             lcd_quick_feedback(); \
             currentMenu = prevMenu; \
             encoderPosition = prevEncoderPosition; \
+            if (callbackFunc) \
+                (*callbackFunc)(); \
         } \
     } \
     static void menu_action_setting_edit_ ## _name (const char* pstr, _type* ptr, _type minValue, _type maxValue) \
@@ -642,6 +684,7 @@ void lcd_sdcard_menu()
         minEditValue = minValue * scale; \
         maxEditValue = maxValue * scale; \
         encoderPosition = (*ptr) * scale; \
+        callbackFunc = NULL; \
     }
 menu_edit_type(int, int3, itostr3, 1)
 menu_edit_type(float, float3, ftostr3, 1)
@@ -652,6 +695,13 @@ menu_edit_type(float, float52, ftostr52, 100)
 menu_edit_type(float, float74, ftostr74, 10000)
 menu_edit_type(unsigned long, long5, ftostr5, 0.01)
 
+/* Like menu_action_setting_edit_int3, calls callback once the value is set */
+static void menu_action_setting_edit_callback_int3(const char* pstr, int* ptr, int minValue, int maxValue, menuFunc_t callback)
+{
+    menu_action_setting_edit_int3(pstr, ptr, minValue, maxValue);
+    callbackFunc = callback;
+}
+
 /** End of menus **/
 
 static void lcd_quick_feedback()